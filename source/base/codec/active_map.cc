@@ -0,0 +1,108 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/active_map.h"
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+//--------------------------------------------------------------------------------------------------
+int roundToTwosMultiple(int x)
+{
+    return x & (~1);
+}
+
+//--------------------------------------------------------------------------------------------------
+Rect alignRect(const Rect& rect)
+{
+    int x = roundToTwosMultiple(rect.left());
+    int y = roundToTwosMultiple(rect.top());
+    int right = roundToTwosMultiple(rect.right() + 1);
+    int bottom = roundToTwosMultiple(rect.bottom() + 1);
+
+    return Rect::makeLTRB(x, y, right, bottom);
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+void ActiveMap::resize(const Size& size)
+{
+    columns_ = static_cast<unsigned int>((size.width() + kMacroBlockSize - 1) / kMacroBlockSize);
+    rows_ = static_cast<unsigned int>((size.height() + kMacroBlockSize - 1) / kMacroBlockSize);
+
+    buffer_.resize(columns_ * rows_);
+    clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+void ActiveMap::clear()
+{
+    memset(buffer_.data(), 0, buffer_.size());
+}
+
+//--------------------------------------------------------------------------------------------------
+void ActiveMap::addRect(const Rect& rect)
+{
+    int left = rect.left() / kMacroBlockSize;
+    int top = rect.top() / kMacroBlockSize;
+    int right = (rect.right() - 1) / kMacroBlockSize;
+    int bottom = (rect.bottom() - 1) / kMacroBlockSize;
+
+    uint8_t* map = buffer_.data() + static_cast<uint32_t>(top) * columns_;
+
+    for (int y = top; y <= bottom; ++y)
+    {
+        for (int x = left; x <= right; ++x)
+            map[x] = 1;
+
+        map += columns_;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+Region ActiveMap::paddedRegion(const Region& updated_region, int padding, const Rect& image_rect)
+{
+    Region padded_region;
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        Rect rect = it.rect();
+
+        // Pad each rectangle to avoid the block-artefact filters of the codec from introducing
+        // artefacts; unchanged pixels up to |padding| far out may still be affected by the changes
+        // in the updated region, and so must be listed in the active map. Aligning the rectangles
+        // ensures they have even top-left coords, which is is required by ARGBToI420().
+        padded_region.addRect(
+            alignRect(Rect::makeLTRB(
+                rect.left() - padding, rect.top() - padding,
+                rect.right() + padding, rect.bottom() + padding)));
+    }
+
+    // Clip back to the screen dimensions, in case they're not macroblock aligned.
+    // The conversion routines don't require even width & height, so this is safe even if the
+    // source dimensions are not even.
+    padded_region.intersectWith(image_rect);
+    return padded_region;
+}
+
+} // namespace base
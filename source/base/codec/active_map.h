@@ -0,0 +1,62 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_CODEC_ACTIVE_MAP_H
+#define BASE_CODEC_ACTIVE_MAP_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+#include "base/memory/byte_array.h"
+
+namespace base {
+
+// Marks the macro blocks of a frame that the VPX and AV1 encoders have to encode. The encoders skip
+// the blocks that are not marked.
+class ActiveMap
+{
+public:
+    // Size of the side of a macro block in pixels.
+    static const int kMacroBlockSize = 16;
+
+    ActiveMap() = default;
+    ~ActiveMap() = default;
+
+    // Resizes the map for a frame of |size| and clears it.
+    void resize(const Size& size);
+    void clear();
+    void addRect(const Rect& rect);
+
+    uint8_t* data() { return buffer_.data(); }
+    unsigned int columns() const { return columns_; }
+    unsigned int rows() const { return rows_; }
+
+    // Returns |updated_region| with each rectangle extended by |padding| pixels and aligned to even
+    // coordinates, clipped to |image_rect|.
+    static Region paddedRegion(const Region& updated_region, int padding, const Rect& image_rect);
+
+private:
+    ByteArray buffer_;
+    unsigned int columns_ = 0;
+    unsigned int rows_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ActiveMap);
+};
+
+} // namespace base
+
+#endif // BASE_CODEC_ACTIVE_MAP_H
@@ -0,0 +1,78 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/active_map.h"
+
+#include <gtest/gtest.h>
+
+#include <iterator>
+
+namespace base {
+
+TEST(ActiveMapTest, Resize)
+{
+    ActiveMap active_map;
+    active_map.resize(Size(100, 33));
+
+    EXPECT_EQ(active_map.columns(), 7u);
+    EXPECT_EQ(active_map.rows(), 3u);
+
+    for (unsigned int i = 0; i < active_map.columns() * active_map.rows(); ++i)
+        EXPECT_EQ(active_map.data()[i], 0);
+}
+
+TEST(ActiveMapTest, AddRect)
+{
+    ActiveMap active_map;
+    active_map.resize(Size(64, 64));
+
+    // The rectangle touches the blocks (0,1), (1,1), (0,2) and (1,2).
+    active_map.addRect(Rect::makeLTRB(15, 16, 17, 33));
+
+    const uint8_t expected[] =
+    {
+        0, 0, 0, 0,
+        1, 1, 0, 0,
+        1, 1, 0, 0,
+        0, 0, 0, 0
+    };
+
+    for (size_t i = 0; i < std::size(expected); ++i)
+        EXPECT_EQ(active_map.data()[i], expected[i]) << "index: " << i;
+
+    active_map.clear();
+
+    for (size_t i = 0; i < std::size(expected); ++i)
+        EXPECT_EQ(active_map.data()[i], 0) << "index: " << i;
+}
+
+TEST(ActiveMapTest, PaddedRegion)
+{
+    const Rect image_rect = Rect::makeWH(100, 100);
+
+    Region region = ActiveMap::paddedRegion(Region(Rect::makeLTRB(11, 21, 31, 41)), 3, image_rect);
+    EXPECT_TRUE(region.equals(Region(Rect::makeLTRB(8, 18, 34, 44))));
+
+    // The region is clipped to the image.
+    region = ActiveMap::paddedRegion(Region(Rect::makeLTRB(1, 90, 10, 100)), 8, image_rect);
+    EXPECT_TRUE(region.equals(Region(Rect::makeLTRB(0, 82, 18, 100))));
+
+    EXPECT_TRUE(ActiveMap::paddedRegion(Region(), 8, image_rect).isEmpty());
+}
+
+} // namespace base
@@ -0,0 +1,40 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_CODEC_SCOPED_AOM_CODEC_H
+#define BASE_CODEC_SCOPED_AOM_CODEC_H
+
+#include <memory>
+
+extern "C"
+{
+typedef struct aom_codec_ctx aom_codec_ctx_t;
+}
+
+namespace base {
+
+struct AomCodecDeleter
+{
+    void operator()(aom_codec_ctx_t* codec);
+};
+
+using ScopedAomCodec = std::unique_ptr<aom_codec_ctx_t, AomCodecDeleter>;
+
+} // namespace base
+
+#endif // BASE_CODEC_SCOPED_AOM_CODEC_H
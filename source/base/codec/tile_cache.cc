@@ -0,0 +1,98 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/tile_cache.h"
+
+#include "base/logging.h"
+
+#include <iterator>
+
+namespace base {
+
+//--------------------------------------------------------------------------------------------------
+TileCache::TileCache(size_t slot_count)
+    : slot_count_(slot_count)
+{
+    DCHECK_GT(slot_count_, 0U);
+    DCHECK_LE(slot_count_, kMaxSlotCount);
+
+    map_.reserve(slot_count_);
+}
+
+//--------------------------------------------------------------------------------------------------
+TileCache::~TileCache() = default;
+
+//--------------------------------------------------------------------------------------------------
+void TileCache::startPacket()
+{
+    ++packet_;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::optional<uint32_t> TileCache::find(uint64_t hash)
+{
+    auto it = map_.find(hash);
+    if (it == map_.end())
+        return std::nullopt;
+
+    EntryList::iterator entry = it->second;
+    entry->packet = packet_;
+
+    // Move the tile to the front of the list.
+    entries_.splice(entries_.begin(), entries_, entry);
+    return entry->slot;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::optional<uint32_t> TileCache::add(uint64_t hash)
+{
+    DCHECK(map_.find(hash) == map_.end());
+
+    if (entries_.size() < slot_count_)
+    {
+        const uint32_t slot = static_cast<uint32_t>(entries_.size());
+
+        entries_.push_front({ hash, slot, packet_ });
+        map_.emplace(hash, entries_.begin());
+        return slot;
+    }
+
+    // The least recently used tile is at the back of the list.
+    EntryList::iterator entry = std::prev(entries_.end());
+    if (entry->packet == packet_)
+        return std::nullopt;
+
+    map_.erase(entry->hash);
+
+    entry->hash = hash;
+    entry->packet = packet_;
+
+    entries_.splice(entries_.begin(), entries_, entry);
+    map_.emplace(hash, entry);
+
+    return entry->slot;
+}
+
+//--------------------------------------------------------------------------------------------------
+void TileCache::clear()
+{
+    entries_.clear();
+    map_.clear();
+}
+
+} // namespace base
@@ -0,0 +1,85 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_CODEC_TILE_CACHE_H
+#define BASE_CODEC_TILE_CACHE_H
+
+#include "base/macros_magic.h"
+
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+
+namespace base {
+
+// Keeps the fingerprints of the screen tiles that the client has in its tile cache. The host
+// chooses the slot of the client cache for each tile, so the client only stores and draws tiles
+// by slot number and does not need to repeat the replacement policy. The least recently used
+// tile is replaced when the cache is full.
+class TileCache
+{
+public:
+    // Size of the side of a cached tile in pixels.
+    static constexpr int kTileSize = 64;
+
+    // Maximum number of slots that the client accepts.
+    static constexpr size_t kMaxSlotCount = 4096;
+
+    explicit TileCache(size_t slot_count);
+    ~TileCache();
+
+    size_t slotCount() const { return slot_count_; }
+
+    // Starts a new video packet. A slot used by the packet is not given to another tile within
+    // the same packet, because the client applies all stores of a packet before drawing.
+    void startPacket();
+
+    // Returns the slot of the tile with |hash| and marks the tile as recently used.
+    std::optional<uint32_t> find(uint64_t hash);
+
+    // Puts the tile with |hash| into a free or the least recently used slot and returns the slot.
+    // Returns std::nullopt if all slots are used by the current packet.
+    std::optional<uint32_t> add(uint64_t hash);
+
+    // Removes all tiles. Called when the client resets its cache.
+    void clear();
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        uint32_t slot;
+        uint64_t packet;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    const size_t slot_count_;
+    uint64_t packet_ = 0;
+
+    // The most recently used tiles are at the front.
+    EntryList entries_;
+    std::unordered_map<uint64_t, EntryList::iterator> map_;
+
+    DISALLOW_COPY_AND_ASSIGN(TileCache);
+};
+
+} // namespace base
+
+#endif // BASE_CODEC_TILE_CACHE_H
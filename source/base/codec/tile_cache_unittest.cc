@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/tile_cache.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(TileCacheTest, FindAndAdd)
+{
+    TileCache cache(3);
+
+    cache.startPacket();
+    EXPECT_FALSE(cache.find(100).has_value());
+    EXPECT_EQ(cache.add(100), 0U);
+    EXPECT_EQ(cache.add(200), 1U);
+    EXPECT_EQ(cache.add(300), 2U);
+
+    EXPECT_EQ(cache.find(100), 0U);
+    EXPECT_EQ(cache.find(300), 2U);
+
+    // All slots are used by the current packet.
+    EXPECT_FALSE(cache.add(400).has_value());
+    EXPECT_FALSE(cache.find(400).has_value());
+
+    cache.startPacket();
+
+    // The least recently used tile (200) is replaced.
+    EXPECT_EQ(cache.add(400), 1U);
+    EXPECT_FALSE(cache.find(200).has_value());
+    EXPECT_EQ(cache.find(400), 1U);
+
+    // Then 100 is the least recently used tile.
+    EXPECT_EQ(cache.add(500), 0U);
+    EXPECT_FALSE(cache.find(100).has_value());
+    EXPECT_EQ(cache.find(300), 2U);
+    EXPECT_EQ(cache.find(500), 0U);
+}
+
+TEST(TileCacheTest, Clear)
+{
+    TileCache cache(2);
+
+    cache.startPacket();
+    EXPECT_EQ(cache.add(100), 0U);
+    EXPECT_EQ(cache.add(200), 1U);
+
+    cache.clear();
+    cache.startPacket();
+
+    EXPECT_FALSE(cache.find(100).has_value());
+    EXPECT_FALSE(cache.find(200).has_value());
+    EXPECT_EQ(cache.add(200), 0U);
+}
+
+} // namespace base
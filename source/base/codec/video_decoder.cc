@@ -18,6 +18,7 @@
 
 #include "base/codec/video_decoder.h"
 
+#include "base/codec/video_decoder_av1.h"
 #include "base/codec/video_decoder_vpx.h"
 #include "base/codec/video_decoder_zstd.h"
 
@@ -35,6 +36,9 @@ std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::VideoEncoding encoding
         case proto::VIDEO_ENCODING_VP9:
             return VideoDecoderVPX::createVP9();
 
+        case proto::VIDEO_ENCODING_AV1:
+            return VideoDecoderAV1::create();
+
         case proto::VIDEO_ENCODING_ZSTD:
             return VideoDecoderZstd::create();
 
@@ -0,0 +1,159 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_decoder_av1.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+#include <libyuv/convert_argb.h>
+
+#include <aom/aom_decoder.h>
+#include <aom/aomdx.h>
+
+#include <thread>
+
+namespace base {
+
+namespace {
+
+//--------------------------------------------------------------------------------------------------
+bool convertImage(const proto::VideoPacket& packet, aom_image_t* image, Frame* frame)
+{
+    if (image->fmt != AOM_IMG_FMT_I420)
+    {
+        LOG(LS_ERROR) << "Unsupported image format: " << image->fmt;
+        return false;
+    }
+
+    Rect frame_rect = Rect::makeSize(frame->size());
+
+    uint8_t* y_data = image->planes[AOM_PLANE_Y];
+    uint8_t* u_data = image->planes[AOM_PLANE_U];
+    uint8_t* v_data = image->planes[AOM_PLANE_V];
+
+    int y_stride = image->stride[AOM_PLANE_Y];
+    int uv_stride = image->stride[AOM_PLANE_U];
+
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    {
+        const proto::Rect& dirty_rect = packet.dirty_rect(i);
+        Rect rect = Rect::makeXYWH(
+            dirty_rect.x(), dirty_rect.y(), dirty_rect.width(), dirty_rect.height());
+
+        if (!frame_rect.containsRect(rect))
+        {
+            LOG(LS_ERROR) << "The rectangle is outside the screen area";
+            return false;
+        }
+
+        int y_offset = y_stride * rect.y() + rect.x();
+        int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+
+        libyuv::I420ToARGB(y_data + y_offset, y_stride,
+                           u_data + uv_offset, uv_stride,
+                           v_data + uv_offset, uv_stride,
+                           frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           rect.width(),
+                           rect.height());
+    }
+
+    return true;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// static
+std::unique_ptr<VideoDecoderAV1> VideoDecoderAV1::create()
+{
+    return std::unique_ptr<VideoDecoderAV1>(new VideoDecoderAV1());
+}
+
+//--------------------------------------------------------------------------------------------------
+VideoDecoderAV1::VideoDecoderAV1()
+{
+    LOG(LS_INFO) << "Ctor";
+    codec_.reset(new aom_codec_ctx_t());
+
+    uint32_t thread_count = std::thread::hardware_concurrency();
+    if (thread_count >= 12)
+        thread_count = 8;
+    else if (thread_count >= 8)
+        thread_count = 4;
+    else
+        thread_count = 2;
+
+    aom_codec_dec_cfg_t config;
+    config.w = 0;
+    config.h = 0;
+    config.threads = thread_count;
+
+    // The encoder uses 8 bits per sample. The decoder returns the image in I420 format.
+    config.allow_lowbitdepth = 1;
+
+    aom_codec_err_t ret = aom_codec_dec_init(codec_.get(), aom_codec_av1_dx(), &config, 0);
+    CHECK_EQ(ret, AOM_CODEC_OK);
+}
+
+//--------------------------------------------------------------------------------------------------
+VideoDecoderAV1::~VideoDecoderAV1()
+{
+    LOG(LS_INFO) << "Dtor";
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoDecoderAV1::decode(const proto::VideoPacket& packet, Frame* frame)
+{
+    // Do the actual decoding.
+    aom_codec_err_t ret =
+        aom_codec_decode(codec_.get(),
+                         reinterpret_cast<const uint8_t*>(packet.data().data()),
+                         packet.data().size(),
+                         nullptr);
+    if (ret != AOM_CODEC_OK)
+    {
+        const char* error = aom_codec_error(codec_.get());
+        const char* error_detail = aom_codec_error_detail(codec_.get());
+
+        LOG(LS_ERROR) << "Decoding failed: " << (error ? error : "(NULL)") << "\n"
+                      << "Details: " << (error_detail ? error_detail : "(NULL)");
+        return false;
+    }
+
+    aom_codec_iter_t iter = nullptr;
+
+    // Gets the decoded data.
+    aom_image_t* image = aom_codec_get_frame(codec_.get(), &iter);
+    if (!image)
+    {
+        LOG(LS_ERROR) << "No video frame decoded";
+        return false;
+    }
+
+    if (Size(static_cast<int32_t>(image->d_w), static_cast<int32_t>(image->d_h)) != frame->size())
+    {
+        LOG(LS_ERROR) << "Size of the encoded frame doesn't match size in the header";
+        return false;
+    }
+
+    return convertImage(packet, image, frame);
+}
+
+} // namespace base
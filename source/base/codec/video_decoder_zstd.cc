@@ -20,7 +20,15 @@
 
 #include "base/logging.h"
 #include "base/codec/pixel_translator.h"
+#include "base/codec/tile_cache.h"
+#include "base/codec/video_decoder_vpx.h"
 #include "base/desktop/frame_aligned.h"
+#include "base/threading/parallel_runner.h"
+
+#include <atomic>
+#include <cstring>
+
+#include <libyuv/scale_argb.h>
 
 namespace base {
 
@@ -79,6 +87,9 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_fr
             parsePixelFormat(format.pixel_format()), 32);
 
         translator_ = PixelTranslator::create(source_frame_->format(), PixelFormat::ARGB());
+
+        motion_decoder_.reset();
+        motion_frame_.reset();
     }
 
     DCHECK(source_frame_->size() == target_frame->size());
@@ -89,25 +100,129 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_fr
         return false;
     }
 
-    size_t ret = ZSTD_initDStream(stream_.get());
-    if (ZSTD_isError(ret))
+    Rect frame_rect = Rect::makeSize(source_frame_->size());
+
+    // Moved areas are copied within the frame before the changed areas are decoded.
+    for (int i = 0; i < packet.copy_rect_size(); ++i)
     {
-        LOG(LS_ERROR) << "ZSTD_initDStream failed: " << ZSTD_getErrorName(ret);
-        return false;
-    }
+        const proto::CopyRect& copy_rect = packet.copy_rect(i);
 
-    Rect frame_rect = Rect::makeSize(source_frame_->size());
-    ZSTD_inBuffer input = { packet.data().data(), packet.data().size(), 0 };
+        Rect source_rect = parseRect(copy_rect.source_rect());
+        Point dest_pos(copy_rect.dest_x(), copy_rect.dest_y());
+
+        if (!frame_rect.containsRect(source_rect) ||
+            !frame_rect.containsRect(Rect::makeXYWH(dest_pos, source_rect.size())))
+        {
+            LOG(LS_ERROR) << "The copy rectangle is outside the screen area";
+            return false;
+        }
+
+        target_frame->moveRect(source_rect, dest_pos);
+    }
 
     for (int i = 0; i < packet.dirty_rect_size(); ++i)
     {
-        Rect rect = parseRect(packet.dirty_rect(i));
-
-        if (!frame_rect.containsRect(rect))
+        if (!frame_rect.containsRect(parseRect(packet.dirty_rect(i))))
         {
             LOG(LS_ERROR) << "The rectangle is outside the screen area";
             return false;
         }
+    }
+
+    if (packet.tile_cache_size() != 0)
+    {
+        if (packet.tile_cache_size() > TileCache::kMaxSlotCount)
+        {
+            LOG(LS_ERROR) << "Invalid tile cache size: " << packet.tile_cache_size();
+            return false;
+        }
+
+        tile_cache_.clear();
+        tile_cache_.resize(packet.tile_cache_size());
+    }
+
+    bool result;
+    if (packet.tile_size() > 0)
+        result = decodeTiles(packet, target_frame);
+    else
+        result = decodeStream(packet, target_frame);
+
+    if (!result || !applyTileCache(packet, target_frame))
+        return false;
+
+    if (!packet.has_motion_layer())
+        return true;
+
+    return decodeMotionLayer(packet.motion_layer(), target_frame);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoDecoderZstd::decodeStream(const proto::VideoPacket& packet, Frame* target_frame)
+{
+    bool new_stream = true;
+
+    switch (packet.stream())
+    {
+        case proto::VIDEO_STREAM_NONE:
+            stream_started_ = false;
+            break;
+
+        case proto::VIDEO_STREAM_START:
+            stream_started_ = true;
+            break;
+
+        case proto::VIDEO_STREAM_CONTINUE:
+        {
+            if (!stream_started_)
+            {
+                LOG(LS_ERROR) << "The packet continues a stream that was not started";
+                return false;
+            }
+
+            new_stream = false;
+        }
+        break;
+
+        default:
+            LOG(LS_ERROR) << "Unknown stream mode: " << packet.stream();
+            return false;
+    }
+
+    if (!decodeRects(stream_.get(), new_stream, packet, 0, packet.dirty_rect_size(),
+                     reinterpret_cast<const uint8_t*>(packet.data().data()),
+                     packet.data().size(), target_frame))
+    {
+        // The history of the stream is not complete.
+        stream_started_ = false;
+        return false;
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoDecoderZstd::decodeRects(ZSTD_DStream* stream, bool new_stream,
+                                   const proto::VideoPacket& packet, int first_rect,
+                                   int rect_count, const uint8_t* data, size_t data_size,
+                                   Frame* target_frame)
+{
+    size_t ret;
+
+    if (new_stream)
+    {
+        ret = ZSTD_initDStream(stream);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "ZSTD_initDStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+    }
+
+    ZSTD_inBuffer input = { data, data_size, 0 };
+
+    for (int i = first_rect; i < first_rect + rect_count; ++i)
+    {
+        Rect rect = parseRect(packet.dirty_rect(i));
 
         uint8_t* output_data = source_frame_->frameDataAtPos(rect.x(), rect.y());
         const size_t output_size =
@@ -118,13 +233,22 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_fr
 
         while (row_y < rect.height())
         {
-            ret = ZSTD_decompressStream(stream_.get(), &output, &input);
+            const size_t prev_input_pos = input.pos;
+            const size_t prev_output_pos = output.pos;
+
+            ret = ZSTD_decompressStream(stream, &output, &input);
             if (ZSTD_isError(ret))
             {
                 LOG(LS_ERROR) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
                 return false;
             }
 
+            if (input.pos == prev_input_pos && output.pos == prev_output_pos)
+            {
+                LOG(LS_ERROR) << "Not enough data for the rectangle";
+                return false;
+            }
+
             // If we completely unpacked the row in the rectangle.
             if (output.pos == output.size)
             {
@@ -143,6 +267,224 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_fr
                                rect.height());
     }
 
+    if (packet.stream() == proto::VIDEO_STREAM_NONE)
+        return true;
+
+    // The next packet of the stream starts with a new block. The rest of the flushed block must be
+    // consumed here.
+    while (input.pos < input.size)
+    {
+        const size_t prev_input_pos = input.pos;
+        ZSTD_outBuffer output = { nullptr, 0, 0 };
+
+        ret = ZSTD_decompressStream(stream, &output, &input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        if (input.pos == prev_input_pos)
+        {
+            LOG(LS_ERROR) << "Unexpected data at the end of the packet";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoDecoderZstd::decodeTiles(const proto::VideoPacket& packet, Frame* target_frame)
+{
+    struct TileInfo
+    {
+        int first_rect;
+        int rect_count;
+        size_t data_offset;
+        size_t data_size;
+    };
+
+    if (packet.stream() != proto::VIDEO_STREAM_NONE)
+    {
+        LOG(LS_ERROR) << "Tiles can not be a part of a stream";
+        return false;
+    }
+
+    std::vector<TileInfo> tiles;
+    tiles.reserve(static_cast<size_t>(packet.tile_size()));
+
+    int64_t rect_count = 0;
+    size_t data_size = 0;
+
+    for (int i = 0; i < packet.tile_size(); ++i)
+    {
+        const proto::VideoTile& tile = packet.tile(i);
+
+        tiles.push_back({ static_cast<int>(rect_count), static_cast<int>(tile.rect_count()),
+                          data_size, tile.data_size() });
+
+        rect_count += tile.rect_count();
+        data_size += tile.data_size();
+
+        if (rect_count > packet.dirty_rect_size() || data_size > packet.data().size())
+        {
+            LOG(LS_ERROR) << "Invalid tile " << i;
+            return false;
+        }
+    }
+
+    if (rect_count != packet.dirty_rect_size() || data_size != packet.data().size())
+    {
+        LOG(LS_ERROR) << "Tiles do not match the packet";
+        return false;
+    }
+
+    if (!tile_runner_)
+    {
+        tile_runner_ = std::make_unique<ParallelRunner>();
+
+        tile_streams_.resize(static_cast<size_t>(tile_runner_->threadCount()));
+        for (auto& stream : tile_streams_)
+            stream.reset(ZSTD_createDStream());
+    }
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(packet.data().data());
+    std::atomic<bool> result = true;
+
+    // The encoder does not put the same pixels into different tiles, so each tile writes only to its
+    // own part of the frames.
+    tile_runner_->run(tiles.size(), [&](size_t index, int thread_index)
+    {
+        const TileInfo& tile = tiles[index];
+
+        if (!decodeRects(tile_streams_[static_cast<size_t>(thread_index)].get(), true, packet,
+                         tile.first_rect, tile.rect_count, data + tile.data_offset,
+                         tile.data_size, target_frame))
+        {
+            result = false;
+        }
+    });
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoDecoderZstd::applyTileCache(const proto::VideoPacket& packet, Frame* target_frame)
+{
+    if (packet.cache_store_size() == 0 && packet.cached_tile_size() == 0)
+        return true;
+
+    const Rect frame_rect = Rect::makeSize(target_frame->size());
+    const int tile_size = TileCache::kTileSize;
+    const size_t row_size = static_cast<size_t>(tile_size * target_frame->format().bytesPerPixel());
+
+    auto is_valid_tile = [&](const proto::CachedTile& tile)
+    {
+        return tile.slot() < tile_cache_.size() &&
+               frame_rect.containsRect(Rect::makeXYWH(tile.x(), tile.y(), tile_size, tile_size));
+    };
+
+    for (int i = 0; i < packet.cache_store_size(); ++i)
+    {
+        const proto::CachedTile& tile = packet.cache_store(i);
+        if (!is_valid_tile(tile))
+        {
+            LOG(LS_ERROR) << "Invalid tile to store in the cache";
+            return false;
+        }
+
+        std::unique_ptr<uint8_t[]>& data = tile_cache_[tile.slot()];
+        if (!data)
+            data = std::make_unique<uint8_t[]>(row_size * static_cast<size_t>(tile_size));
+
+        for (int y = 0; y < tile_size; ++y)
+        {
+            memcpy(data.get() + row_size * static_cast<size_t>(y),
+                   target_frame->frameDataAtPos(tile.x(), tile.y() + y), row_size);
+        }
+    }
+
+    for (int i = 0; i < packet.cached_tile_size(); ++i)
+    {
+        const proto::CachedTile& tile = packet.cached_tile(i);
+        if (!is_valid_tile(tile) || !tile_cache_[tile.slot()])
+        {
+            LOG(LS_ERROR) << "Invalid tile from the cache";
+            return false;
+        }
+
+        const uint8_t* data = tile_cache_[tile.slot()].get();
+
+        for (int y = 0; y < tile_size; ++y)
+        {
+            memcpy(target_frame->frameDataAtPos(tile.x(), tile.y() + y),
+                   data + row_size * static_cast<size_t>(y), row_size);
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoDecoderZstd::decodeMotionLayer(
+    const proto::MotionLayer& motion_layer, Frame* target_frame)
+{
+    const Rect layer_rect = parseRect(motion_layer.rect());
+
+    if (layer_rect.isEmpty() || !Rect::makeSize(target_frame->size()).containsRect(layer_rect))
+    {
+        LOG(LS_ERROR) << "The motion layer is outside the screen area";
+        return false;
+    }
+
+    const proto::VideoPacket& layer_packet = motion_layer.packet();
+
+    if (layer_packet.encoding() != proto::VIDEO_ENCODING_VP8)
+    {
+        LOG(LS_ERROR) << "Unsupported motion layer encoding: " << layer_packet.encoding();
+        return false;
+    }
+
+    if (layer_packet.has_format())
+    {
+        const Size layer_size(layer_packet.format().video_rect().width(),
+                              layer_packet.format().video_rect().height());
+
+        // The layer is never larger than the area it covers.
+        if (layer_size.isEmpty() || layer_size.width() > layer_rect.width() ||
+            layer_size.height() > layer_rect.height())
+        {
+            LOG(LS_ERROR) << "Invalid motion layer size: " << layer_size;
+            return false;
+        }
+
+        motion_frame_ = FrameAligned::create(layer_size, PixelFormat::ARGB(), 32);
+        motion_decoder_ = VideoDecoderVPX::createVP8();
+    }
+
+    if (!motion_decoder_ || !motion_frame_)
+    {
+        LOG(LS_ERROR) << "A motion layer with image information was not received";
+        return false;
+    }
+
+    if (!motion_decoder_->decode(layer_packet, motion_frame_.get()))
+    {
+        motion_decoder_.reset();
+        motion_frame_.reset();
+        return false;
+    }
+
+    libyuv::ARGBScale(motion_frame_->frameData(),
+                      motion_frame_->stride(),
+                      motion_frame_->size().width(),
+                      motion_frame_->size().height(),
+                      target_frame->frameDataAtPos(layer_rect.topLeft()),
+                      target_frame->stride(),
+                      layer_rect.width(),
+                      layer_rect.height(),
+                      libyuv::kFilterBilinear);
     return true;
 }
 
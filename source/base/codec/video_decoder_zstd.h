@@ -23,9 +23,13 @@
 #include "base/codec/scoped_zstd_stream.h"
 #include "base/codec/video_decoder.h"
 
+#include <vector>
+
 namespace base {
 
+class ParallelRunner;
 class PixelTranslator;
+class VideoDecoderVPX;
 
 class VideoDecoderZstd final : public VideoDecoder
 {
@@ -39,10 +43,32 @@ public:
 private:
     VideoDecoderZstd();
 
+    bool decodeRects(ZSTD_DStream* stream, bool new_stream, const proto::VideoPacket& packet,
+                     int first_rect, int rect_count, const uint8_t* data, size_t data_size,
+                     Frame* target_frame);
+    bool decodeStream(const proto::VideoPacket& packet, Frame* target_frame);
+    bool decodeTiles(const proto::VideoPacket& packet, Frame* target_frame);
+    bool applyTileCache(const proto::VideoPacket& packet, Frame* target_frame);
+    bool decodeMotionLayer(const proto::MotionLayer& motion_layer, Frame* target_frame);
+
     ScopedZstdDStream stream_;
+
+    // True if |stream_| contains the history of a persistent stream (VideoPacket.stream).
+    bool stream_started_ = false;
+
+    // Created when the first packet with tiles is received.
+    std::unique_ptr<ParallelRunner> tile_runner_;
+    std::vector<ScopedZstdDStream> tile_streams_;
+
+    // Pixels of the tile cache by slot. The host decides which slots are used.
+    std::vector<std::unique_ptr<uint8_t[]>> tile_cache_;
     std::unique_ptr<PixelTranslator> translator_;
     std::unique_ptr<Frame> source_frame_;
 
+    // The motion layer is decoded at its own size and scaled into the target frame.
+    std::unique_ptr<VideoDecoderVPX> motion_decoder_;
+    std::unique_ptr<Frame> motion_frame_;
+
     DISALLOW_COPY_AND_ASSIGN(VideoDecoderZstd);
 };
 
@@ -33,6 +33,13 @@ VideoEncoder::VideoEncoder(proto::VideoEncoding encoding)
     encode_buffer_.reserve(kInitialEncodeBufferSize);
 }
 
+//--------------------------------------------------------------------------------------------------
+void VideoEncoder::setFormatRequired()
+{
+    last_size_ = Size();
+    key_frame_required_ = true;
+}
+
 //--------------------------------------------------------------------------------------------------
 void VideoEncoder::fillPacketInfo(const Frame* frame, proto::VideoPacket* packet)
 {
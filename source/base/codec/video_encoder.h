@@ -38,6 +38,10 @@ public:
 
     void setKeyFrameRequired(bool enable) { key_frame_required_ = enable; }
     bool isKeyFrameRequired() const { return key_frame_required_; }
+
+    // The next packet contains the format and a key frame, so a decoder that has not received the
+    // previous packets can decode it.
+    void setFormatRequired();
     void setEncodeBuffer(std::string&& buffer) { encode_buffer_ = std::move(buffer); }
 
     proto::VideoEncoding encoding() const { return encoding_; }
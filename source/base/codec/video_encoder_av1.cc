@@ -0,0 +1,390 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_av1.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+#include <libyuv/convert.h>
+
+#include <cstring>
+#include <thread>
+
+namespace base {
+
+namespace {
+
+const std::chrono::milliseconds kTargetFrameInterval{ 80 };
+
+// The encoder reads the source image in superblocks of up to 128x128 pixels, so the planes are
+// padded to this size.
+const int kSuperBlockSize = 128;
+
+// Lower values give better compression at the cost of more CPU time. The realtime mode supports
+// values from 5 to 10.
+const int kCpuUsed = 7;
+
+// Magic encoder constant for adaptive quantization strategy.
+const int kAqModeCyclicRefresh = 3;
+
+// The loop filter and CDEF of AV1 change up to 8 pixels around the changed area.
+const int kActiveMapPadding = 8;
+
+//--------------------------------------------------------------------------------------------------
+void setCodecParameters(aom_codec_enc_cfg_t* config, const Size& size)
+{
+    // Use microsecond granularity time base.
+    config->g_timebase.num = 1;
+    config->g_timebase.den = static_cast<int>(
+        std::chrono::microseconds(std::chrono::seconds(1)).count());
+
+    config->g_w = static_cast<unsigned int>(size.width());
+    config->g_h = static_cast<unsigned int>(size.height());
+    config->g_pass = AOM_RC_ONE_PASS;
+
+    // Start emitting packets immediately.
+    config->g_lag_in_frames = 0;
+
+    // Since the transport layer is reliable, keyframes are not necessary. The encoder is created
+    // again when the client needs a full frame.
+    config->kf_mode = AOM_KF_DISABLED;
+
+    config->g_threads = (std::thread::hardware_concurrency() + 1) / 2;
+
+    // Do not drop any frames at encoder.
+    config->rc_dropframe_thresh = 0;
+
+    // We do not want variations in bandwidth.
+    config->rc_end_usage = AOM_VBR;
+    config->rc_undershoot_pct = 100;
+    config->rc_overshoot_pct = 15;
+
+    config->rc_min_quantizer = 10;
+    config->rc_max_quantizer = 40;
+
+    // In the absence of a good bandwidth estimator set the target bitrate to a conservative
+    // default.
+    config->rc_target_bitrate = 1000;
+}
+
+//--------------------------------------------------------------------------------------------------
+void createImage(const Size& size,
+                 std::unique_ptr<aom_image_t>* out_image,
+                 ByteArray* out_image_buffer)
+{
+    std::unique_ptr<aom_image_t> image = std::make_unique<aom_image_t>();
+
+    memset(image.get(), 0, sizeof(aom_image_t));
+
+    image->d_w = image->w = static_cast<unsigned int>(size.width());
+    image->d_h = image->h = static_cast<unsigned int>(size.height());
+
+    image->fmt = AOM_IMG_FMT_I420;
+    image->bit_depth = 8;
+    image->x_chroma_shift = 1;
+    image->y_chroma_shift = 1;
+    image->cp = AOM_CICP_CP_UNSPECIFIED;
+    image->tc = AOM_CICP_TC_UNSPECIFIED;
+    image->mc = AOM_CICP_MC_UNSPECIFIED;
+
+    // libyuv's fast-path requires 16-byte aligned pointers and strides, so pad the Y, U and V
+    // planes' strides to multiples of 16 bytes.
+    const int y_stride = ((image->w - 1) & ~15) + 16;
+    const int uv_unaligned_stride = y_stride >> image->x_chroma_shift;
+    const int uv_stride = ((uv_unaligned_stride - 1) & ~15) + 16;
+
+    const int y_rows = ((image->h - 1) & ~(kSuperBlockSize - 1)) + kSuperBlockSize;
+    const int uv_rows = y_rows >> image->y_chroma_shift;
+
+    ByteArray image_buffer;
+
+    // Allocate a YUV buffer large enough for the aligned data & padding.
+    image_buffer.resize(static_cast<size_t>(y_stride * y_rows + (2 * uv_stride) * uv_rows));
+
+    // Reset image value to 128 so we just need to fill in the y plane.
+    memset(image_buffer.data(), 128, image_buffer.size());
+
+    // Fill in the information.
+    image->planes[AOM_PLANE_Y] = image_buffer.data();
+    image->planes[AOM_PLANE_U] = image->planes[AOM_PLANE_Y] + y_stride * y_rows;
+    image->planes[AOM_PLANE_V] = image->planes[AOM_PLANE_U] + uv_stride * uv_rows;
+
+    image->stride[AOM_PLANE_Y] = y_stride;
+    image->stride[AOM_PLANE_U] = image->stride[AOM_PLANE_V] = uv_stride;
+
+    *out_image = std::move(image);
+    *out_image_buffer = std::move(image_buffer);
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// static
+std::unique_ptr<VideoEncoderAV1> VideoEncoderAV1::create()
+{
+    return std::unique_ptr<VideoEncoderAV1>(new VideoEncoderAV1());
+}
+
+//--------------------------------------------------------------------------------------------------
+VideoEncoderAV1::VideoEncoderAV1()
+    : VideoEncoder(proto::VIDEO_ENCODING_AV1)
+{
+    memset(&config_, 0, sizeof(config_));
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoEncoderAV1::encode(const Frame* frame, proto::VideoPacket* packet)
+{
+    fillPacketInfo(frame, packet);
+
+    bool is_key_frame = isKeyFrameRequired();
+
+    if (packet->has_format())
+    {
+        const Size& frame_size = frame->size();
+
+        createImage(frame_size, &image_, &image_buffer_);
+        active_map_.resize(frame_size);
+
+        if (!createCodec(frame_size))
+        {
+            LOG(LS_ERROR) << "Unable to create AV1 codec";
+            codec_.reset();
+            return false;
+        }
+
+        pts_ = 0;
+        is_key_frame = true;
+    }
+
+    if (!codec_)
+    {
+        LOG(LS_ERROR) << "AV1 codec not created";
+        return false;
+    }
+
+    // Convert the updated capture data ready for encode.
+    // Update active map based on updated region.
+    prepareImageAndActiveMap(is_key_frame, frame, packet);
+
+    aom_active_map_t active_map;
+    active_map.active_map = active_map_.data();
+    active_map.cols = active_map_.columns();
+    active_map.rows = active_map_.rows();
+
+    // Apply active map to the encoder.
+    aom_codec_err_t ret = aom_codec_control(codec_.get(), AOME_SET_ACTIVEMAP, &active_map);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_control(AOME_SET_ACTIVEMAP) failed: " << ret;
+        return false;
+    }
+
+    const unsigned long duration = static_cast<unsigned long>(
+        std::chrono::microseconds(kTargetFrameInterval).count());
+
+    // Do the actual encoding.
+    ret = aom_codec_encode(codec_.get(), image_.get(), pts_, duration, 0);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_encode failed: " << ret;
+        return false;
+    }
+
+    pts_ += duration;
+
+    // Read the encoded data.
+    aom_codec_iter_t iter = nullptr;
+
+    while (true)
+    {
+        const aom_codec_cx_pkt_t* pkt = aom_codec_get_cx_data(codec_.get(), &iter);
+        if (!pkt)
+            break;
+
+        if (pkt->kind == AOM_CODEC_CX_FRAME_PKT)
+        {
+            std::string* encode_buffer = encodeBuffer();
+            size_t frame_size = pkt->data.frame.sz;
+
+            encode_buffer->resize(frame_size);
+            memcpy(encode_buffer->data(), pkt->data.frame.buf, frame_size);
+
+            packet->set_data(std::move(*encode_buffer));
+            break;
+        }
+    }
+
+    setKeyFrameRequired(false);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoEncoderAV1::createCodec(const Size& size)
+{
+    // Configure the encoder.
+    aom_codec_iface_t* algo = aom_codec_av1_cx();
+
+    aom_codec_err_t ret = aom_codec_enc_config_default(algo, &config_, AOM_USAGE_REALTIME);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_enc_config_default failed: " << ret;
+        return false;
+    }
+
+    setCodecParameters(&config_, size);
+
+    std::unique_ptr<aom_codec_ctx_t> codec = std::make_unique<aom_codec_ctx_t>();
+
+    ret = aom_codec_enc_init(codec.get(), algo, &config_, 0);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_enc_init failed: " << ret;
+        return false;
+    }
+
+    codec_.reset(codec.release());
+
+    ret = aom_codec_control(codec_.get(), AOME_SET_CPUUSED, kCpuUsed);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_control(AOME_SET_CPUUSED) failed: " << ret;
+        return false;
+    }
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_TUNE_CONTENT, AOM_CONTENT_SCREEN);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_control(AV1E_SET_TUNE_CONTENT) failed: " << ret;
+        return false;
+    }
+
+    // Palette mode and intra block copy are the screen content tools of AV1. They give the best
+    // gain for text and user interface elements.
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ENABLE_PALETTE, 1);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_control(AV1E_SET_ENABLE_PALETTE) failed: " << ret;
+        return false;
+    }
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ENABLE_INTRABC, 1);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_control(AV1E_SET_ENABLE_INTRABC) failed: " << ret;
+        return false;
+    }
+
+    // Set cyclic refresh (aka "top-off") only for lossy encoding.
+    ret = aom_codec_control(codec_.get(), AV1E_SET_AQ_MODE, kAqModeCyclicRefresh);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_control(AV1E_SET_AQ_MODE) failed: " << ret;
+        return false;
+    }
+
+    // Use the lowest level of noise sensitivity so as to spend less time on motion estimation and
+    // inter-prediction mode.
+    ret = aom_codec_control(codec_.get(), AV1E_SET_NOISE_SENSITIVITY, 0);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_control(AV1E_SET_NOISE_SENSITIVITY) failed: " << ret;
+        return false;
+    }
+
+    // Encode rows of superblocks in parallel.
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ROW_MT, 1);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_control(AV1E_SET_ROW_MT) failed: " << ret;
+        return false;
+    }
+
+    // Global and warped motion are tools for natural video. They cost CPU time without a gain for
+    // the screen.
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ENABLE_GLOBAL_MOTION, 0);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_control(AV1E_SET_ENABLE_GLOBAL_MOTION) failed: " << ret;
+        return false;
+    }
+
+    ret = aom_codec_control(codec_.get(), AV1E_SET_ENABLE_WARPED_MOTION, 0);
+    if (ret != AOM_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "aom_codec_control(AV1E_SET_ENABLE_WARPED_MOTION) failed: " << ret;
+        return false;
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void VideoEncoderAV1::prepareImageAndActiveMap(
+    bool is_key_frame, const Frame* frame, proto::VideoPacket* packet)
+{
+    Rect image_rect = Rect::makeWH(static_cast<int32_t>(image_->w), static_cast<int32_t>(image_->h));
+    Region updated_region;
+
+    if (!is_key_frame)
+    {
+        updated_region =
+            ActiveMap::paddedRegion(frame->constUpdatedRegion(), kActiveMapPadding, image_rect);
+    }
+    else
+    {
+        updated_region = Region(image_rect);
+    }
+
+    active_map_.clear();
+
+    const int y_stride = image_->stride[AOM_PLANE_Y];
+    const int uv_stride = image_->stride[AOM_PLANE_U];
+    uint8_t* y_data = image_->planes[AOM_PLANE_Y];
+    uint8_t* u_data = image_->planes[AOM_PLANE_U];
+    uint8_t* v_data = image_->planes[AOM_PLANE_V];
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        Rect rect = it.rect();
+
+        const int y_offset = y_stride * rect.y() + rect.x();
+        const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+        const int width = rect.width();
+        const int height = rect.height();
+
+        libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           y_data + y_offset, y_stride,
+                           u_data + uv_offset, uv_stride,
+                           v_data + uv_offset, uv_stride,
+                           width,
+                           height);
+
+        active_map_.addRect(rect);
+
+        proto::Rect* dirty_rect = packet->add_dirty_rect();
+        dirty_rect->set_x(rect.x());
+        dirty_rect->set_y(rect.y());
+        dirty_rect->set_width(width);
+        dirty_rect->set_height(height);
+    }
+}
+
+} // namespace base
@@ -0,0 +1,67 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_CODEC_VIDEO_ENCODER_AV1_H
+#define BASE_CODEC_VIDEO_ENCODER_AV1_H
+
+#include "base/macros_magic.h"
+#include "base/codec/active_map.h"
+#include "base/codec/scoped_aom_codec.h"
+#include "base/codec/video_encoder.h"
+#include "base/memory/byte_array.h"
+
+#include <aom/aom_encoder.h>
+#include <aom/aomcx.h>
+
+namespace base {
+
+// Encodes the screen with the libaom AV1 encoder in the realtime mode. The screen content tools of
+// AV1 (palette and intra block copy) are enabled.
+class VideoEncoderAV1 final : public VideoEncoder
+{
+public:
+    ~VideoEncoderAV1() final = default;
+
+    static std::unique_ptr<VideoEncoderAV1> create();
+
+    bool encode(const Frame* frame, proto::VideoPacket* packet) final;
+
+private:
+    VideoEncoderAV1();
+
+    bool createCodec(const Size& size);
+    void prepareImageAndActiveMap(bool is_key_frame, const Frame* frame, proto::VideoPacket* packet);
+
+    aom_codec_enc_cfg_t config_;
+    ScopedAomCodec codec_;
+
+    ActiveMap active_map_;
+
+    // AOM image and buffer to hold the actual YUV planes.
+    std::unique_ptr<aom_image_t> image_;
+    ByteArray image_buffer_;
+
+    // Presentation time of the next frame. The encoder requires it to increase.
+    aom_codec_pts_t pts_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderAV1);
+};
+
+} // namespace base
+
+#endif // BASE_CODEC_VIDEO_ENCODER_AV1_H
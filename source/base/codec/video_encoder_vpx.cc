@@ -127,23 +127,6 @@ void createImage(const Size& size,
     *out_image_buffer = std::move(image_buffer);
 }
 
-//--------------------------------------------------------------------------------------------------
-int roundToTwosMultiple(int x)
-{
-    return x & (~1);
-}
-
-//--------------------------------------------------------------------------------------------------
-Rect alignRect(const Rect& rect)
-{
-    int x = roundToTwosMultiple(rect.left());
-    int y = roundToTwosMultiple(rect.top());
-    int right = roundToTwosMultiple(rect.right() + 1);
-    int bottom = roundToTwosMultiple(rect.bottom() + 1);
-
-    return Rect::makeLTRB(x, y, right, bottom);
-}
-
 } // namespace
 
 //--------------------------------------------------------------------------------------------------
@@ -165,7 +148,6 @@ VideoEncoderVPX::VideoEncoderVPX(proto::VideoEncoding encoding)
     : VideoEncoder(encoding)
 {
     memset(&config_, 0, sizeof(config_));
-    memset(&active_map_, 0, sizeof(active_map_));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -180,7 +162,7 @@ bool VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
         const Size& frame_size = frame->size();
 
         createImage(frame_size, &image_, &image_buffer_);
-        createActiveMap(frame_size);
+        active_map_.resize(frame_size);
 
         if (encoding() == proto::VIDEO_ENCODING_VP8)
         {
@@ -208,8 +190,13 @@ bool VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
     // Update active map based on updated region.
     prepareImageAndActiveMap(is_key_frame, frame, packet);
 
+    vpx_active_map_t active_map;
+    active_map.active_map = active_map_.data();
+    active_map.cols = active_map_.columns();
+    active_map.rows = active_map_.rows();
+
     // Apply active map to the encoder.
-    vpx_codec_err_t ret = vpx_codec_control(codec_.get(), VP8E_SET_ACTIVEMAP, &active_map_);
+    vpx_codec_err_t ret = vpx_codec_control(codec_.get(), VP8E_SET_ACTIVEMAP, &active_map);
     if (ret != VPX_CODEC_OK)
     {
         LOG(LS_ERROR) << "vpx_codec_control(VP8E_SET_ACTIVEMAP) failed: " << ret;
@@ -343,20 +330,6 @@ uint32_t VideoEncoderVPX::maxQuantizer() const
     return config_.rc_max_quantizer;
 }
 
-//--------------------------------------------------------------------------------------------------
-void VideoEncoderVPX::createActiveMap(const Size& size)
-{
-    active_map_.cols = static_cast<unsigned int>(
-        (size.width() + kMacroBlockSize - 1) / kMacroBlockSize);
-    active_map_.rows = static_cast<unsigned int>(
-        (size.height() + kMacroBlockSize - 1) / kMacroBlockSize);
-
-    active_map_buffer_.resize(active_map_.cols * active_map_.rows);
-    active_map_.active_map = active_map_buffer_.data();
-
-    clearActiveMap();
-}
-
 //--------------------------------------------------------------------------------------------------
 bool VideoEncoderVPX::createVp8Codec(const Size& size)
 {
@@ -506,35 +479,16 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
 
     if (!is_key_frame)
     {
+        // VP9 includes up to 8px either side, and VP8 up to 3px.
         const int padding = ((encoding() == proto::VIDEO_ENCODING_VP9) ? 8 : 3);
-
-        for (Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
-        {
-            Rect rect = it.rect();
-
-            // Pad each rectangle to avoid the block-artefact filters in libvpx from introducing
-            // artefacts; VP9 includes up to 8px either side, and VP8 up to 3px, so unchanged
-            // pixels up to that far out may still be affected by the changes in the updated
-            // region, and so must be listed in the active map. After padding we align each
-            // rectangle to 16x16 active-map macroblocks. This implicitly ensures all rects have
-            // even top-left coords, which is is required by ARGBToI420().
-            updated_region.addRect(
-                alignRect(Rect::makeLTRB(
-                    rect.left() - padding, rect.top() - padding,
-                    rect.right() + padding, rect.bottom() + padding)));
-        }
-
-        // Clip back to the screen dimensions, in case they're not macroblock aligned.
-        // The conversion routines don't require even width & height, so this is safe even if the
-        // source dimensions are not even.
-        updated_region.intersectWith(image_rect);
+        updated_region = ActiveMap::paddedRegion(frame->constUpdatedRegion(), padding, image_rect);
     }
     else
     {
         updated_region = Region(image_rect);
     }
 
-    clearActiveMap();
+    active_map_.clear();
 
     const int y_stride = image_->stride[0];
     const int uv_stride = image_->stride[1];
@@ -559,7 +513,7 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
                            width,
                            height);
 
-        addRectToActiveMap(rect);
+        active_map_.addRect(rect);
 
         proto::Rect* dirty_rect = packet->add_dirty_rect();
         dirty_rect->set_x(rect.x());
@@ -569,29 +523,4 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
     }
 }
 
-//--------------------------------------------------------------------------------------------------
-void VideoEncoderVPX::addRectToActiveMap(const Rect& rect)
-{
-    int left = rect.left() / kMacroBlockSize;
-    int top = rect.top() / kMacroBlockSize;
-    int right = (rect.right() - 1) / kMacroBlockSize;
-    int bottom = (rect.bottom() - 1) / kMacroBlockSize;
-
-    uint8_t* map = active_map_.active_map + static_cast<uint32_t>(top) * active_map_.cols;
-
-    for (int y = top; y <= bottom; ++y)
-    {
-        for (int x = left; x <= right; ++x)
-            map[x] = 1;
-
-        map += active_map_.cols;
-    }
-}
-
-//--------------------------------------------------------------------------------------------------
-void VideoEncoderVPX::clearActiveMap()
-{
-    memset(active_map_buffer_.data(), 0, active_map_buffer_.size());
-}
-
 } // namespace base
@@ -20,6 +20,7 @@
 #define BASE_CODEC_VIDEO_ENCODER_VPX_H
 
 #include "base/macros_magic.h"
+#include "base/codec/active_map.h"
 #include "base/codec/scoped_vpx_codec.h"
 #include "base/codec/video_encoder.h"
 #include "base/desktop/region.h"
@@ -49,18 +50,14 @@ public:
 private:
     explicit VideoEncoderVPX(proto::VideoEncoding encoding);
 
-    void createActiveMap(const Size& size);
     bool createVp8Codec(const Size& size);
     bool createVp9Codec(const Size& size);
     void prepareImageAndActiveMap(bool is_key_frame, const Frame* frame, proto::VideoPacket* packet);
-    void addRectToActiveMap(const Rect& rect);
-    void clearActiveMap();
 
     vpx_codec_enc_cfg_t config_;
     ScopedVpxCodec codec_;
 
-    ByteArray active_map_buffer_;
-    vpx_active_map_t active_map_;
+    ActiveMap active_map_;
 
     // VPX image and buffer to hold the actual YUV planes.
     std::unique_ptr<vpx_image_t> image_;
@@ -18,14 +18,44 @@
 
 #include "base/codec/video_encoder_zstd.h"
 
+#include "base/cpuid_util.h"
 #include "base/logging.h"
 #include "base/codec/pixel_translator.h"
-#include "base/desktop/frame.h"
+#include "base/codec/tile_cache.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/desktop/frame_aligned.h"
+#include "base/desktop/hash_block_32bpp.h"
+#include "base/desktop/video_region_detector.h"
+#include "base/threading/parallel_runner.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <libyuv/scale_argb.h>
 
 namespace base {
 
 namespace {
 
+// Size of the side of a tile in pixels. Smaller tiles give more parallelism, but compress worse.
+const int kTileSize = 256;
+
+// If the persistent stream is enabled, smaller updates are compressed with the history of the
+// stream instead of splitting them into tiles.
+const int64_t kMinTiledArea = 4 * kTileSize * kTileSize;
+
+// Number of slots in the tile cache of the client (16 MB for 32 bits per pixel).
+const size_t kTileCacheSlots = 1024;
+
+// The motion layer is encoded with the width and height divided by this value.
+const int kMotionLayerDivider = 2;
+
+// Minimum width and height of the encoded motion layer.
+const int kMinMotionLayerSize = 16;
+
+// The window of the persistent stream (16 MB). The decoder accepts windows up to 128 MB by default.
+const int kStreamWindowLog = 24;
+
 //--------------------------------------------------------------------------------------------------
 // Retrieves a pointer to the output buffer in |update| used for storing the
 // encoded rectangle data. Will resize the buffer to |size|.
@@ -128,11 +158,230 @@ bool VideoEncoderZstd::compressPacket(
     return true;
 }
 
+//--------------------------------------------------------------------------------------------------
+bool VideoEncoderZstd::compressStream(
+    const uint8_t* input_data, size_t input_size, std::string* output_buffer)
+{
+    size_t ret;
+
+    if (!stream_started_)
+    {
+        ret = ZSTD_CCtx_reset(stream_.get(), ZSTD_reset_session_and_parameters);
+        if (!ZSTD_isError(ret))
+            ret = ZSTD_CCtx_setParameter(stream_.get(), ZSTD_c_compressionLevel, compress_ratio_);
+        if (!ZSTD_isError(ret))
+            ret = ZSTD_CCtx_setParameter(stream_.get(), ZSTD_c_windowLog, kStreamWindowLog);
+
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "Unable to start stream: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        stream_started_ = true;
+    }
+
+    // The flush can add block headers, so the buffer grows if the bound is not enough.
+    size_t output_size = ZSTD_compressBound(input_size);
+    uint8_t* output_data = outputBuffer(output_buffer, output_size);
+
+    ZSTD_inBuffer input = { input_data, input_size, 0 };
+    ZSTD_outBuffer output = { output_data, output_size, 0 };
+
+    for (;;)
+    {
+        ret = ZSTD_compressStream2(stream_.get(), &output, &input, ZSTD_e_flush);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "ZSTD_compressStream2 failed: " << ZSTD_getErrorName(ret);
+            stream_started_ = false;
+            return false;
+        }
+
+        // All input is consumed and flushed into the packet.
+        if (ret == 0)
+            break;
+
+        if (output.pos == output.size)
+        {
+            output_size += ZSTD_CStreamOutSize();
+            output.dst = outputBuffer(output_buffer, output_size);
+            output.size = output_size;
+        }
+    }
+
+    output_buffer->resize(output.pos);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoEncoderZstd::isTiledUpdate() const
+{
+    if (!tiles_enabled_)
+        return false;
+
+    if (!persistent_stream_)
+        return true;
+
+    int64_t area = 0;
+
+    for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        area += static_cast<int64_t>(rect.width()) * rect.height();
+    }
+
+    return area >= kMinTiledArea;
+}
+
+//--------------------------------------------------------------------------------------------------
+void VideoEncoderZstd::findCachedTiles(const Frame* frame, proto::VideoPacket* packet)
+{
+    const int tile_size = TileCache::kTileSize;
+    const Rect frame_rect = Rect::makeSize(frame->size());
+
+    Rect bounds;
+    for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+        bounds.unionWith(it.rect());
+
+    tile_cache_->startPacket();
+
+    Region cached_region;
+
+    for (int y = bounds.top() - bounds.top() % tile_size; y < bounds.bottom(); y += tile_size)
+    {
+        for (int x = bounds.left() - bounds.left() % tile_size; x < bounds.right(); x += tile_size)
+        {
+            const Rect tile_rect = Rect::makeXYWH(x, y, tile_size, tile_size);
+            if (!frame_rect.containsRect(tile_rect))
+                continue;
+
+            // Only tiles that are changed completely are cached.
+            Region tile_region(tile_rect);
+            tile_region.intersectWith(updated_region_);
+            if (!tile_region.equals(Region(tile_rect)))
+                continue;
+
+            const uint64_t hash = hash_block_func_(
+                frame->frameDataAtPos(x, y), frame->stride(), tile_size, tile_size);
+
+            proto::CachedTile* cached_tile;
+
+            std::optional<uint32_t> slot = tile_cache_->find(hash);
+            if (slot.has_value())
+            {
+                cached_tile = packet->add_cached_tile();
+                cached_region.addRect(tile_rect);
+            }
+            else
+            {
+                // The tile is sent as pixels and the client stores it.
+                slot = tile_cache_->add(hash);
+                if (!slot.has_value())
+                    continue;
+
+                cached_tile = packet->add_cache_store();
+            }
+
+            cached_tile->set_slot(*slot);
+            cached_tile->set_x(x);
+            cached_tile->set_y(y);
+        }
+    }
+
+    updated_region_.subtract(cached_region);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoEncoderZstd::encodeMotionLayer(const Frame* frame, proto::VideoPacket* packet)
+{
+    // The detector gets the real changes of the frame, even if the whole frame is sent.
+    const Rect layer_rect = video_region_detector_->detect(*frame, frame->constUpdatedRegion());
+
+    if (!layer_rect.equals(motion_rect_))
+    {
+        // The previous area is lossy on the client. It is sent again without losses.
+        if (!motion_rect_.isEmpty())
+            updated_region_.addRect(motion_rect_);
+
+        // The size of the VP8 stream can not be changed.
+        if (layer_rect.size() != motion_rect_.size())
+            motion_encoder_.reset();
+
+        motion_rect_ = layer_rect;
+    }
+
+    if (motion_rect_.isEmpty())
+    {
+        motion_frame_.reset();
+        return true;
+    }
+
+    // The layer is never larger than the area it covers, which the decoder checks.
+    const Size layer_size(
+        std::min(std::max(motion_rect_.width() / kMotionLayerDivider, kMinMotionLayerSize),
+                 motion_rect_.width()),
+        std::min(std::max(motion_rect_.height() / kMotionLayerDivider, kMinMotionLayerSize),
+                 motion_rect_.height()));
+
+    if (!motion_frame_ || motion_frame_->size() != layer_size)
+        motion_frame_ = FrameAligned::create(layer_size, PixelFormat::ARGB(), 32);
+
+    libyuv::ARGBScale(frame->frameDataAtPos(motion_rect_.topLeft()),
+                      frame->stride(),
+                      motion_rect_.width(),
+                      motion_rect_.height(),
+                      motion_frame_->frameData(),
+                      motion_frame_->stride(),
+                      layer_size.width(),
+                      layer_size.height(),
+                      libyuv::kFilterBox);
+
+    motion_frame_->updatedRegion()->setRect(Rect::makeSize(layer_size));
+
+    if (!motion_encoder_)
+    {
+        LOG(LS_INFO) << "Motion layer: " << motion_rect_.width() << "x" << motion_rect_.height()
+                     << " encoded as " << layer_size.width() << "x" << layer_size.height();
+
+        motion_encoder_ = VideoEncoderVPX::createVP8();
+    }
+
+    proto::MotionLayer* motion_layer = packet->mutable_motion_layer();
+    serializeRect(motion_rect_, motion_layer->mutable_rect());
+
+    if (!motion_encoder_->encode(motion_frame_.get(), motion_layer->mutable_packet()))
+    {
+        motion_encoder_.reset();
+        return false;
+    }
+
+    updated_region_.subtract(motion_rect_);
+    return true;
+}
+
 //--------------------------------------------------------------------------------------------------
 bool VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
 {
     fillPacketInfo(frame, packet);
 
+    // The client may have no history for the stream (for example, after a change of the screen
+    // size).
+    if (packet->has_format() || isKeyFrameRequired())
+    {
+        stream_started_ = false;
+
+        if (tile_cache_)
+        {
+            tile_cache_->clear();
+            packet->set_tile_cache_size(static_cast<uint32_t>(tile_cache_->slotCount()));
+        }
+
+        // The client creates a new decoder for the motion layer.
+        motion_encoder_.reset();
+        motion_rect_ = Rect();
+    }
+
     if (packet->has_format())
     {
         LOG(LS_INFO) << "Has packet format";
@@ -152,6 +401,47 @@ bool VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
         }
     }
 
+    if (move_detector_)
+    {
+        if (packet->has_format() || isKeyFrameRequired())
+        {
+            // The whole frame is sent. The client has nothing to copy from.
+            move_detector_->update(*frame, updated_region_);
+        }
+        else
+        {
+            move_detector_->detect(*frame, &updated_region_, &moves_);
+
+            for (const auto& move : moves_)
+            {
+                // The area of the motion layer is lossy on the client, so it is not copied.
+                Rect source_rect = move.source_rect;
+                source_rect.intersectWith(motion_rect_);
+                if (!source_rect.isEmpty())
+                {
+                    updated_region_.addRect(
+                        Rect::makeXYWH(move.dest_pos, move.source_rect.size()));
+                    continue;
+                }
+
+                proto::CopyRect* copy_rect = packet->add_copy_rect();
+                serializeRect(move.source_rect, copy_rect->mutable_source_rect());
+                copy_rect->set_dest_x(move.dest_pos.x());
+                copy_rect->set_dest_y(move.dest_pos.y());
+            }
+        }
+    }
+
+    if (video_region_detector_ && !encodeMotionLayer(frame, packet))
+    {
+        LOG(LS_ERROR) << "Unable to encode motion layer";
+        setKeyFrameRequired(true);
+        return false;
+    }
+
+    if (tile_cache_)
+        findCachedTiles(frame, packet);
+
     if (!translator_)
     {
         LOG(LS_INFO) << "Pixel translator not created yet";
@@ -164,6 +454,35 @@ bool VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
         }
     }
 
+    std::string* encode_buffer = encodeBuffer();
+
+    bool result;
+    if (isTiledUpdate())
+        result = encodeTiles(frame, packet, encode_buffer);
+    else
+        result = encodeRegion(frame, packet, encode_buffer);
+
+    if (!result)
+    {
+        LOG(LS_ERROR) << "Unable to encode frame";
+
+        // The move detector, the tile cache and the motion layer have already accepted this frame
+        // and the stream may contain a part of it, but the client will not receive it.
+        if (move_detector_ || persistent_stream_ || tile_cache_ || video_region_detector_)
+            setKeyFrameRequired(true);
+        return false;
+    }
+
+    packet->set_data(std::move(*encode_buffer));
+    setKeyFrameRequired(false);
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool VideoEncoderZstd::encodeRegion(
+    const Frame* frame, proto::VideoPacket* packet, std::string* output_buffer)
+{
     size_t data_size = 0;
 
     for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
@@ -173,45 +492,174 @@ bool VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
         serializeRect(rect, packet->add_dirty_rect());
     }
 
-    if (translate_buffer_size_ < data_size)
-    {
-        LOG(LS_INFO) << "Translate buffer too small. Resize from " << translate_buffer_size_
-                     << " to " << data_size;
+    uint8_t* translate_data = translateBuffer(data_size);
+    translateRegion(frame, updated_region_, translate_data);
 
-        translate_buffer_.reset(static_cast<uint8_t*>(base::alignedAlloc(data_size, 32)));
-        translate_buffer_size_ = data_size;
+    if (persistent_stream_)
+    {
+        packet->set_stream(stream_started_ ? proto::VIDEO_STREAM_CONTINUE
+                                           : proto::VIDEO_STREAM_START);
+        return compressStream(translate_data, data_size, output_buffer);
     }
 
-    uint8_t* translate_pos = translate_buffer_.get();
+    // Compress data with using Zstd compressor.
+    return compressPacket(translate_data, data_size, output_buffer);
+}
 
+//--------------------------------------------------------------------------------------------------
+bool VideoEncoderZstd::encodeTiles(
+    const Frame* frame, proto::VideoPacket* packet, std::string* output_buffer)
+{
+    Rect bounds;
     for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+        bounds.unionWith(it.rect());
+
+    size_t tile_count = 0;
+    size_t data_size = 0;
+
+    // The grid is fixed to the frame so that unchanged parts of the screen always get the same
+    // tiles.
+    const int start_x = bounds.left() - bounds.left() % kTileSize;
+    const int start_y = bounds.top() - bounds.top() % kTileSize;
+
+    for (int y = start_y; y < bounds.bottom(); y += kTileSize)
+    {
+        for (int x = start_x; x < bounds.right(); x += kTileSize)
+        {
+            Region region(Rect::makeXYWH(x, y, kTileSize, kTileSize));
+            region.intersectWith(updated_region_);
+            if (region.isEmpty())
+                continue;
+
+            if (tile_count >= tiles_.size())
+                tiles_.emplace_back();
+
+            Tile& tile = tiles_[tile_count++];
+            tile.region.swap(&region);
+            tile.offset = data_size;
+            tile.size = 0;
+
+            uint32_t rect_count = 0;
+
+            for (Region::Iterator it(tile.region); !it.isAtEnd(); it.advance())
+            {
+                const Rect& rect = it.rect();
+                tile.size += static_cast<size_t>(
+                    rect.width() * rect.height() * target_format_.bytesPerPixel());
+                serializeRect(rect, packet->add_dirty_rect());
+                ++rect_count;
+            }
+
+            packet->add_tile()->set_rect_count(rect_count);
+            data_size += tile.size;
+        }
+    }
+
+    prepareTileStreams();
+
+    uint8_t* translate_data = translateBuffer(data_size);
+
+    // Each tile is translated and compressed by a single thread into its own part of the translate
+    // buffer and its own output buffer.
+    tile_runner_->run(tile_count, [&](size_t index, int thread_index)
+    {
+        Tile& tile = tiles_[index];
+        uint8_t* input_data = translate_data + tile.offset;
+
+        translateRegion(frame, tile.region, input_data);
+
+        const size_t output_size = ZSTD_compressBound(tile.size);
+        uint8_t* output_data = outputBuffer(&tile.data, output_size);
+
+        size_t ret = ZSTD_compressCCtx(tile_streams_[static_cast<size_t>(thread_index)].get(),
+                                       output_data, output_size, input_data, tile.size,
+                                       compress_ratio_);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "ZSTD_compressCCtx failed: " << ZSTD_getErrorName(ret);
+            tile.result = false;
+            return;
+        }
+
+        tile.data.resize(ret);
+        tile.result = true;
+    });
+
+    size_t output_size = 0;
+
+    for (size_t i = 0; i < tile_count; ++i)
+    {
+        if (!tiles_[i].result)
+            return false;
+
+        output_size += tiles_[i].data.size();
+    }
+
+    uint8_t* output_data = outputBuffer(output_buffer, output_size);
+
+    for (size_t i = 0; i < tile_count; ++i)
+    {
+        const std::string& data = tiles_[i].data;
+
+        memcpy(output_data, data.data(), data.size());
+        output_data += data.size();
+
+        packet->mutable_tile(static_cast<int>(i))->set_data_size(
+            static_cast<uint32_t>(data.size()));
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void VideoEncoderZstd::prepareTileStreams()
+{
+    if (!tile_runner_)
+        tile_runner_ = std::make_shared<ParallelRunner>();
+
+    // Each thread of the runner has its own compression context.
+    const size_t thread_count = static_cast<size_t>(tile_runner_->threadCount());
+
+    while (tile_streams_.size() < thread_count)
+    {
+        tile_streams_.emplace_back();
+        tile_streams_.back().reset(ZSTD_createCCtx());
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void VideoEncoderZstd::translateRegion(
+    const Frame* frame, const Region& region, uint8_t* output) const
+{
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
     {
         const Rect& rect = it.rect();
         const int stride = rect.width() * target_format_.bytesPerPixel();
 
         translator_->translate(frame->frameDataAtPos(rect.topLeft()),
                                frame->stride(),
-                               translate_pos,
+                               output,
                                stride,
                                rect.width(),
                                rect.height());
 
-        translate_pos += rect.height() * stride;
+        output += rect.height() * stride;
     }
+}
 
-    std::string* encode_buffer = encodeBuffer();
-
-    // Compress data with using Zstd compressor.
-    if (!compressPacket(translate_buffer_.get(), data_size, encode_buffer))
+//--------------------------------------------------------------------------------------------------
+uint8_t* VideoEncoderZstd::translateBuffer(size_t size)
+{
+    if (translate_buffer_size_ < size)
     {
-        LOG(LS_ERROR) << "compressPacket failed";
-        return false;
-    }
+        LOG(LS_INFO) << "Translate buffer too small. Resize from " << translate_buffer_size_
+                     << " to " << size;
 
-    packet->set_data(std::move(*encode_buffer));
-    setKeyFrameRequired(false);
+        translate_buffer_.reset(static_cast<uint8_t*>(base::alignedAlloc(size, 32)));
+        translate_buffer_size_ = size;
+    }
 
-    return true;
+    return translate_buffer_.get();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -224,6 +672,9 @@ bool VideoEncoderZstd::setCompressRatio(int compression_ratio)
     }
 
     compress_ratio_ = compression_ratio;
+
+    // The compression level of the persistent stream is set when it starts.
+    stream_started_ = false;
     return true;
 }
 
@@ -233,4 +684,118 @@ int VideoEncoderZstd::compressRatio() const
     return compress_ratio_;
 }
 
+//--------------------------------------------------------------------------------------------------
+void VideoEncoderZstd::setMoveDetectionEnabled(bool enable)
+{
+    if (enable == (move_detector_ != nullptr))
+        return;
+
+    LOG(LS_INFO) << "Move detection enabled: " << enable;
+
+    if (enable)
+    {
+        move_detector_ = std::make_unique<MoveDetector>();
+
+        // The detector does not have the previous frame yet.
+        setKeyFrameRequired(true);
+    }
+    else
+    {
+        move_detector_.reset();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void VideoEncoderZstd::setTilesEnabled(bool enable)
+{
+    if (enable == tiles_enabled_)
+        return;
+
+    LOG(LS_INFO) << "Tiles enabled: " << enable;
+
+    tiles_enabled_ = enable;
+
+    if (!enable)
+    {
+        tile_streams_.clear();
+        tiles_.clear();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void VideoEncoderZstd::setTileRunner(std::shared_ptr<ParallelRunner> runner)
+{
+    tile_runner_ = std::move(runner);
+}
+
+//--------------------------------------------------------------------------------------------------
+void VideoEncoderZstd::setPersistentStreamEnabled(bool enable)
+{
+    if (enable == persistent_stream_)
+        return;
+
+    LOG(LS_INFO) << "Persistent stream enabled: " << enable;
+
+    persistent_stream_ = enable;
+    stream_started_ = false;
+
+    // The window size of the stream should not be used for separate packets.
+    ZSTD_CCtx_reset(stream_.get(), ZSTD_reset_session_and_parameters);
+}
+
+//--------------------------------------------------------------------------------------------------
+void VideoEncoderZstd::setTileCacheEnabled(bool enable)
+{
+    if (enable == (tile_cache_ != nullptr))
+        return;
+
+    LOG(LS_INFO) << "Tile cache enabled: " << enable;
+
+    if (enable)
+    {
+        tile_cache_ = std::make_unique<TileCache>(kTileCacheSlots);
+
+#if defined(ARCH_CPU_X86_64)
+        if (CpuidUtil::hasSse42())
+            hash_block_func_ = hashBlock_32bpp_SSE42;
+        else
+            hash_block_func_ = hashBlock_32bpp_C;
+#else
+        hash_block_func_ = hashBlock_32bpp_C;
+#endif // defined(ARCH_CPU_X86_64)
+
+        // The client has to reset its cache.
+        setKeyFrameRequired(true);
+    }
+    else
+    {
+        tile_cache_.reset();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void VideoEncoderZstd::setMotionLayerEnabled(bool enable)
+{
+    if (enable == (video_region_detector_ != nullptr))
+        return;
+
+    LOG(LS_INFO) << "Motion layer enabled: " << enable;
+
+    if (enable)
+    {
+        video_region_detector_ = std::make_unique<VideoRegionDetector>();
+    }
+    else
+    {
+        video_region_detector_.reset();
+        motion_encoder_.reset();
+        motion_frame_.reset();
+
+        // The area of the last layer is sent again without losses.
+        if (!motion_rect_.isEmpty())
+            setKeyFrameRequired(true);
+        motion_rect_ = Rect();
+    }
+}
+
 } // namespace base
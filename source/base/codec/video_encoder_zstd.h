@@ -23,12 +23,19 @@
 #include "base/memory/aligned_memory.h"
 #include "base/codec/scoped_zstd_stream.h"
 #include "base/codec/video_encoder.h"
+#include "base/desktop/move_detector.h"
 #include "base/desktop/region.h"
 #include "base/desktop/pixel_format.h"
 
+#include <vector>
+
 namespace base {
 
+class ParallelRunner;
 class PixelTranslator;
+class TileCache;
+class VideoEncoderVPX;
+class VideoRegionDetector;
 
 class VideoEncoderZstd final : public VideoEncoder
 {
@@ -43,17 +50,81 @@ public:
     bool setCompressRatio(int compression_ratio);
     int compressRatio() const;
 
+    // If enabled, moved areas of the screen are sent as VideoPacket.copy_rect instead of pixels.
+    // The client must support it.
+    void setMoveDetectionEnabled(bool enable);
+
+    // If enabled, the changed area is split into tiles that are compressed in parallel into
+    // independent streams (VideoPacket.tile). The client must support it.
+    void setTilesEnabled(bool enable);
+
+    // Sets the runner that compresses the tiles. Encoders that are never used at the same time may
+    // share one runner. If no runner is set, the encoder creates its own when tiles are used.
+    void setTileRunner(std::shared_ptr<ParallelRunner> runner);
+
+    // If enabled, the compression history is kept between packets (VideoPacket.stream), so the
+    // parts of the screen that were sent recently are compressed much better. Key frames start a
+    // new stream. The client must support it.
+    void setPersistentStreamEnabled(bool enable);
+
+    // If enabled, tiles of the changed area that the client has already received are sent as
+    // references to its tile cache (VideoPacket.cached_tile) instead of pixels. The client must
+    // support it.
+    void setTileCacheEnabled(bool enable);
+
+    // If enabled, the area of the screen that plays a video is encoded with VP8 at a reduced
+    // resolution (VideoPacket.motion_layer). The rest of the screen stays lossless. The client must
+    // support it.
+    void setMotionLayerEnabled(bool enable);
+
 private:
     VideoEncoderZstd(const PixelFormat& target_format, int compression_ratio);
     bool compressPacket(const uint8_t* input_data, size_t input_size, std::string* output_buffer);
+    bool compressStream(const uint8_t* input_data, size_t input_size, std::string* output_buffer);
+    bool isTiledUpdate() const;
+    void findCachedTiles(const Frame* frame, proto::VideoPacket* packet);
+    bool encodeMotionLayer(const Frame* frame, proto::VideoPacket* packet);
+    bool encodeRegion(const Frame* frame, proto::VideoPacket* packet, std::string* output_buffer);
+    bool encodeTiles(const Frame* frame, proto::VideoPacket* packet, std::string* output_buffer);
+    void prepareTileStreams();
+    void translateRegion(const Frame* frame, const Region& region, uint8_t* output) const;
+    uint8_t* translateBuffer(size_t size);
 
     Region updated_region_;
     PixelFormat target_format_;
     int compress_ratio_;
     ScopedZstdCStream stream_;
+    bool persistent_stream_ = false;
+    bool stream_started_ = false;
     std::unique_ptr<PixelTranslator> translator_;
     std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> translate_buffer_;
     size_t translate_buffer_size_ = 0;
+    std::unique_ptr<MoveDetector> move_detector_;
+    MoveDetector::Moves moves_;
+
+    struct Tile
+    {
+        Region region;
+        size_t offset = 0;
+        size_t size = 0;
+        std::string data;
+        bool result = false;
+    };
+
+    bool tiles_enabled_ = false;
+    std::shared_ptr<ParallelRunner> tile_runner_;
+    std::vector<ScopedZstdCStream> tile_streams_;
+    std::vector<Tile> tiles_;
+
+    typedef uint64_t(*HashBlockFunc)(const uint8_t*, int, int, int);
+
+    std::unique_ptr<TileCache> tile_cache_;
+    HashBlockFunc hash_block_func_ = nullptr;
+
+    std::unique_ptr<VideoRegionDetector> video_region_detector_;
+    std::unique_ptr<VideoEncoderVPX> motion_encoder_;
+    std::unique_ptr<Frame> motion_frame_;
+    Rect motion_rect_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderZstd);
 };
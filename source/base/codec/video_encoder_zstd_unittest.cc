@@ -0,0 +1,340 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_zstd.h"
+
+#include "base/codec/tile_cache.h"
+#include "base/codec/video_decoder_zstd.h"
+#include "base/desktop/frame_simple.h"
+#include "base/threading/parallel_runner.h"
+#include "proto/desktop.pb.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+
+namespace base {
+
+namespace {
+
+const Size kScreenSize(700, 530);
+
+void fillRandom(std::mt19937& random, Frame* frame, const Rect& rect)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+        for (int x = 0; x < rect.width() * 4; ++x)
+        {
+            // The alpha channel is not transferred.
+            row[x] = (x % 4 == 3) ? 0xFF : static_cast<uint8_t>(random());
+        }
+    }
+}
+
+bool isSameFrame(const Frame& frame1, const Frame& frame2)
+{
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(0, y), frame2.frameDataAtPos(0, y),
+                   static_cast<size_t>(frame1.size().width() * 4)) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void encodeAndDecode(bool tiles, bool stream)
+{
+    std::mt19937 random(tiles ? 1 : 2);
+
+    std::unique_ptr<VideoEncoderZstd> encoder = VideoEncoderZstd::create(PixelFormat::ARGB(), 8);
+    ASSERT_TRUE(encoder);
+    encoder->setTilesEnabled(tiles);
+    encoder->setPersistentStreamEnabled(stream);
+
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+    ASSERT_TRUE(decoder);
+
+    std::unique_ptr<Frame> source = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> target = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    fillRandom(random, source.get(), Rect::makeSize(kScreenSize));
+    source->updatedRegion()->setRect(Rect::makeSize(kScreenSize));
+
+    proto::VideoPacket packet;
+    ASSERT_TRUE(encoder->encode(source.get(), &packet));
+    EXPECT_EQ(packet.tile_size() > 0, tiles);
+    ASSERT_TRUE(decoder->decode(packet, target.get()));
+    EXPECT_TRUE(isSameFrame(*source, *target));
+
+    // The changed areas cross the borders of the tiles.
+    const Rect rects[] = { Rect::makeXYWH(200, 10, 100, 300),
+                           Rect::makeXYWH(500, 240, 200, 40),
+                           Rect::makeXYWH(0, 520, 10, 10) };
+
+    source->updatedRegion()->clear();
+
+    for (const auto& rect : rects)
+    {
+        fillRandom(random, source.get(), rect);
+        source->updatedRegion()->addRect(rect);
+    }
+
+    packet.Clear();
+    ASSERT_TRUE(encoder->encode(source.get(), &packet));
+    EXPECT_FALSE(packet.has_format());
+    if (tiles && !stream)
+        EXPECT_GT(packet.tile_size(), 1);
+    if (stream)
+        EXPECT_NE(packet.stream(), proto::VIDEO_STREAM_NONE);
+    ASSERT_TRUE(decoder->decode(packet, target.get()));
+    EXPECT_TRUE(isSameFrame(*source, *target));
+}
+
+// Encoder and decoder which keep state between packets. The content of the first frame is kept so
+// that it can be brought back to check that the encoder finds it in the state.
+struct StatefulSession
+{
+    explicit StatefulSession(uint32_t seed)
+        : random(seed),
+          encoder(VideoEncoderZstd::create(PixelFormat::ARGB(), 8)),
+          decoder(VideoDecoderZstd::create()),
+          source(FrameSimple::create(kScreenSize, PixelFormat::ARGB())),
+          target(FrameSimple::create(kScreenSize, PixelFormat::ARGB())),
+          first(FrameSimple::create(kScreenSize, PixelFormat::ARGB()))
+    {
+        // Nothing
+    }
+
+    // Encodes and decodes the whole screen with random content.
+    void encodeFirst(proto::VideoPacket* packet)
+    {
+        ASSERT_TRUE(encoder);
+        ASSERT_TRUE(decoder);
+
+        fillRandom(random, source.get(), Rect::makeSize(kScreenSize));
+        first->copyPixelsFrom(*source, Point(0, 0), Rect::makeSize(kScreenSize));
+
+        encodeAndCheck(Rect::makeSize(kScreenSize), packet);
+        format = packet->format();
+    }
+
+    // Encodes and decodes |rect| with random content or with the content of the first frame.
+    void encodeRect(const Rect& rect, bool restore_first, proto::VideoPacket* packet)
+    {
+        if (restore_first)
+            source->copyPixelsFrom(*first, rect.topLeft(), rect);
+        else
+            fillRandom(random, source.get(), rect);
+
+        encodeAndCheck(rect, packet);
+    }
+
+    // Checks that a decoder which did not receive the previous packets rejects |packet|.
+    void expectOtherDecoderFails(proto::VideoPacket packet)
+    {
+        *packet.mutable_format() = format;
+        EXPECT_FALSE(VideoDecoderZstd::create()->decode(packet, target.get()));
+    }
+
+    void encodeAndCheck(const Rect& rect, proto::VideoPacket* packet)
+    {
+        source->updatedRegion()->setRect(rect);
+
+        packet->Clear();
+        ASSERT_TRUE(encoder->encode(source.get(), packet));
+        ASSERT_TRUE(decoder->decode(*packet, target.get()));
+        EXPECT_TRUE(isSameFrame(*source, *target));
+    }
+
+    std::mt19937 random;
+    std::unique_ptr<VideoEncoderZstd> encoder;
+    std::unique_ptr<VideoDecoderZstd> decoder;
+    std::unique_ptr<Frame> source;
+    std::unique_ptr<Frame> target;
+    std::unique_ptr<Frame> first;
+    proto::VideoPacketFormat format;
+};
+
+} // namespace
+
+TEST(VideoEncoderZstdTest, EncodeDecode)
+{
+    encodeAndDecode(false, false);
+}
+
+TEST(VideoEncoderZstdTest, EncodeDecodeTiles)
+{
+    encodeAndDecode(true, false);
+}
+
+TEST(VideoEncoderZstdTest, EncodeDecodeStream)
+{
+    encodeAndDecode(false, true);
+}
+
+TEST(VideoEncoderZstdTest, EncodeDecodeTilesAndStream)
+{
+    encodeAndDecode(true, true);
+}
+
+TEST(VideoEncoderZstdTest, PersistentStream)
+{
+    StatefulSession session(4);
+    session.encoder->setPersistentStreamEnabled(true);
+
+    proto::VideoPacket packet;
+    session.encodeFirst(&packet);
+    EXPECT_EQ(packet.stream(), proto::VIDEO_STREAM_START);
+
+    const Rect rect = Rect::makeXYWH(100, 100, 200, 100);
+    size_t sizes[2];
+
+    // The area gets new content and then the content of the first frame back. The second time it
+    // is found in the history of the stream.
+    for (size_t i = 0; i < 2; ++i)
+    {
+        session.encodeRect(rect, i == 1, &packet);
+        EXPECT_EQ(packet.stream(), proto::VIDEO_STREAM_CONTINUE);
+
+        sizes[i] = packet.data().size();
+    }
+
+    EXPECT_LT(sizes[1] * 10, sizes[0]);
+
+    // A decoder without the start of the stream can not decode the packet.
+    session.expectOtherDecoderFails(packet);
+}
+
+TEST(VideoEncoderZstdTest, TileCache)
+{
+    StatefulSession session(5);
+    session.encoder->setTileCacheEnabled(true);
+
+    proto::VideoPacket packet;
+    session.encodeFirst(&packet);
+    EXPECT_NE(packet.tile_cache_size(), 0U);
+    EXPECT_EQ(packet.cache_store_size(), (700 / 64) * (530 / 64));
+    EXPECT_EQ(packet.cached_tile_size(), 0);
+
+    // 4x2 tiles and a part of the next tile get new content.
+    const Rect rect = Rect::makeXYWH(64, 128, 4 * 64 + 10, 2 * 64);
+
+    session.encodeRect(rect, false, &packet);
+    EXPECT_EQ(packet.tile_cache_size(), 0U);
+    EXPECT_EQ(packet.cache_store_size(), 8);
+    EXPECT_EQ(packet.cached_tile_size(), 0);
+
+    // The content of the first frame is back. The whole tiles are taken from the cache.
+    session.encodeRect(rect, true, &packet);
+    EXPECT_EQ(packet.cached_tile_size(), 8);
+    EXPECT_EQ(packet.dirty_rect_size(), 1);
+
+    // A decoder without the cache can not draw the tiles.
+    packet.set_tile_cache_size(static_cast<uint32_t>(TileCache::kMaxSlotCount));
+    session.expectOtherDecoderFails(packet);
+}
+
+TEST(VideoEncoderZstdTest, SharedTileRunner)
+{
+    std::mt19937 random(6);
+
+    std::shared_ptr<ParallelRunner> runner = std::make_shared<ParallelRunner>(2);
+
+    std::unique_ptr<Frame> source = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> target = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    fillRandom(random, source.get(), Rect::makeSize(kScreenSize));
+    source->updatedRegion()->setRect(Rect::makeSize(kScreenSize));
+
+    std::unique_ptr<VideoEncoderZstd> encoders[2];
+
+    for (auto& encoder : encoders)
+    {
+        encoder = VideoEncoderZstd::create(PixelFormat::ARGB(), 8);
+        ASSERT_TRUE(encoder);
+        encoder->setTilesEnabled(true);
+        encoder->setPersistentStreamEnabled(true);
+        encoder->setTileRunner(runner);
+
+        proto::VideoPacket packet;
+        ASSERT_TRUE(encoder->encode(source.get(), &packet));
+        EXPECT_GT(packet.tile_size(), 1);
+        ASSERT_TRUE(VideoDecoderZstd::create()->decode(packet, target.get()));
+        EXPECT_TRUE(isSameFrame(*source, *target));
+    }
+
+    const Rect rect = Rect::makeXYWH(10, 20, 30, 40);
+    fillRandom(random, source.get(), rect);
+    source->updatedRegion()->setRect(rect);
+
+    // After a restart, a decoder that has not received the previous packets can decode the next
+    // one.
+    encoders[0]->setFormatRequired();
+
+    proto::VideoPacket packet;
+    ASSERT_TRUE(encoders[0]->encode(source.get(), &packet));
+    EXPECT_TRUE(packet.has_format());
+    ASSERT_TRUE(VideoDecoderZstd::create()->decode(packet, target.get()));
+    EXPECT_TRUE(isSameFrame(*source, *target));
+}
+
+TEST(VideoEncoderZstdTest, InvalidTiles)
+{
+    std::unique_ptr<VideoEncoderZstd> encoder = VideoEncoderZstd::create(PixelFormat::ARGB(), 8);
+    ASSERT_TRUE(encoder);
+    encoder->setTilesEnabled(true);
+
+    std::mt19937 random(3);
+
+    std::unique_ptr<Frame> source = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    fillRandom(random, source.get(), Rect::makeSize(kScreenSize));
+    source->updatedRegion()->setRect(Rect::makeSize(kScreenSize));
+
+    proto::VideoPacket packet;
+    ASSERT_TRUE(encoder->encode(source.get(), &packet));
+    ASSERT_GT(packet.tile_size(), 1);
+
+    std::unique_ptr<Frame> target = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    // The data of the tiles does not match the packet data.
+    proto::VideoPacket broken_packet = packet;
+    broken_packet.mutable_tile(0)->set_data_size(packet.tile(0).data_size() + 1);
+    EXPECT_FALSE(VideoDecoderZstd::create()->decode(broken_packet, target.get()));
+
+    // The rectangles of the tiles do not match the packet rectangles.
+    broken_packet = packet;
+    broken_packet.mutable_tile(0)->set_rect_count(packet.tile(0).rect_count() + 1);
+    EXPECT_FALSE(VideoDecoderZstd::create()->decode(broken_packet, target.get()));
+
+    // Data of one tile is swapped with the next one.
+    broken_packet = packet;
+    broken_packet.mutable_tile(0)->set_data_size(packet.tile(1).data_size());
+    broken_packet.mutable_tile(1)->set_data_size(packet.tile(0).data_size());
+    if (packet.tile(0).data_size() != packet.tile(1).data_size())
+        EXPECT_FALSE(VideoDecoderZstd::create()->decode(broken_packet, target.get()));
+
+    EXPECT_TRUE(VideoDecoderZstd::create()->decode(packet, target.get()));
+    EXPECT_TRUE(isSameFrame(*source, *target));
+}
+
+} // namespace base
@@ -30,6 +30,41 @@
 
 namespace base {
 
+namespace {
+
+//--------------------------------------------------------------------------------------------------
+// Returns the XCR0 register which contains the set of register states enabled by the OS.
+uint64_t xcr0()
+{
+#if defined(CC_MSVC)
+    return _xgetbv(0);
+#else
+    uint32_t eax;
+    uint32_t edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+// Checks that the CPU supports AVX and that the OS saves the given register states on a context
+// switch.
+bool hasOsAvxSupport(uint64_t xcr0_mask)
+{
+    if (CpuidUtil(0).eax() < 7)
+        return false;
+
+    BitSet<uint32_t> ecx(CpuidUtil(1).ecx());
+
+    // Bit 27 (OSXSAVE) and bit 28 (AVX) of register ECX.
+    if (!ecx.test(27) || !ecx.test(28))
+        return false;
+
+    return (xcr0() & xcr0_mask) == xcr0_mask;
+}
+
+} // namespace
+
 //--------------------------------------------------------------------------------------------------
 CpuidUtil::CpuidUtil(int leaf, int subleaf)
 {
@@ -84,6 +119,42 @@ bool CpuidUtil::hasAesNi()
     return BitSet<uint32_t>(CpuidUtil(1).ecx()).test(25);
 }
 
+//--------------------------------------------------------------------------------------------------
+// static
+bool CpuidUtil::hasSse42()
+{
+    // Check if function 1 is supported.
+    if (CpuidUtil(0).eax() < 1)
+        return false;
+
+    // Bit 20 of register ECX set to 1 indicates the support of SSE4.2 instructions (including CRC32).
+    return BitSet<uint32_t>(CpuidUtil(1).ecx()).test(20);
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+bool CpuidUtil::hasAvx2()
+{
+    // XMM and YMM states must be enabled by the OS.
+    if (!hasOsAvxSupport(0x06))
+        return false;
+
+    // Bit 5 of register EBX (leaf 7) set to 1 indicates the support of AVX2 instructions.
+    return BitSet<uint32_t>(CpuidUtil(7).ebx()).test(5);
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+bool CpuidUtil::hasAvx512()
+{
+    // XMM, YMM, opmask and ZMM states must be enabled by the OS.
+    if (!hasOsAvxSupport(0xE6))
+        return false;
+
+    // Bit 16 of register EBX (leaf 7) set to 1 indicates the support of AVX-512 Foundation.
+    return BitSet<uint32_t>(CpuidUtil(7).ebx()).test(16);
+}
+
 } // namespace base
 
 #endif // defined(ARCH_CPU_X86_FAMILY)
@@ -48,6 +48,9 @@ public:
     uint32_t edx() const { return edx_; }
 
     static bool hasAesNi();
+    static bool hasSse42();
+    static bool hasAvx2();
+    static bool hasAvx512();
 
 private:
     uint32_t eax_ = 0;
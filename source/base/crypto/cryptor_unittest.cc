@@ -106,6 +106,49 @@ void wrongKey(MessageEncryptor* client_encryptor, MessageDecryptor* host_decrypt
     ASSERT_FALSE(ret);
 }
 
+void inPlace(MessageEncryptor* encryptor, MessageEncryptor* encryptor_copy,
+             MessageDecryptor* decryptor, MessageDecryptor* decryptor_copy)
+{
+    const ByteArray message = fromHex(
+        "6006ee8029610876ec2facd5fc9ce6bd6dc03d4a5ddb4d6c28f2ff048d4f7eb7bcf5048c901a4adaa7fd8aa65bc95ca1d9f21ced474a45e9c6e7344184d6d715");
+
+    // Regular encryption. The result is used as a reference.
+    ByteArray encrypted_msg;
+    encrypted_msg.resize(encryptor_copy->encryptedDataSize(message.size()));
+
+    bool ret = encryptor_copy->encrypt(message.data(), message.size(), encrypted_msg.data());
+    ASSERT_TRUE(ret);
+
+    // In-place encryption must give the same prefix and encrypted data.
+    ByteArray data = message;
+    ByteArray prefix;
+    prefix.resize(encryptor->encryptedDataSize(message.size()) - message.size());
+    ASSERT_EQ(prefix.size(), 16);
+
+    ret = encryptor->encryptInPlace(data.data(), data.size(), prefix.data());
+    ASSERT_TRUE(ret);
+
+    ByteArray in_place_msg = prefix;
+    append(&in_place_msg, data.data(), data.size());
+    ASSERT_EQ(in_place_msg, encrypted_msg);
+
+    // In-place decryption.
+    ASSERT_EQ(decryptor->prefixSize(), prefix.size());
+
+    ret = decryptor->decryptInPlace(prefix.data(), data.data(), data.size());
+    ASSERT_TRUE(ret);
+    ASSERT_EQ(data, message);
+
+    // Modified data must not be decrypted. The decryptor above has already moved to the next IV,
+    // so a decryptor with the original IV is used.
+    ByteArray wrong_data = in_place_msg;
+    wrong_data.back() ^= 0x01;
+
+    ret = decryptor_copy->decryptInPlace(
+        wrong_data.data(), wrong_data.data() + prefix.size(), wrong_data.size() - prefix.size());
+    ASSERT_FALSE(ret);
+}
+
 TEST(CryptorAes256GcmTest, TestVector)
 {
     const ByteArray key =
@@ -218,4 +261,54 @@ TEST(CryptorChaCha20Poly1305Test, WrongKey)
     wrongKey(client_encryptor.get(), host_decryptor.get());
 }
 
+TEST(CryptorAes256GcmTest, InPlace)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageEncryptor> encryptor_copy =
+        MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(encryptor_copy, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor =
+        MessageDecryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor_copy =
+        MessageDecryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(decryptor_copy, nullptr);
+
+    inPlace(encryptor.get(), encryptor_copy.get(), decryptor.get(), decryptor_copy.get());
+}
+
+TEST(CryptorChaCha20Poly1305Test, InPlace)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageEncryptor> encryptor_copy =
+        MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(encryptor_copy, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor =
+        MessageDecryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor_copy =
+        MessageDecryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(decryptor_copy, nullptr);
+
+    inPlace(encryptor.get(), encryptor_copy.get(), decryptor.get(), decryptor_copy.get());
+}
+
 } // namespace base
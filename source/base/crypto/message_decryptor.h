@@ -30,6 +30,13 @@ public:
 
     virtual size_t decryptedDataSize(size_t in_size) = 0;
     virtual bool decrypt(const void* in, size_t in_size, void* out) = 0;
+
+    // Returns the size of the data that the encryptor places in front of the encrypted message.
+    virtual size_t prefixSize() = 0;
+
+    // Decrypts |size| bytes of |data| in place. |prefix| must contain prefixSize() bytes that
+    // preceded the encrypted message.
+    virtual bool decryptInPlace(const void* prefix, void* data, size_t size) = 0;
 };
 
 } // namespace base
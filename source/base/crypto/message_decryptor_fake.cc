@@ -41,4 +41,17 @@ bool MessageDecryptorFake::decrypt(const void* in, size_t in_size, void* out)
     return true;
 }
 
+//--------------------------------------------------------------------------------------------------
+size_t MessageDecryptorFake::prefixSize()
+{
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool MessageDecryptorFake::decryptInPlace(
+    const void* /* prefix */, void* /* data */, size_t /* size */)
+{
+    return true;
+}
+
 } // namespace base
@@ -33,6 +33,8 @@ public:
     // MessageDecryptor implementation.
     size_t decryptedDataSize(size_t in_size) final;
     bool decrypt(const void* in, size_t in_size, void* out) final;
+    size_t prefixSize() final;
+    bool decryptInPlace(const void* prefix, void* data, size_t size) final;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(MessageDecryptorFake);
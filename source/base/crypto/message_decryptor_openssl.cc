@@ -97,6 +97,30 @@ size_t MessageDecryptorOpenssl::decryptedDataSize(size_t in_size)
 
 //--------------------------------------------------------------------------------------------------
 bool MessageDecryptorOpenssl::decrypt(const void* in, size_t in_size, void* out)
+{
+    const uint8_t* tag = reinterpret_cast<const uint8_t*>(in);
+
+    // The tag is placed in front of the encrypted data.
+    return decryptImpl(tag + kTagSize, in_size - kTagSize, tag, reinterpret_cast<uint8_t*>(out));
+}
+
+//--------------------------------------------------------------------------------------------------
+size_t MessageDecryptorOpenssl::prefixSize()
+{
+    return kTagSize;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool MessageDecryptorOpenssl::decryptInPlace(const void* prefix, void* data, size_t size)
+{
+    // AES-GCM and ChaCha20-Poly1305 allow the input and output buffers to be the same.
+    return decryptImpl(reinterpret_cast<const uint8_t*>(data), size,
+                       reinterpret_cast<const uint8_t*>(prefix), reinterpret_cast<uint8_t*>(data));
+}
+
+//--------------------------------------------------------------------------------------------------
+bool MessageDecryptorOpenssl::decryptImpl(
+    const uint8_t* in, size_t in_size, const uint8_t* tag, uint8_t* out)
 {
     if (EVP_DecryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv_.data()) != 1)
     {
@@ -106,23 +130,20 @@ bool MessageDecryptorOpenssl::decrypt(const void* in, size_t in_size, void* out)
 
     int length;
 
-    if (EVP_DecryptUpdate(ctx_.get(),
-                          reinterpret_cast<uint8_t*>(out), &length,
-                          reinterpret_cast<const uint8_t*>(in) + kTagSize,
-                          static_cast<int>(in_size) - kTagSize) != 1)
+    if (EVP_DecryptUpdate(ctx_.get(), out, &length, in, static_cast<int>(in_size)) != 1)
     {
         LOG(LS_ERROR) << "EVP_DecryptUpdate failed";
         return false;
     }
 
     if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_SET_TAG, kTagSize,
-                            const_cast<void*>(in)) != 1)
+                            const_cast<uint8_t*>(tag)) != 1)
     {
         LOG(LS_ERROR) << "EVP_CIPHER_CTX_ctrl failed";
         return false;
     }
 
-    if (EVP_DecryptFinal_ex(ctx_.get(), reinterpret_cast<uint8_t*>(out) + length, &length) <= 0)
+    if (EVP_DecryptFinal_ex(ctx_.get(), out + length, &length) <= 0)
     {
         LOG(LS_ERROR) << "EVP_DecryptFinal_ex failed";
         return false;
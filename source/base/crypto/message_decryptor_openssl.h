@@ -40,10 +40,14 @@ public:
     // MessageDecryptor implementation.
     size_t decryptedDataSize(size_t in_size) final;
     bool decrypt(const void* in, size_t in_size, void* out) final;
+    size_t prefixSize() final;
+    bool decryptInPlace(const void* prefix, void* data, size_t size) final;
 
 private:
     MessageDecryptorOpenssl(EVP_CIPHER_CTX_ptr ctx, const ByteArray& iv);
 
+    bool decryptImpl(const uint8_t* in, size_t in_size, const uint8_t* tag, uint8_t* out);
+
     EVP_CIPHER_CTX_ptr ctx_;
     ByteArray iv_;
 
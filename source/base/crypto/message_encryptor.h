@@ -30,6 +30,10 @@ public:
 
     virtual size_t encryptedDataSize(size_t in_size) = 0;
     virtual bool encrypt(const void* in, size_t in_size, void* out) = 0;
+
+    // Encrypts |size| bytes of |data| in place. The data that the encryptor places in front of the
+    // encrypted message (encryptedDataSize(size) - size bytes) is written to |prefix|.
+    virtual bool encryptInPlace(void* data, size_t size, void* prefix) = 0;
 };
 
 } // namespace base
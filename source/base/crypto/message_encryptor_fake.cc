@@ -41,4 +41,10 @@ bool MessageEncryptorFake::encrypt(const void* in, size_t in_size, void* out)
     return true;
 }
 
+//--------------------------------------------------------------------------------------------------
+bool MessageEncryptorFake::encryptInPlace(void* /* data */, size_t /* size */, void* /* prefix */)
+{
+    return true;
+}
+
 } // namespace base
@@ -33,6 +33,7 @@ public:
     // MessageEncryptor implementation.
     size_t encryptedDataSize(size_t in_size) final;
     bool encrypt(const void* in, size_t in_size, void* out) final;
+    bool encryptInPlace(void* data, size_t size, void* prefix) final;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(MessageEncryptorFake);
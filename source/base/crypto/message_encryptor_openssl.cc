@@ -97,6 +97,24 @@ size_t MessageEncryptorOpenssl::encryptedDataSize(size_t in_size)
 
 //--------------------------------------------------------------------------------------------------
 bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
+{
+    uint8_t* tag = reinterpret_cast<uint8_t*>(out);
+
+    // The tag is placed in front of the encrypted data.
+    return encryptImpl(reinterpret_cast<const uint8_t*>(in), in_size, tag + kTagSize, tag);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool MessageEncryptorOpenssl::encryptInPlace(void* data, size_t size, void* prefix)
+{
+    // AES-GCM and ChaCha20-Poly1305 allow the input and output buffers to be the same.
+    return encryptImpl(reinterpret_cast<const uint8_t*>(data), size,
+                       reinterpret_cast<uint8_t*>(data), reinterpret_cast<uint8_t*>(prefix));
+}
+
+//--------------------------------------------------------------------------------------------------
+bool MessageEncryptorOpenssl::encryptImpl(
+    const uint8_t* in, size_t in_size, uint8_t* out, uint8_t* tag)
 {
     if (EVP_EncryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv_.data()) != 1)
     {
@@ -106,23 +124,19 @@ bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
 
     int length;
 
-    if (EVP_EncryptUpdate(ctx_.get(),
-                          reinterpret_cast<uint8_t*>(out) + kTagSize, &length,
-                          reinterpret_cast<const uint8_t*>(in), static_cast<int>(in_size)) != 1)
+    if (EVP_EncryptUpdate(ctx_.get(), out, &length, in, static_cast<int>(in_size)) != 1)
     {
         LOG(LS_ERROR) << "EVP_EncryptUpdate failed";
         return false;
     }
 
-    if (EVP_EncryptFinal_ex(ctx_.get(),
-                            reinterpret_cast<uint8_t*>(out) + kTagSize + length,
-                            &length) != 1)
+    if (EVP_EncryptFinal_ex(ctx_.get(), out + length, &length) != 1)
     {
         LOG(LS_ERROR) << "EVP_EncryptFinal_ex failed";
         return false;
     }
 
-    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_GET_TAG, kTagSize, out) != 1)
+    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_GET_TAG, kTagSize, tag) != 1)
     {
         LOG(LS_ERROR) << "EVP_CIPHER_CTX_ctrl failed";
         return false;
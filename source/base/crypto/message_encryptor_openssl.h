@@ -40,10 +40,13 @@ public:
     // MessageEncryptor implementation.
     size_t encryptedDataSize(size_t in_size) final;
     bool encrypt(const void* in, size_t in_size, void* out) final;
+    bool encryptInPlace(void* data, size_t size, void* prefix) final;
 
 private:
     MessageEncryptorOpenssl(EVP_CIPHER_CTX_ptr ctx, const ByteArray& iv);
 
+    bool encryptImpl(const uint8_t* in, size_t in_size, uint8_t* out, uint8_t* tag);
+
     EVP_CIPHER_CTX_ptr ctx_;
     ByteArray iv_;
 
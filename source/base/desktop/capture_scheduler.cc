@@ -18,8 +18,30 @@
 
 #include "base/desktop/capture_scheduler.h"
 
+#include <algorithm>
+
 namespace base {
 
+namespace {
+
+// Number of captures without changes after which the scheduler considers the screen idle.
+const int kIdleCaptures = 10;
+
+// Maximum capture interval for an idle screen.
+const std::chrono::milliseconds kIdleInterval { 500 };
+
+// Changes smaller than 1/kSmallChangeDivider of the screen (a blinking caret, a clock) do not
+// bring the scheduler out of the idle state, but stop the interval from growing.
+const int64_t kSmallChangeDivider = 1000;
+
+// Maximum number of update intervals added for the encoder backlog.
+const int kMaxBacklogFactor = 3;
+
+// Limits the growth of the interval to 2^kMaxIdleShift update intervals.
+const int kMaxIdleShift = 8;
+
+} // namespace
+
 //--------------------------------------------------------------------------------------------------
 CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& update_interval)
     : update_interval_(update_interval)
@@ -39,6 +61,37 @@ std::chrono::milliseconds CaptureScheduler::updateInterval() const
     return update_interval_;
 }
 
+//--------------------------------------------------------------------------------------------------
+void CaptureScheduler::setEncodeBacklog(int frames)
+{
+    encode_backlog_ = std::max(frames, 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+void CaptureScheduler::setChangedArea(int64_t changed_area, int64_t screen_area)
+{
+    if (changed_area <= 0)
+    {
+        idle_captures_ = std::min(idle_captures_ + 1, kIdleCaptures + kMaxIdleShift);
+    }
+    else if (changed_area * kSmallChangeDivider >= screen_area)
+    {
+        idle_captures_ = 0;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void CaptureScheduler::onUserActivity()
+{
+    idle_captures_ = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool CaptureScheduler::isIdle() const
+{
+    return idle_captures_ > kIdleCaptures;
+}
+
 //--------------------------------------------------------------------------------------------------
 void CaptureScheduler::beginCapture()
 {
@@ -54,13 +107,34 @@ void CaptureScheduler::endCapture()
 //--------------------------------------------------------------------------------------------------
 std::chrono::milliseconds CaptureScheduler::nextCaptureDelay() const
 {
+    std::chrono::milliseconds interval = currentInterval();
     std::chrono::milliseconds diff_time =
         std::chrono::duration_cast<std::chrono::milliseconds>(end_time_ - begin_time_);
 
-    if (diff_time > update_interval_)
-        diff_time = update_interval_;
+    if (diff_time > interval)
+        diff_time = interval;
+
+    return interval - diff_time;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::chrono::milliseconds CaptureScheduler::currentInterval() const
+{
+    std::chrono::milliseconds interval = update_interval_;
+
+    if (encode_backlog_ > 0)
+        interval *= 1 + std::min(encode_backlog_, kMaxBacklogFactor);
+
+    if (isIdle())
+    {
+        // The interval is doubled with each idle capture.
+        std::chrono::milliseconds idle_interval =
+            update_interval_ * (1 << (idle_captures_ - kIdleCaptures));
+
+        interval = std::max(interval, std::min(idle_interval, kIdleInterval));
+    }
 
-    return update_interval_ - diff_time;
+    return interval;
 }
 
 } // namespace base
@@ -22,9 +22,15 @@
 #include "base/macros_magic.h"
 
 #include <chrono>
+#include <cstdint>
 
 namespace base {
 
+// Calculates the delay before the next screen capture.
+// While the screen content is changing, captures follow the update interval (the service lowers
+// it when the client connections overflow). When nothing changes for several captures in a row,
+// the interval grows step by step up to the idle interval. Any noticeable change of the screen or
+// user input returns it to the update interval at once.
 class CaptureScheduler
 {
 public:
@@ -34,15 +40,35 @@ public:
     void setUpdateInterval(const std::chrono::milliseconds& update_interval);
     std::chrono::milliseconds updateInterval() const;
 
+    // Sets the number of captured frames that are waiting for the encoder. While the encoder is
+    // behind, captures are made less often, because the waiting frames are merged anyway.
+    void setEncodeBacklog(int frames);
+
+    // Reports the result of the last capture. |changed_area| is the area of the updated region
+    // of the frame, |screen_area| is the area of the whole frame (both in pixels).
+    void setChangedArea(int64_t changed_area, int64_t screen_area);
+
+    // Called on user input. The next capture is made with the update interval.
+    void onUserActivity();
+
+    // Returns true if the screen has not changed for a while and captures are made less often.
+    bool isIdle() const;
+
     void beginCapture();
     void endCapture();
     std::chrono::milliseconds nextCaptureDelay() const;
 
 private:
+    std::chrono::milliseconds currentInterval() const;
+
     std::chrono::milliseconds update_interval_;
     std::chrono::time_point<std::chrono::high_resolution_clock> begin_time_;
     std::chrono::time_point<std::chrono::high_resolution_clock> end_time_;
 
+    // Number of captures in a row without noticeable changes.
+    int idle_captures_ = 0;
+    int encode_backlog_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(CaptureScheduler);
 };
 
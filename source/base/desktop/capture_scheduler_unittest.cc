@@ -0,0 +1,138 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/capture_scheduler.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+const std::chrono::milliseconds kUpdateInterval { 40 };
+const int64_t kScreenArea = 1920 * 1080;
+
+void captureUnchanged(CaptureScheduler* scheduler, int count)
+{
+    for (int i = 0; i < count; ++i)
+        scheduler->setChangedArea(0, kScreenArea);
+}
+
+} // namespace
+
+TEST(CaptureSchedulerTest, UpdateInterval)
+{
+    CaptureScheduler scheduler(kUpdateInterval);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), kUpdateInterval);
+
+    scheduler.setChangedArea(kScreenArea, kScreenArea);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), kUpdateInterval);
+    EXPECT_FALSE(scheduler.isIdle());
+}
+
+TEST(CaptureSchedulerTest, IdleRampDown)
+{
+    CaptureScheduler scheduler(kUpdateInterval);
+
+    captureUnchanged(&scheduler, 10);
+    EXPECT_FALSE(scheduler.isIdle());
+    EXPECT_EQ(scheduler.nextCaptureDelay(), kUpdateInterval);
+
+    captureUnchanged(&scheduler, 1);
+    EXPECT_TRUE(scheduler.isIdle());
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(80));
+
+    captureUnchanged(&scheduler, 1);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(160));
+
+    captureUnchanged(&scheduler, 1);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(320));
+
+    captureUnchanged(&scheduler, 100);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(500));
+}
+
+TEST(CaptureSchedulerTest, ActivityRampUp)
+{
+    CaptureScheduler scheduler(kUpdateInterval);
+
+    captureUnchanged(&scheduler, 100);
+    EXPECT_TRUE(scheduler.isIdle());
+
+    scheduler.setChangedArea(640 * 480, kScreenArea);
+    EXPECT_FALSE(scheduler.isIdle());
+    EXPECT_EQ(scheduler.nextCaptureDelay(), kUpdateInterval);
+
+    captureUnchanged(&scheduler, 100);
+    EXPECT_TRUE(scheduler.isIdle());
+
+    scheduler.onUserActivity();
+    EXPECT_FALSE(scheduler.isIdle());
+    EXPECT_EQ(scheduler.nextCaptureDelay(), kUpdateInterval);
+}
+
+TEST(CaptureSchedulerTest, SmallChanges)
+{
+    CaptureScheduler scheduler(kUpdateInterval);
+
+    captureUnchanged(&scheduler, 100);
+
+    // A blinking caret does not bring the scheduler out of the idle state.
+    scheduler.setChangedArea(2 * 16, kScreenArea);
+    EXPECT_TRUE(scheduler.isIdle());
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(500));
+
+    captureUnchanged(&scheduler, 1);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(500));
+
+    // Small changes stop the growth of the interval.
+    scheduler.onUserActivity();
+    captureUnchanged(&scheduler, 11);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(80));
+
+    for (int i = 0; i < 10; ++i)
+        scheduler.setChangedArea(2 * 16, kScreenArea);
+
+    EXPECT_TRUE(scheduler.isIdle());
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(80));
+}
+
+TEST(CaptureSchedulerTest, EncodeBacklog)
+{
+    CaptureScheduler scheduler(kUpdateInterval);
+
+    scheduler.setEncodeBacklog(1);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(80));
+
+    scheduler.setEncodeBacklog(10);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(160));
+
+    scheduler.setEncodeBacklog(0);
+    EXPECT_EQ(scheduler.nextCaptureDelay(), kUpdateInterval);
+}
+
+TEST(CaptureSchedulerTest, LongUpdateInterval)
+{
+    CaptureScheduler scheduler(std::chrono::milliseconds(1000));
+
+    captureUnchanged(&scheduler, 100);
+    EXPECT_TRUE(scheduler.isIdle());
+    EXPECT_EQ(scheduler.nextCaptureDelay(), std::chrono::milliseconds(1000));
+}
+
+} // namespace base
@@ -0,0 +1,92 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/diff_block_32bpp_avx512.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif // defined(CC_*)
+
+// The rest of the project is compiled for the baseline instruction set. The functions below are
+// compiled for AVX-512F and called only if CpuidUtil::hasAvx512() returns true.
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX512
+#endif
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+namespace {
+
+//--------------------------------------------------------------------------------------------------
+// Compares one 64-byte cache line (16 pixels) with a single load per image. Returns true if there
+// are differences.
+TARGET_AVX512 inline bool diffCacheLine(const uint8_t* image1, const uint8_t* image2)
+{
+    __m512i line1 = _mm512_loadu_si512(image1);
+    __m512i line2 = _mm512_loadu_si512(image2);
+
+    // Pixels are compared as 32-bit values, which requires only AVX-512F.
+    return _mm512_cmpneq_epi32_mask(line1, line2) != 0;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+TARGET_AVX512 uint8_t diffFullBlock_32bpp_32x32_AVX512(
+    const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    for (int i = 0; i < 32; ++i)
+    {
+        // Each row consists of two cache lines. We stop on the first one that has differences.
+        if (diffCacheLine(image1, image2) || diffCacheLine(image1 + 64, image2 + 64))
+            return 1U;
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+//--------------------------------------------------------------------------------------------------
+TARGET_AVX512 uint8_t diffFullBlock_32bpp_16x16_AVX512(
+    const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        if (diffCacheLine(image1, image2))
+            return 1U;
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace base
@@ -0,0 +1,83 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/diff_block_32bpp_neon.h"
+
+#if defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif // defined(ARCH_CPU_ARM64)
+
+namespace base {
+
+#if defined(ARCH_CPU_ARM64)
+
+namespace {
+
+//--------------------------------------------------------------------------------------------------
+// Compares one 64-byte cache line (16 pixels). Returns true if there are differences.
+inline bool diffCacheLine(const uint8_t* image1, const uint8_t* image2)
+{
+    uint8x16x4_t line1 = vld1q_u8_x4(image1);
+    uint8x16x4_t line2 = vld1q_u8_x4(image2);
+
+    uint8x16_t diff0 = vorrq_u8(veorq_u8(line1.val[0], line2.val[0]),
+                                veorq_u8(line1.val[1], line2.val[1]));
+    uint8x16_t diff1 = vorrq_u8(veorq_u8(line1.val[2], line2.val[2]),
+                                veorq_u8(line1.val[3], line2.val[3]));
+
+    return vmaxvq_u32(vreinterpretq_u32_u8(vorrq_u8(diff0, diff1))) != 0;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+uint8_t diffFullBlock_32bpp_32x32_NEON(
+    const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    for (int i = 0; i < 32; ++i)
+    {
+        // Each row consists of two cache lines. We stop on the first one that has differences.
+        if (diffCacheLine(image1, image2) || diffCacheLine(image1 + 64, image2 + 64))
+            return 1U;
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t diffFullBlock_32bpp_16x16_NEON(
+    const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        if (diffCacheLine(image1, image2))
+            return 1U;
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+#endif // defined(ARCH_CPU_ARM64)
+
+} // namespace base
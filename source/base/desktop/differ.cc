@@ -18,10 +18,17 @@
 
 #include "base/desktop/differ.h"
 
+#include "base/cpuid_util.h"
 #include "base/logging.h"
+#include "base/desktop/diff_block_32bpp_avx2.h"
+#include "base/desktop/diff_block_32bpp_avx512.h"
+#include "base/desktop/diff_block_32bpp_neon.h"
 #include "base/desktop/diff_block_32bpp_sse2.h"
 #include "base/desktop/diff_block_32bpp_c.h"
+#include "base/desktop/hash_block_32bpp.h"
+#include "base/threading/parallel_runner.h"
 
+#include <algorithm>
 #include <cstring>
 #include <libyuv/cpu_id.h>
 
@@ -33,6 +40,9 @@ const int kBlockSize = 16;
 const int kBytesPerPixel = 4;
 const int kBytesPerBlock = kBlockSize * kBytesPerPixel;
 
+// A band smaller than this many rows of blocks (256 pixels) costs more to dispatch than to compare.
+const int kMinBlockRowsPerBand = 16;
+
 //--------------------------------------------------------------------------------------------------
 // Check for diffs in upper-left portion of the block. The size of the portion to check is
 // specified by the |width| and |height| values.
@@ -56,12 +66,10 @@ uint8_t diffPartialBlock(const uint8_t* prev_image,
     return 0U;
 }
 
-
-
 } // namespace
 
 //--------------------------------------------------------------------------------------------------
-Differ::Differ(const Size& size)
+Differ::Differ(const Size& size, int thread_count)
     : screen_rect_(Rect::makeSize(size)),
       bytes_per_row_(size.width() * kBytesPerPixel),
       diff_width_(((size.width() + kBlockSize - 1) / kBlockSize) + 1),
@@ -93,118 +101,268 @@ Differ::Differ(const Size& size)
 
     diff_full_block_func_ = diffFunction();
     CHECK(diff_full_block_func_);
+
+    hash_block_func_ = hashFunction();
+    CHECK(hash_block_func_);
+
+    splitBands(calcThreadCount(thread_count));
 }
 
+//--------------------------------------------------------------------------------------------------
+Differ::~Differ() = default;
+
 //--------------------------------------------------------------------------------------------------
 // static
 Differ::DiffFullBlockFunc Differ::diffFunction()
 {
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (CpuidUtil::hasAvx512())
+    {
+        LOG(LS_INFO) << "AVX-512 differ loaded";
+
+        if constexpr (kBlockSize == 16)
+            return diffFullBlock_32bpp_16x16_AVX512;
+        else if constexpr (kBlockSize == 32)
+            return diffFullBlock_32bpp_32x32_AVX512;
+    }
+
+    if (CpuidUtil::hasAvx2())
+    {
+        LOG(LS_INFO) << "AVX2 differ loaded";
+
+        if constexpr (kBlockSize == 16)
+            return diffFullBlock_32bpp_16x16_AVX2;
+        else if constexpr (kBlockSize == 32)
+            return diffFullBlock_32bpp_32x32_AVX2;
+    }
+
     if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
     {
-#if defined(ARCH_CPU_X86_FAMILY)
         LOG(LS_INFO) << "SSE2 differ loaded";
 
         if constexpr (kBlockSize == 16)
             return diffFullBlock_32bpp_16x16_SSE2;
         else if constexpr (kBlockSize == 32)
             return diffFullBlock_32bpp_32x32_SSE2;
-#endif // defined(ARCH_CPU_X86_FAMILY)
     }
-    else
+#elif defined(ARCH_CPU_ARM64)
+    // NEON is a mandatory part of ARMv8-A, so no runtime check is needed.
+    LOG(LS_INFO) << "NEON differ loaded";
+
+    if constexpr (kBlockSize == 16)
+        return diffFullBlock_32bpp_16x16_NEON;
+    else if constexpr (kBlockSize == 32)
+        return diffFullBlock_32bpp_32x32_NEON;
+#endif // defined(ARCH_CPU_*)
+
+    LOG(LS_INFO) << "C differ loaded";
+
+    if constexpr (kBlockSize == 16)
+        return diffFullBlock_32bpp_16x16_C;
+    else if constexpr (kBlockSize == 32)
+        return diffFullBlock_32bpp_32x32_C;
+
+    return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+Differ::HashBlockFunc Differ::hashFunction()
+{
+#if defined(ARCH_CPU_X86_64)
+    if (CpuidUtil::hasSse42())
     {
-        LOG(LS_INFO) << "C differ loaded";
+        LOG(LS_INFO) << "SSE4.2 block hash loaded";
+        return hashBlock_32bpp_SSE42;
+    }
+#endif // defined(ARCH_CPU_X86_64)
 
-        if constexpr (kBlockSize == 16)
-            return diffFullBlock_32bpp_16x16_C;
-        else if constexpr (kBlockSize == 32)
-            return diffFullBlock_32bpp_32x32_C;
+    LOG(LS_INFO) << "C block hash loaded";
+    return hashBlock_32bpp_C;
+}
+
+//--------------------------------------------------------------------------------------------------
+int Differ::calcThreadCount(int thread_count) const
+{
+    // Every band covers at least kMinBlockRowsPerBand rows of blocks.
+    return std::max(std::min(ParallelRunner::calcThreadCount(thread_count),
+                             full_blocks_y_ / kMinBlockRowsPerBand), 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+void Differ::splitBands(int band_count)
+{
+    DCHECK_GE(band_count, 1);
+
+    // Distribute the rows of blocks evenly. The first bands get one row more if the rows cannot be
+    // divided without a remainder.
+    const int rows_per_band = full_blocks_y_ / band_count;
+    const int remainder = full_blocks_y_ % band_count;
+
+    band_rows_.resize(static_cast<size_t>(band_count) + 1);
+    band_rows_[0] = 0;
+
+    for (int i = 0; i < band_count; ++i)
+    {
+        const size_t index = static_cast<size_t>(i);
+        band_rows_[index + 1] = band_rows_[index] + rows_per_band + (i < remainder ? 1 : 0);
     }
 
-    return nullptr;
+    DCHECK_EQ(band_rows_.back(), full_blocks_y_);
+
+    if (band_count > 1)
+        runner_ = std::make_unique<ParallelRunner>(band_count);
+
+    LOG(LS_INFO) << "Differ bands: " << band_count;
 }
 
 //--------------------------------------------------------------------------------------------------
-// Identify all of the blocks that contain changed pixels.
+// Identify all of the blocks that contain changed pixels. If |prev_image| is null, then the blocks
+// are compared with the fingerprints of the previous image.
 void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image)
 {
-    const uint8_t* prev_block_row_start = prev_image;
-    const uint8_t* curr_block_row_start = curr_image;
+    if (!runner_)
+    {
+        markDirtyBlockRows(prev_image, curr_image, 0, full_blocks_y_);
+    }
+    else
+    {
+        // Each band writes only to its own rows of |diff_info_|.
+        runner_->run(band_rows_.size() - 1, [&](size_t band, int /* thread_index */)
+        {
+            markDirtyBlockRows(prev_image, curr_image, band_rows_[band], band_rows_[band + 1]);
+        });
+    }
+
+    // If the screen height is not a multiple of the block size, then this handles the last partial
+    // row. This situation is far more common than the 'partial column' case.
+    if (partial_row_height_ != 0)
+        markDirtyPartialRow(prev_image, curr_image);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Identify the changed blocks in the rows of full blocks from |first_row| to |last_row|. If
+// |prev_image| is null, then the blocks are compared with the fingerprints of the previous image.
+void Differ::markDirtyBlockRows(const uint8_t* prev_image, const uint8_t* curr_image,
+                                int first_row, int last_row)
+{
+    // Offset from the start of the image to the start of the current row of blocks.
+    size_t row_offset = static_cast<size_t>(first_row) * static_cast<size_t>(block_stride_y_);
 
     // Offset from the start of one diff_info row to the next.
     const int diff_stride = diff_width_;
 
-    uint8_t* is_diff_row_start = diff_info_.get();
+    size_t row_index = static_cast<size_t>(first_row * diff_stride);
 
-    for (int y = 0; y < full_blocks_y_; ++y)
+    for (int y = first_row; y < last_row; ++y)
     {
-        const uint8_t* prev_block = prev_block_row_start;
-        const uint8_t* curr_block = curr_block_row_start;
-
-        uint8_t* is_different = is_diff_row_start;
+        size_t offset = row_offset;
+        size_t index = row_index;
 
         for (int x = 0; x < full_blocks_x_; ++x)
         {
             // Mark this block as being modified so that it gets incorporated into a dirty rect.
-            *is_different = diff_full_block_func_(prev_block, curr_block, bytes_per_row_);
-
-            prev_block += kBytesPerBlock;
-            curr_block += kBytesPerBlock;
+            if (prev_image)
+            {
+                diff_info_[index] = diff_full_block_func_(
+                    prev_image + offset, curr_image + offset, bytes_per_row_);
+            }
+            else
+            {
+                diff_info_[index] =
+                    diffHashedBlock(curr_image + offset, index, kBlockSize, kBlockSize);
+            }
 
-            ++is_different;
+            offset += kBytesPerBlock;
+            ++index;
         }
 
         // If there is a partial column at the end, handle it. This condition should rarely, if
         // ever, occur.
         if (partial_column_width_ != 0)
         {
-            *is_different = diffPartialBlock(prev_block,
-                                             curr_block,
-                                             bytes_per_row_,
-                                             partial_column_width_ * kBytesPerPixel,
-                                             kBlockSize);
+            if (prev_image)
+            {
+                diff_info_[index] = diffPartialBlock(prev_image + offset,
+                                                     curr_image + offset,
+                                                     bytes_per_row_,
+                                                     partial_column_width_ * kBytesPerPixel,
+                                                     kBlockSize);
+            }
+            else
+            {
+                diff_info_[index] = diffHashedBlock(
+                    curr_image + offset, index, partial_column_width_, kBlockSize);
+            }
         }
 
-        // Update pointers for next row.
-        prev_block_row_start += block_stride_y_;
-        curr_block_row_start += block_stride_y_;
-
-        is_diff_row_start += diff_stride;
+        // Update offsets for next row.
+        row_offset += static_cast<size_t>(block_stride_y_);
+        row_index += static_cast<size_t>(diff_stride);
     }
+}
 
-    // If the screen height is not a multiple of the block size, then this handles the last partial
-    // row. This situation is far more common than the 'partial column' case.
-    if (partial_row_height_ != 0)
+//--------------------------------------------------------------------------------------------------
+// Identify the changed blocks in the last row which is lower than a full block.
+void Differ::markDirtyPartialRow(const uint8_t* prev_image, const uint8_t* curr_image)
+{
+    size_t offset = static_cast<size_t>(full_blocks_y_) * static_cast<size_t>(block_stride_y_);
+    size_t index = static_cast<size_t>(full_blocks_y_ * diff_width_);
+
+    for (int x = 0; x < full_blocks_x_; ++x)
     {
-        const uint8_t* prev_block = prev_block_row_start;
-        const uint8_t* curr_block = curr_block_row_start;
+        if (prev_image)
+        {
+            diff_info_[index] = diffPartialBlock(prev_image + offset,
+                                                 curr_image + offset,
+                                                 bytes_per_row_,
+                                                 kBytesPerBlock,
+                                                 partial_row_height_);
+        }
+        else
+        {
+            diff_info_[index] =
+                diffHashedBlock(curr_image + offset, index, kBlockSize, partial_row_height_);
+        }
 
-        uint8_t* is_different = is_diff_row_start;
+        offset += kBytesPerBlock;
+        ++index;
+    }
 
-        for (int x = 0; x < full_blocks_x_; ++x)
+    if (partial_column_width_ != 0)
+    {
+        if (prev_image)
         {
-            *is_different = diffPartialBlock(prev_block,
-                                             curr_block,
-                                             bytes_per_row_,
-                                             kBytesPerBlock,
-                                             partial_row_height_);
-
-            prev_block += kBytesPerBlock;
-            curr_block += kBytesPerBlock;
-            ++is_different;
+            diff_info_[index] = diffPartialBlock(prev_image + offset,
+                                                 curr_image + offset,
+                                                 bytes_per_row_,
+                                                 partial_column_width_ * kBytesPerPixel,
+                                                 partial_row_height_);
         }
-
-        if (partial_column_width_ != 0)
+        else
         {
-            *is_different =
-                diffPartialBlock(prev_block,
-                                 curr_block,
-                                 bytes_per_row_,
-                                 partial_column_width_ * kBytesPerPixel,
-                                 partial_row_height_);
+            diff_info_[index] = diffHashedBlock(
+                curr_image + offset, index, partial_column_width_, partial_row_height_);
         }
     }
 }
 
+//--------------------------------------------------------------------------------------------------
+// Calculates the fingerprint of the block and compares it with the fingerprint of the same block
+// in the previous image.
+uint8_t Differ::diffHashedBlock(
+    const uint8_t* curr_block, size_t block_index, int width, int height)
+{
+    const uint64_t hash = hash_block_func_(curr_block, bytes_per_row_, width, height);
+    uint64_t* prev_hash = &block_hashes_[block_index];
+
+    if (hash == *prev_hash)
+        return 0U;
+
+    *prev_hash = hash;
+    return 1U;
+}
+
 //--------------------------------------------------------------------------------------------------
 // After the dirty blocks have been identified, this routine merges adjacent blocks into a region.
 // The goal is to minimize the region that covers the dirty blocks.
@@ -294,14 +452,43 @@ void Differ::calcDirtyRegion(const uint8_t* prev_image,
                              const uint8_t* curr_image,
                              Region* dirty_region)
 {
+    DCHECK(prev_image);
+
     dirty_region->clear();
 
+    // The fingerprints are not updated here and become outdated.
+    has_block_hashes_ = false;
+
     // Identify all the blocks that contain changed pixels.
     markDirtyBlocks(prev_image, curr_image);
 
     // Now that we've identified the blocks that have changed, merge adjacent blocks to minimize
-    // the number of rects that we return.
+    // the number of rects that we return. The merge runs over the whole frame so that rects that
+    // cross band boundaries are the same as in a single pass.
+    mergeBlocks(dirty_region);
+}
+
+//--------------------------------------------------------------------------------------------------
+void Differ::calcDirtyRegion(const uint8_t* curr_image, Region* dirty_region)
+{
+    dirty_region->clear();
+
+    if (!block_hashes_)
+    {
+        const size_t block_count = static_cast<size_t>(diff_width_ * diff_height_);
+        block_hashes_ = std::make_unique<uint64_t[]>(block_count);
+    }
+
+    // Calculate the fingerprints of all blocks and compare them with the stored ones.
+    markDirtyBlocks(nullptr, curr_image);
     mergeBlocks(dirty_region);
+
+    if (!has_block_hashes_)
+    {
+        // There is nothing to compare with yet.
+        dirty_region->addRect(screen_rect_);
+        has_block_hashes_ = true;
+    }
 }
 
 } // namespace base
@@ -23,26 +23,51 @@
 #include "base/desktop/region.h"
 
 #include <memory>
+#include <vector>
 
 namespace base {
 
+class ParallelRunner;
+
 // Class to search for changed regions of the screen.
+// Large frames can be split into horizontal bands which are compared in parallel. The result does
+// not depend on the number of bands.
 class Differ
 {
 public:
-    explicit Differ(const Size& size);
-    ~Differ() = default;
+    // |thread_count| is the number of threads (including the calling one) used to compare blocks.
+    // If it is 0, the count is selected from the number of processors. Small frames and machines
+    // with few processors always use a single thread.
+    explicit Differ(const Size& size, int thread_count = 0);
+    ~Differ();
+
+    int threadCount() const { return static_cast<int>(band_rows_.size()) - 1; }
 
     void calcDirtyRegion(const uint8_t* prev_image,
                          const uint8_t* curr_image,
                          Region* changed_region);
 
+    // Compares |curr_image| with the fingerprints of the blocks of the image passed in the previous
+    // call and stores the fingerprints of |curr_image|. The previous image is never read, so the
+    // caller does not need to keep it. The first call (and the first call after using the overload
+    // above) marks the whole screen as changed.
+    void calcDirtyRegion(const uint8_t* curr_image, Region* changed_region);
+
 private:
     typedef uint8_t(*DiffFullBlockFunc)(const uint8_t*, const uint8_t*, int);
+    typedef uint64_t(*HashBlockFunc)(const uint8_t*, int, int, int);
 
     static DiffFullBlockFunc diffFunction();
+    static HashBlockFunc hashFunction();
+
+    int calcThreadCount(int thread_count) const;
+    void splitBands(int band_count);
 
     void markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image);
+    void markDirtyBlockRows(const uint8_t* prev_image, const uint8_t* curr_image,
+                            int first_row, int last_row);
+    void markDirtyPartialRow(const uint8_t* prev_image, const uint8_t* curr_image);
+    uint8_t diffHashedBlock(const uint8_t* curr_block, size_t block_index, int width, int height);
     void mergeBlocks(Region* dirty_region);
 
     const Rect screen_rect_;
@@ -59,6 +84,16 @@ private:
     std::unique_ptr<uint8_t[]> diff_info_;
     DiffFullBlockFunc diff_full_block_func_;
 
+    // Fingerprints of the blocks of the previous image. The layout is the same as |diff_info_|.
+    std::unique_ptr<uint64_t[]> block_hashes_;
+    bool has_block_hashes_ = false;
+    HashBlockFunc hash_block_func_;
+
+    // Boundaries of the bands in rows of full blocks. Band N covers rows from band_rows_[N] to
+    // band_rows_[N + 1]. The bands are compared by |runner_| if there is more than one.
+    std::vector<int> band_rows_;
+    std::unique_ptr<ParallelRunner> runner_;
+
     DISALLOW_COPY_AND_ASSIGN(Differ);
 };
 
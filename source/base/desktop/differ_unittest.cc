@@ -0,0 +1,152 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/differ.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const int kBytesPerPixel = 4;
+
+std::vector<uint8_t> createImage(const Size& size, std::mt19937& random)
+{
+    std::vector<uint8_t> image(static_cast<size_t>(size.width() * size.height() * kBytesPerPixel));
+    for (auto& byte : image)
+        byte = static_cast<uint8_t>(random());
+    return image;
+}
+
+void changePixels(const Size& size, std::vector<uint8_t>* image, int count, std::mt19937& random)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int x = static_cast<int>(random() % static_cast<uint32_t>(size.width()));
+        int y = static_cast<int>(random() % static_cast<uint32_t>(size.height()));
+
+        (*image)[static_cast<size_t>((y * size.width() + x) * kBytesPerPixel)] ^= 0xFF;
+    }
+}
+
+} // namespace
+
+TEST(DifferTest, NoChanges)
+{
+    const Size size(1024, 1024);
+    std::mt19937 random(1);
+
+    std::vector<uint8_t> image = createImage(size, random);
+
+    for (int threads = 1; threads <= 4; ++threads)
+    {
+        Differ differ(size, threads);
+        Region region;
+
+        differ.calcDirtyRegion(image.data(), image.data(), &region);
+        EXPECT_TRUE(region.isEmpty());
+    }
+}
+
+TEST(DifferTest, SameResultForAnyThreadCount)
+{
+    // Sizes which are not multiples of the block size produce partial rows and columns.
+    const Size sizes[] = { Size(1024, 1024), Size(1920, 1080), Size(1283, 1029) };
+
+    for (const auto& size : sizes)
+    {
+        std::mt19937 random(static_cast<uint32_t>(size.width()));
+
+        std::vector<uint8_t> prev_image = createImage(size, random);
+        std::vector<uint8_t> curr_image = prev_image;
+        changePixels(size, &curr_image, 200, random);
+
+        Differ single_differ(size, 1);
+        Region expected;
+        single_differ.calcDirtyRegion(prev_image.data(), curr_image.data(), &expected);
+        EXPECT_FALSE(expected.isEmpty());
+
+        for (int threads = 2; threads <= 4; ++threads)
+        {
+            Differ differ(size, threads);
+            EXPECT_EQ(differ.threadCount(), threads);
+
+            // Repeat to make sure that the workers are reused correctly.
+            for (int i = 0; i < 3; ++i)
+            {
+                Region region;
+                differ.calcDirtyRegion(prev_image.data(), curr_image.data(), &region);
+                EXPECT_TRUE(region.equals(expected));
+            }
+        }
+    }
+}
+
+TEST(DifferTest, HashedSameAsCompared)
+{
+    const Size sizes[] = { Size(1024, 1024), Size(1283, 1029) };
+
+    for (const auto& size : sizes)
+    {
+        std::mt19937 random(static_cast<uint32_t>(size.height()));
+
+        for (int threads = 1; threads <= 4; threads += 3)
+        {
+            Differ compare_differ(size, threads);
+            Differ hash_differ(size, threads);
+
+            std::vector<uint8_t> prev_image = createImage(size, random);
+            Region region;
+
+            // The first frame is changed entirely.
+            hash_differ.calcDirtyRegion(prev_image.data(), &region);
+            EXPECT_TRUE(region.equals(Region(Rect::makeSize(size))));
+
+            // No changes.
+            hash_differ.calcDirtyRegion(prev_image.data(), &region);
+            EXPECT_TRUE(region.isEmpty());
+
+            for (int i = 0; i < 3; ++i)
+            {
+                std::vector<uint8_t> curr_image = prev_image;
+                changePixels(size, &curr_image, 100, random);
+
+                Region expected;
+                compare_differ.calcDirtyRegion(prev_image.data(), curr_image.data(), &expected);
+                EXPECT_FALSE(expected.isEmpty());
+
+                hash_differ.calcDirtyRegion(curr_image.data(), &region);
+                EXPECT_TRUE(region.equals(expected));
+
+                prev_image = std::move(curr_image);
+            }
+        }
+    }
+}
+
+TEST(DifferTest, SingleThreadForSmallFrame)
+{
+    Differ differ(Size(640, 480), 4);
+    EXPECT_EQ(differ.threadCount(), 1);
+}
+
+} // namespace base
@@ -72,6 +72,36 @@ void Frame::copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const R
     copyPixelsFrom(src_frame.frameDataAtPos(src_pos), src_frame.stride(), dest_rect);
 }
 
+//--------------------------------------------------------------------------------------------------
+void Frame::moveRect(const Rect& src_rect, const Point& dest_pos)
+{
+    DCHECK(Rect::makeSize(size()).containsRect(src_rect));
+    DCHECK(Rect::makeSize(size()).containsRect(Rect::makeXYWH(dest_pos, src_rect.size())));
+
+    const size_t bytes_per_row = static_cast<size_t>(format_.bytesPerPixel() * src_rect.width());
+
+    if (dest_pos.y() > src_rect.y())
+    {
+        // The area moves down. Copy rows starting from the bottom so that the source rows are not
+        // overwritten before they are copied.
+        for (int y = src_rect.height() - 1; y >= 0; --y)
+        {
+            memmove(frameDataAtPos(dest_pos.x(), dest_pos.y() + y),
+                    frameDataAtPos(src_rect.x(), src_rect.y() + y),
+                    bytes_per_row);
+        }
+    }
+    else
+    {
+        for (int y = 0; y < src_rect.height(); ++y)
+        {
+            memmove(frameDataAtPos(dest_pos.x(), dest_pos.y() + y),
+                    frameDataAtPos(src_rect.x(), src_rect.y() + y),
+                    bytes_per_row);
+        }
+    }
+}
+
 //--------------------------------------------------------------------------------------------------
 float Frame::scaleFactor() const
 {
@@ -47,6 +47,9 @@ public:
     void copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect& dest_rect);
     void copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const Rect& dest_rect);
 
+    // Copies the pixels of |src_rect| to |dest_pos| within the frame. The areas may overlap.
+    void moveRect(const Rect& src_rect, const Point& dest_pos);
+
     const Region& constUpdatedRegion() const { return updated_region_; }
     Region* updatedRegion() { return &updated_region_; }
 
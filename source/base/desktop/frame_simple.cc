@@ -18,6 +18,8 @@
 
 #include "base/desktop/frame_simple.h"
 
+#include "base/memory/memory_policy.h"
+
 namespace base {
 
 //--------------------------------------------------------------------------------------------------
@@ -37,10 +39,14 @@ FrameSimple::~FrameSimple()
 // static
 std::unique_ptr<FrameSimple> FrameSimple::create(const Size& size, const PixelFormat& format)
 {
-    uint8_t* data = reinterpret_cast<uint8_t*>(malloc(calcMemorySize(size, format.bytesPerPixel())));
+    const size_t memory_size = calcMemorySize(size, format.bytesPerPixel());
+
+    uint8_t* data = reinterpret_cast<uint8_t*>(malloc(memory_size));
     if (!data)
         return nullptr;
 
+    MemoryPolicy::adviseLargeBuffer(data, memory_size);
+
     return std::unique_ptr<FrameSimple>(new FrameSimple(size, format, data));
 }
 
@@ -0,0 +1,152 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/hash_block_32bpp.h"
+
+#include <cstring>
+
+#if defined(ARCH_CPU_X86_64)
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <nmmintrin.h>
+#endif // defined(CC_*)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#else
+#define TARGET_SSE42
+#endif
+#endif // defined(ARCH_CPU_X86_64)
+
+namespace base {
+
+namespace {
+
+const int kBytesPerPixel = 4;
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+// Seeds of the two CRC32C streams that form the high and the low half of the fingerprint.
+const uint32_t kSeed1 = 0x00000000;
+const uint32_t kSeed2 = 0xFFFFFFFF;
+
+//--------------------------------------------------------------------------------------------------
+inline uint64_t load64(const uint8_t* data)
+{
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+//--------------------------------------------------------------------------------------------------
+inline uint32_t load32(const uint8_t* data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+//--------------------------------------------------------------------------------------------------
+inline uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+//--------------------------------------------------------------------------------------------------
+inline uint64_t mix(uint64_t acc, uint64_t value)
+{
+    return rotateLeft(acc + value * kPrime2, 31) * kPrime1;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+uint64_t hashBlock_32bpp_C(const uint8_t* image, int bytes_per_row, int width, int height)
+{
+    const int row_size = width * kBytesPerPixel;
+    uint64_t acc1 = kPrime1;
+    uint64_t acc2 = kPrime2;
+
+    for (int y = 0; y < height; ++y)
+    {
+        int x = 0;
+
+        // Two independent accumulators let the multiplications run in parallel.
+        for (; x + 16 <= row_size; x += 16)
+        {
+            acc1 = mix(acc1, load64(image + x));
+            acc2 = mix(acc2, load64(image + x + 8));
+        }
+
+        for (; x + 8 <= row_size; x += 8)
+            acc1 = mix(acc1, load64(image + x));
+
+        if (x < row_size)
+            acc2 = mix(acc2, load32(image + x));
+
+        image += bytes_per_row;
+    }
+
+    return acc1 ^ rotateLeft(acc2, 32);
+}
+
+#if defined(ARCH_CPU_X86_64)
+
+//--------------------------------------------------------------------------------------------------
+TARGET_SSE42 uint64_t hashBlock_32bpp_SSE42(
+    const uint8_t* image, int bytes_per_row, int width, int height)
+{
+    const int row_size = width * kBytesPerPixel;
+    uint64_t crc1 = kSeed1;
+    uint64_t crc2 = kSeed2;
+
+    // Both streams read every byte of the block. CRC is linear, so with the same input the second
+    // stream would depend on the first one. The second stream reads the data multiplied by an odd
+    // constant instead, which does not lose any bits and makes the streams independent. The
+    // multiplications do not depend on each other and run in parallel with the CRC32 instructions.
+    for (int y = 0; y < height; ++y)
+    {
+        int x = 0;
+
+        for (; x + 8 <= row_size; x += 8)
+        {
+            const uint64_t value = load64(image + x);
+
+            crc1 = _mm_crc32_u64(crc1, value);
+            crc2 = _mm_crc32_u64(crc2, value * kPrime1);
+        }
+
+        if (x < row_size)
+        {
+            const uint64_t value = load32(image + x);
+
+            crc1 = _mm_crc32_u64(crc1, value);
+            crc2 = _mm_crc32_u64(crc2, value * kPrime1);
+        }
+
+        image += bytes_per_row;
+    }
+
+    return (crc1 << 32) | (crc2 & 0xFFFFFFFF);
+}
+
+#endif // defined(ARCH_CPU_X86_64)
+
+} // namespace base
@@ -0,0 +1,43 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_DESKTOP_HASH_BLOCK_32BPP_H
+#define BASE_DESKTOP_HASH_BLOCK_32BPP_H
+
+#include "build/build_config.h"
+
+#include <cstdint>
+
+namespace base {
+
+// Functions calculate a 64-bit fingerprint of the block of |width| x |height| pixels. The
+// fingerprint is not cryptographically strong. It is only used to find blocks that have changed
+// since the previous frame without keeping the previous frame.
+
+uint64_t hashBlock_32bpp_C(const uint8_t* image, int bytes_per_row, int width, int height);
+
+#if defined(ARCH_CPU_X86_64)
+
+// Uses the CRC32C instruction. Can be called only if CpuidUtil::hasSse42() returns true.
+uint64_t hashBlock_32bpp_SSE42(const uint8_t* image, int bytes_per_row, int width, int height);
+
+#endif // defined(ARCH_CPU_X86_64)
+
+} // namespace base
+
+#endif // BASE_DESKTOP_HASH_BLOCK_32BPP_H
@@ -0,0 +1,99 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/cpuid_util.h"
+#include "base/desktop/hash_block_32bpp.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const int kBytesPerPixel = 4;
+
+using HashBlockFunc = uint64_t(*)(const uint8_t*, int, int, int);
+
+std::vector<uint8_t> generateData(int size)
+{
+    std::vector<uint8_t> data(static_cast<size_t>(size));
+    for (int i = 0; i < size; ++i)
+        data[static_cast<size_t>(i)] = static_cast<uint8_t>(i);
+    return data;
+}
+
+void testHashFunction(HashBlockFunc func)
+{
+    // Block sizes including partial blocks with an odd width.
+    const int kSizes[][2] = { { 16, 16 }, { 32, 32 }, { 7, 16 }, { 16, 5 }, { 3, 3 } };
+
+    for (const auto& size : kSizes)
+    {
+        const int width = size[0];
+        const int height = size[1];
+
+        // The block is a part of a larger image.
+        const int bytes_per_row = (width + 8) * kBytesPerPixel;
+        std::vector<uint8_t> image = generateData(bytes_per_row * height);
+
+        const uint64_t hash = func(image.data(), bytes_per_row, width, height);
+        EXPECT_EQ(hash, func(image.data(), bytes_per_row, width, height));
+
+        // Pixels outside the block do not change the hash.
+        image[static_cast<size_t>(width * kBytesPerPixel)] += 1;
+        EXPECT_EQ(hash, func(image.data(), bytes_per_row, width, height));
+
+        // Any changed byte inside the block changes both halves of the hash.
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width * kBytesPerPixel; ++x)
+            {
+                uint8_t* byte = &image[static_cast<size_t>(y * bytes_per_row + x)];
+
+                *byte += 1;
+                const uint64_t changed_hash = func(image.data(), bytes_per_row, width, height);
+                EXPECT_NE(hash >> 32, changed_hash >> 32);
+                EXPECT_NE(hash & 0xFFFFFFFF, changed_hash & 0xFFFFFFFF);
+                *byte -= 1;
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(hash_block, c)
+{
+    testHashFunction(hashBlock_32bpp_C);
+}
+
+#if defined(ARCH_CPU_X86_64)
+
+TEST(hash_block, sse42)
+{
+    if (!CpuidUtil::hasSse42())
+        return;
+
+    testHashFunction(hashBlock_32bpp_SSE42);
+}
+
+#endif // defined(ARCH_CPU_X86_64)
+
+} // namespace base
@@ -0,0 +1,328 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/move_detector.h"
+
+#include "base/cpuid_util.h"
+#include "base/logging.h"
+#include "base/desktop/frame_aligned.h"
+#include "base/desktop/hash_block_32bpp.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace base {
+
+namespace {
+
+const int kBytesPerPixel = 4;
+
+// Smaller areas are cheaper to send as pixels than to search for moves.
+const int kMinRectSize = 64;
+
+// Minimum number of lines (rows or columns) that must be moved as one area.
+const int kMinMoveLength = 32;
+
+// Minimum number of unique lines that must agree on the same offset.
+const int kMinMatchingLines = 8;
+
+const uint64_t kColumnHashPrime = 0x9E3779B185EBCA87ULL;
+
+//--------------------------------------------------------------------------------------------------
+// Finds the offset at which the largest number of unique lines of |curr| are found in |prev| and
+// then the longest run of lines that match with this offset. Line N of |curr| matches line
+// N + |offset| of |prev|.
+bool findShift(const std::vector<uint64_t>& curr,
+               const std::vector<uint64_t>& prev,
+               int* offset,
+               int* start,
+               int* length)
+{
+    const int count = static_cast<int>(curr.size());
+    DCHECK_EQ(curr.size(), prev.size());
+
+    // Lines that are repeated (for example, a solid background) match at any offset and are not
+    // used to find it.
+    std::unordered_map<uint64_t, int> prev_lines;
+    prev_lines.reserve(prev.size());
+
+    for (int i = 0; i < count; ++i)
+    {
+        auto result = prev_lines.emplace(prev[static_cast<size_t>(i)], i);
+        if (!result.second)
+            result.first->second = -1;
+    }
+
+    std::unordered_map<int, int> votes;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const uint64_t line = curr[static_cast<size_t>(i)];
+
+        // Unchanged lines vote for the zero offset, which is not a move.
+        if (line == prev[static_cast<size_t>(i)])
+            continue;
+
+        auto it = prev_lines.find(line);
+        if (it == prev_lines.end() || it->second < 0)
+            continue;
+
+        ++votes[it->second - i];
+    }
+
+    int best_offset = 0;
+    int best_votes = 0;
+
+    // On a tie the smaller offset wins, so the result does not depend on the map order.
+    auto is_better = [&](int offset, int count)
+    {
+        if (count != best_votes)
+            return count > best_votes;
+
+        if (std::abs(offset) != std::abs(best_offset))
+            return std::abs(offset) < std::abs(best_offset);
+
+        return offset < best_offset;
+    };
+
+    for (const auto& vote : votes)
+    {
+        if (is_better(vote.first, vote.second))
+        {
+            best_offset = vote.first;
+            best_votes = vote.second;
+        }
+    }
+
+    if (best_votes < kMinMatchingLines)
+        return false;
+
+    int best_start = 0;
+    int best_length = 0;
+    int run_start = 0;
+    int run_length = 0;
+
+    const int first = std::max(0, -best_offset);
+    const int last = std::min(count, count - best_offset);
+
+    for (int i = first; i < last; ++i)
+    {
+        if (curr[static_cast<size_t>(i)] == prev[static_cast<size_t>(i + best_offset)])
+        {
+            if (run_length == 0)
+                run_start = i;
+
+            ++run_length;
+
+            if (run_length > best_length)
+            {
+                best_start = run_start;
+                best_length = run_length;
+            }
+        }
+        else
+        {
+            run_length = 0;
+        }
+    }
+
+    if (best_length < kMinMoveLength)
+        return false;
+
+    *offset = best_offset;
+    *start = best_start;
+    *length = best_length;
+    return true;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+MoveDetector::MoveDetector()
+{
+#if defined(ARCH_CPU_X86_64)
+    if (CpuidUtil::hasSse42())
+        hash_block_func_ = hashBlock_32bpp_SSE42;
+    else
+        hash_block_func_ = hashBlock_32bpp_C;
+#else
+    hash_block_func_ = hashBlock_32bpp_C;
+#endif // defined(ARCH_CPU_X86_64)
+}
+
+//--------------------------------------------------------------------------------------------------
+MoveDetector::~MoveDetector() = default;
+
+//--------------------------------------------------------------------------------------------------
+void MoveDetector::detect(const Frame& frame, Region* updated_region, Moves* moves)
+{
+    DCHECK(updated_region);
+    DCHECK(moves);
+    DCHECK_EQ(frame.format().bytesPerPixel(), kBytesPerPixel);
+
+    moves->clear();
+
+    if (!prev_frame_ || prev_frame_->size() != frame.size())
+    {
+        // There is nothing to compare with.
+        update(frame, *updated_region);
+        return;
+    }
+
+    Region moved_region;
+
+    for (Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        if (rect.width() < kMinRectSize || rect.height() < kMinRectSize)
+            continue;
+
+        Move move;
+        if (!detectInRect(frame, rect, &move))
+            continue;
+
+        moved_region.addRect(Rect::makeXYWH(move.dest_pos, move.source_rect.size()));
+        moves->emplace_back(move);
+    }
+
+    // The copy must contain the moved areas too, so it is updated before they are removed.
+    update(frame, *updated_region);
+    updated_region->subtract(moved_region);
+}
+
+//--------------------------------------------------------------------------------------------------
+void MoveDetector::update(const Frame& frame, const Region& updated_region)
+{
+    if (!prev_frame_ || prev_frame_->size() != frame.size())
+    {
+        prev_frame_ = FrameAligned::create(frame.size(), frame.format(), 32);
+        if (!prev_frame_)
+        {
+            LOG(LS_ERROR) << "Unable to create frame";
+            return;
+        }
+
+        prev_frame_->copyPixelsFrom(frame, Point(0, 0), Rect::makeSize(frame.size()));
+        return;
+    }
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        prev_frame_->copyPixelsFrom(frame, rect.topLeft(), rect);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Searches for a vertical move, then for a horizontal move inside |rect|. Both the source and the
+// destination of the found move lie inside |rect|.
+bool MoveDetector::detectInRect(const Frame& frame, const Rect& rect, Move* move)
+{
+    int offset;
+    int start;
+    int length;
+
+    calcRowHashes(frame, rect, &curr_hashes_);
+    calcRowHashes(*prev_frame_, rect, &prev_hashes_);
+
+    if (findShift(curr_hashes_, prev_hashes_, &offset, &start, &length))
+    {
+        move->source_rect =
+            Rect::makeXYWH(rect.left(), rect.top() + start + offset, rect.width(), length);
+        move->dest_pos = Point(rect.left(), rect.top() + start);
+
+        if (isSameArea(frame, *move))
+            return true;
+    }
+
+    calcColumnHashes(frame, rect, &curr_hashes_);
+    calcColumnHashes(*prev_frame_, rect, &prev_hashes_);
+
+    if (findShift(curr_hashes_, prev_hashes_, &offset, &start, &length))
+    {
+        move->source_rect =
+            Rect::makeXYWH(rect.left() + start + offset, rect.top(), length, rect.height());
+        move->dest_pos = Point(rect.left() + start, rect.top());
+
+        if (isSameArea(frame, *move))
+            return true;
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+void MoveDetector::calcRowHashes(
+    const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes) const
+{
+    hashes->resize(static_cast<size_t>(rect.height()));
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        (*hashes)[static_cast<size_t>(y)] = hash_block_func_(
+            frame.frameDataAtPos(rect.left(), rect.top() + y), frame.stride(), rect.width(), 1);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void MoveDetector::calcColumnHashes(
+    const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes) const
+{
+    hashes->assign(static_cast<size_t>(rect.width()), 0);
+
+    // The image is read row by row to access memory sequentially.
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        const uint8_t* pixel = frame.frameDataAtPos(rect.left(), rect.top() + y);
+
+        for (size_t x = 0; x < hashes->size(); ++x)
+        {
+            uint32_t value;
+            memcpy(&value, pixel, sizeof(value));
+
+            (*hashes)[x] = ((*hashes)[x] ^ value) * kColumnHashPrime;
+            pixel += kBytesPerPixel;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Hashes can collide, so the areas are compared before the move is accepted.
+bool MoveDetector::isSameArea(const Frame& frame, const Move& move) const
+{
+    const Rect& source = move.source_rect;
+    const size_t bytes_per_row = static_cast<size_t>(source.width() * kBytesPerPixel);
+
+    for (int y = 0; y < source.height(); ++y)
+    {
+        const uint8_t* curr_row =
+            frame.frameDataAtPos(move.dest_pos.x(), move.dest_pos.y() + y);
+        const uint8_t* prev_row =
+            prev_frame_->frameDataAtPos(source.left(), source.top() + y);
+
+        if (memcmp(curr_row, prev_row, bytes_per_row) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace base
@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_DESKTOP_MOVE_DETECTOR_H
+#define BASE_DESKTOP_MOVE_DETECTOR_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+
+#include <memory>
+#include <vector>
+
+namespace base {
+
+class Frame;
+
+// Finds areas of the screen that were moved vertically or horizontally since the previous frame
+// (scrolled window contents, windows dragged along one axis). Such areas can be sent as a copy
+// instruction instead of pixels. The detector keeps its own copy of the previous frame, which is
+// updated only in the changed areas.
+class MoveDetector
+{
+public:
+    MoveDetector();
+    ~MoveDetector();
+
+    struct Move
+    {
+        Rect source_rect;
+        Point dest_pos;
+    };
+    using Moves = std::vector<Move>;
+
+    // Searches for moved areas in |updated_region| of |frame| (32 bits per pixel). Destinations of
+    // the found moves are removed from |updated_region|. Sources and destinations of different
+    // moves never overlap, so the moves can be applied in any order.
+    void detect(const Frame& frame, Region* updated_region, Moves* moves);
+
+    // Updates the copy of the previous frame without searching for moves. It is used for key frames
+    // which are sent entirely.
+    void update(const Frame& frame, const Region& updated_region);
+
+private:
+    typedef uint64_t(*HashBlockFunc)(const uint8_t*, int, int, int);
+
+    bool detectInRect(const Frame& frame, const Rect& rect, Move* move);
+    void calcRowHashes(const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes) const;
+    void calcColumnHashes(const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes) const;
+    bool isSameArea(const Frame& frame, const Move& move) const;
+
+    std::unique_ptr<Frame> prev_frame_;
+    HashBlockFunc hash_block_func_;
+
+    std::vector<uint64_t> curr_hashes_;
+    std::vector<uint64_t> prev_hashes_;
+
+    DISALLOW_COPY_AND_ASSIGN(MoveDetector);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_MOVE_DETECTOR_H
@@ -0,0 +1,179 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/move_detector.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+
+namespace base {
+
+namespace {
+
+const Size kScreenSize(640, 480);
+
+std::unique_ptr<Frame> createRandomFrame(std::mt19937& random)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    for (int y = 0; y < kScreenSize.height(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(0, y);
+        for (int x = 0; x < kScreenSize.width() * 4; ++x)
+            row[x] = static_cast<uint8_t>(random());
+    }
+
+    return frame;
+}
+
+std::unique_ptr<Frame> copyFrame(const Frame& frame)
+{
+    std::unique_ptr<Frame> copy = FrameSimple::create(frame.size(), frame.format());
+    copy->copyPixelsFrom(frame, Point(0, 0), Rect::makeSize(frame.size()));
+    return copy;
+}
+
+bool isSameFrame(const Frame& frame1, const Frame& frame2)
+{
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(0, y), frame2.frameDataAtPos(0, y),
+                   static_cast<size_t>(frame1.size().width() * 4)) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Applies the moves and the remaining region to |prev_frame| as the client does and checks that
+// the result is the same as |curr_frame|.
+bool isSameAfterMoves(Frame* prev_frame, const Frame& curr_frame, const Region& region,
+                      const MoveDetector::Moves& moves)
+{
+    for (const auto& move : moves)
+        prev_frame->moveRect(move.source_rect, move.dest_pos);
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        prev_frame->copyPixelsFrom(curr_frame, it.rect().topLeft(), it.rect());
+
+    return isSameFrame(*prev_frame, curr_frame);
+}
+
+} // namespace
+
+TEST(MoveDetectorTest, VerticalScroll)
+{
+    std::mt19937 random(1);
+    std::unique_ptr<Frame> prev_frame = createRandomFrame(random);
+
+    MoveDetector detector;
+    detector.update(*prev_frame, Region(Rect::makeSize(kScreenSize)));
+
+    // The content of the window is scrolled up by 17 rows and new rows appear at the bottom.
+    const Rect window = Rect::makeXYWH(100, 50, 400, 300);
+    const int kScroll = 17;
+
+    std::unique_ptr<Frame> curr_frame = copyFrame(*prev_frame);
+    curr_frame->moveRect(Rect::makeXYWH(window.left(), window.top() + kScroll,
+                                        window.width(), window.height() - kScroll),
+                         window.topLeft());
+
+    std::unique_ptr<Frame> new_rows = createRandomFrame(random);
+    Rect new_rows_rect = Rect::makeLTRB(
+        window.left(), window.bottom() - kScroll, window.right(), window.bottom());
+    curr_frame->copyPixelsFrom(*new_rows, new_rows_rect.topLeft(), new_rows_rect);
+
+    Region region(window);
+    MoveDetector::Moves moves;
+    detector.detect(*curr_frame, &region, &moves);
+
+    ASSERT_EQ(moves.size(), 1U);
+    EXPECT_TRUE(moves[0].source_rect.equals(
+        Rect::makeXYWH(window.left(), window.top() + kScroll,
+                       window.width(), window.height() - kScroll)));
+    EXPECT_TRUE(moves[0].dest_pos.equals(window.topLeft()));
+    EXPECT_TRUE(region.equals(Region(new_rows_rect)));
+
+    EXPECT_TRUE(isSameAfterMoves(prev_frame.get(), *curr_frame, region, moves));
+}
+
+TEST(MoveDetectorTest, HorizontalScroll)
+{
+    std::mt19937 random(2);
+    std::unique_ptr<Frame> prev_frame = createRandomFrame(random);
+
+    MoveDetector detector;
+    detector.update(*prev_frame, Region(Rect::makeSize(kScreenSize)));
+
+    // The content of the window is scrolled right by 40 columns.
+    const Rect window = Rect::makeXYWH(64, 100, 500, 200);
+    const int kScroll = 40;
+
+    std::unique_ptr<Frame> curr_frame = copyFrame(*prev_frame);
+    curr_frame->moveRect(Rect::makeXYWH(window.left(), window.top(),
+                                        window.width() - kScroll, window.height()),
+                         Point(window.left() + kScroll, window.top()));
+
+    std::unique_ptr<Frame> new_columns = createRandomFrame(random);
+    Rect new_columns_rect = Rect::makeXYWH(window.left(), window.top(), kScroll, window.height());
+    curr_frame->copyPixelsFrom(*new_columns, new_columns_rect.topLeft(), new_columns_rect);
+
+    Region region(window);
+    MoveDetector::Moves moves;
+    detector.detect(*curr_frame, &region, &moves);
+
+    ASSERT_EQ(moves.size(), 1U);
+    EXPECT_TRUE(moves[0].dest_pos.equals(Point(window.left() + kScroll, window.top())));
+    EXPECT_TRUE(region.equals(Region(new_columns_rect)));
+
+    EXPECT_TRUE(isSameAfterMoves(prev_frame.get(), *curr_frame, region, moves));
+}
+
+TEST(MoveDetectorTest, NoMove)
+{
+    std::mt19937 random(3);
+    std::unique_ptr<Frame> prev_frame = createRandomFrame(random);
+
+    MoveDetector detector;
+    detector.update(*prev_frame, Region(Rect::makeSize(kScreenSize)));
+
+    const Rect window = Rect::makeXYWH(0, 0, 320, 240);
+
+    std::unique_ptr<Frame> curr_frame = copyFrame(*prev_frame);
+    std::unique_ptr<Frame> changes = createRandomFrame(random);
+    curr_frame->copyPixelsFrom(*changes, window.topLeft(), window);
+
+    Region region(window);
+    MoveDetector::Moves moves;
+    detector.detect(*curr_frame, &region, &moves);
+
+    EXPECT_TRUE(moves.empty());
+    EXPECT_TRUE(region.equals(Region(window)));
+
+    // The detector tracks the changes, so the same frame does not produce moves.
+    detector.detect(*curr_frame, &region, &moves);
+    EXPECT_TRUE(moves.empty());
+}
+
+} // namespace base
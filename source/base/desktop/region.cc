@@ -73,6 +73,7 @@ Region::Region(const Region& other)
 //--------------------------------------------------------------------------------------------------
 Region::Region(Region&& other) noexcept
 {
+    miRegionInit(&x11reg_, NullBox, 0);
     *this = std::move(other);
 }
 
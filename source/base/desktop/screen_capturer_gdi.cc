@@ -18,6 +18,7 @@
 
 #include "base/desktop/screen_capturer_gdi.h"
 
+#include "base/environment.h"
 #include "base/logging.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/win/cursor.h"
@@ -52,6 +53,14 @@ ScreenCapturerGdi::ScreenCapturerGdi()
     memset(&curr_cursor_info_, 0, sizeof(curr_cursor_info_));
     memset(&prev_cursor_info_, 0, sizeof(prev_cursor_info_));
 
+    // Comparing block fingerprints does not read the previous frame, but a collision of
+    // fingerprints hides a change. The exact comparison is used unless the variable is set.
+    if (Environment::has("ASPIA_GDI_HASH_DIFFER"))
+    {
+        LOG(LS_INFO) << "Hash differ enabled by environment variable";
+        hash_differ_ = true;
+    }
+
     dwmapi_dll_ = LoadLibraryExW(L"dwmapi.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32);
     if (dwmapi_dll_)
     {
@@ -278,7 +287,17 @@ const Frame* ScreenCapturerGdi::captureImage()
 
     current->setTopLeft(screen_rect_.topLeft().subtract(desktop_dc_rect_.topLeft()));
 
-    if (!previous || previous->size() != current->size())
+    if (hash_differ_)
+    {
+        if (!previous || previous->size() != current->size())
+            differ_ = std::make_unique<Differ>(screen_rect_.size());
+
+        // The differ compares the frame with the block fingerprints of the previous frame, so the
+        // previous frame is not read. The first frame after creating the differ is changed
+        // entirely.
+        differ_->calcDirtyRegion(current->frameData(), current->updatedRegion());
+    }
+    else if (!previous || previous->size() != current->size())
     {
         differ_ = std::make_unique<Differ>(screen_rect_.size());
         current->updatedRegion()->addRect(Rect::makeSize(screen_rect_.size()));
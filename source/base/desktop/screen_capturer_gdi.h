@@ -67,6 +67,9 @@ private:
     Rect desktop_dc_rect_;
     Rect screen_rect_;
 
+    // If true, changes are found by the block fingerprints of the previous frame instead of
+    // comparing with the previous frame.
+    bool hash_differ_ = false;
     std::unique_ptr<Differ> differ_;
     win::ScopedGetDC desktop_dc_;
     win::ScopedCreateDC memory_dc_;
@@ -18,22 +18,51 @@
 
 #include "base/desktop/screen_capturer_x11.h"
 
+#include "base/environment.h"
 #include "base/logging.h"
+#include "base/desktop/frame_aligned.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/shared_memory_frame.h"
 #include "base/desktop/x11/x_error_trap.h"
 #include "base/memory/byte_array.h"
+#include "base/strings/string_number_conversions.h"
 
 #include <dlfcn.h>
 
 namespace base {
 
+namespace {
+
+// Maximum interval (in frames) between verification passes.
+const int kMaxVerifyInterval = 1000;
+
+} // namespace
+
 //--------------------------------------------------------------------------------------------------
 ScreenCapturerX11::ScreenCapturerX11()
     : ScreenCapturer(ScreenCapturer::Type::LINUX_X11)
 {
     LOG(LS_INFO) << "Ctor";
     helper_.setLogGridSize(4);
+
+    std::string verify_interval_string;
+    if (Environment::get("ASPIA_X11_DAMAGE_VERIFY_INTERVAL", &verify_interval_string))
+    {
+        int verify_interval = 0;
+
+        if (stringToInt(verify_interval_string, &verify_interval) &&
+            verify_interval >= 0 && verify_interval <= kMaxVerifyInterval)
+        {
+            LOG(LS_INFO) << "Damage verify interval specified by environment variable: "
+                         << verify_interval;
+            verify_interval_ = verify_interval;
+        }
+        else
+        {
+            LOG(LS_INFO) << "Environment variable contains an incorrect damage verify interval: "
+                         << verify_interval_string;
+        }
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -182,6 +211,9 @@ const Frame* ScreenCapturerX11::captureFrame(Error* error)
         // properly, and our frame buffer will not be overrun while blitting.
         frame->setTopLeft(selected_monitor_rect_.topLeft());
         queue_.replaceCurrentFrame(std::move(frame));
+
+        // The new frame is empty and must be captured entirely.
+        has_full_frame_ = false;
     }
 
     Frame* result = captureFrameImpl();
@@ -193,7 +225,6 @@ const Frame* ScreenCapturerX11::captureFrame(Error* error)
     }
 
     Region* updated_region = result->updatedRegion();
-    last_invalid_region_ = *updated_region;
     updated_region->translate(-selected_monitor_rect_.left(), -selected_monitor_rect_.top());
 
     *error = Error::SUCCEEDED;
@@ -361,6 +392,7 @@ bool ScreenCapturerX11::handleXEvent(const XEvent& event)
             return false;
 
         DCHECK(damage_event->level == XDamageReportNonEmpty);
+        damage_pending_ = true;
         return true;
     }
     else if (use_randr_ && event.type == randr_event_base_ + RRScreenChangeNotify)
@@ -518,32 +550,6 @@ void ScreenCapturerX11::screenConfigurationChanged()
         selected_monitor_rect_ = Rect::makeSize(x_server_pixel_buffer_.windowSize());
 }
 
-//--------------------------------------------------------------------------------------------------
-void ScreenCapturerX11::synchronizeFrame()
-{
-    // Synchronize the current buffer with the previous one since we do not capture the entire
-    // desktop. Note that encoder may be reading from the previous buffer at this time so thread
-    // access complaints are false positives.
-
-    // TODO(hclam): We can reduce the amount of copying here by subtracting |capturer_helper_|s
-    // region from |last_invalid_region_|. http://crbug.com/92354
-    DCHECK(queue_.previousFrame());
-
-    Frame* current = queue_.currentFrame();
-    Frame* last = queue_.previousFrame();
-    DCHECK(current != last);
-
-    for (Region::Iterator it(last_invalid_region_); !it.isAtEnd(); it.advance())
-    {
-        if (selected_monitor_rect_.containsRect(it.rect()))
-        {
-            Rect r = it.rect();
-            r.translate(-selected_monitor_rect_.left(), -selected_monitor_rect_.top());
-            current->copyPixelsFrom(*last, r.topLeft(), r);
-        }
-    }
-}
-
 //--------------------------------------------------------------------------------------------------
 void ScreenCapturerX11::deinitXlib()
 {
@@ -586,56 +592,117 @@ Frame* ScreenCapturerX11::captureFrameImpl()
     // region to a grid.
     helper_.setSizeMostRecent(x_server_pixel_buffer_.windowSize());
 
-    // In the DAMAGE case, ensure the frame is up-to-date with the previous frame if any. If there
-    // isn't a previous frame, that means a screen-resolution change occurred, and |invalid_rects|
-    // will be updated to include the whole screen.
-    if (use_damage_ && queue_.previousFrame())
-        synchronizeFrame();
-
     Region* updated_region = frame->updatedRegion();
 
     // Clear updated region.
     updated_region->clear();
 
-    x_server_pixel_buffer_.synchronize();
-    if (use_damage_ && queue_.previousFrame())
-    {
-        // Atomically fetch and clear the damage region.
-        XDamageSubtract(display(), damage_handle_, None, damage_region_);
-        int rectsNum = 0;
-        XRectangle bounds;
-        XRectangle* rects = XFixesFetchRegionAndBounds(display(), damage_region_,
-                                                       &rectsNum, &bounds);
-        for (int i = 0; i < rectsNum; ++i)
+    if (use_damage_ && has_full_frame_)
+    {
+        // The frame already contains the whole screen, so only the areas reported by XDamage need
+        // to be read from the X server. If nothing has been reported since the last capture, the
+        // X server is not queried at all.
+        if (damage_pending_)
         {
-            updated_region->addRect(
-                Rect::makeXYWH(rects[i].x, rects[i].y, rects[i].width, rects[i].height));
+            damage_pending_ = false;
+
+            // Atomically fetch and clear the damage region.
+            XDamageSubtract(display(), damage_handle_, None, damage_region_);
+            int rectsNum = 0;
+            XRectangle bounds;
+            XRectangle* rects = XFixesFetchRegionAndBounds(display(), damage_region_,
+                                                           &rectsNum, &bounds);
+            for (int i = 0; i < rectsNum; ++i)
+            {
+                updated_region->addRect(
+                    Rect::makeXYWH(rects[i].x, rects[i].y, rects[i].width, rects[i].height));
+            }
+            XFree(rects);
+            helper_.invalidateRegion(*updated_region);
+            updated_region->clear();
         }
-        XFree(rects);
-        helper_.invalidateRegion(*updated_region);
 
         // Capture the damaged portions of the desktop.
         helper_.takeInvalidRegion(updated_region);
         updated_region->intersectWith(selected_monitor_rect_);
 
-        //for (const auto& rect : *updated_region)
-        for (Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+        if (!updated_region->isEmpty() &&
+            !x_server_pixel_buffer_.captureRegion(*updated_region, frame))
         {
-            if (!x_server_pixel_buffer_.captureRect(it.rect(), frame))
+            return nullptr;
+        }
+
+        if (verify_interval_ > 0 && ++frames_since_verify_ >= verify_interval_)
+        {
+            frames_since_verify_ = 0;
+
+            if (!verifyFrame(frame))
                 return nullptr;
         }
     }
     else
     {
+        if (use_damage_)
+        {
+            // Everything damaged up to this point is covered by the full-screen capture below.
+            damage_pending_ = false;
+            XDamageSubtract(display(), damage_handle_, None, None);
+            helper_.clearInvalidRegion();
+        }
+
         // Doing full-screen polling, or this is the first capture after a screen-resolution change.
-        //In either case, need a full-screen capture.
+        // In either case, need a full-screen capture.
+        x_server_pixel_buffer_.synchronize();
         if (!x_server_pixel_buffer_.captureRect(selected_monitor_rect_, frame))
             return nullptr;
 
         *updated_region = Region(selected_monitor_rect_);
+        has_full_frame_ = true;
+        frames_since_verify_ = 0;
     }
 
     return frame;
 }
 
+//--------------------------------------------------------------------------------------------------
+bool ScreenCapturerX11::verifyFrame(Frame* frame)
+{
+    const Size& size = frame->size();
+
+    if (!verify_frame_ || !verify_frame_->size().equals(size))
+    {
+        verify_frame_ = FrameAligned::create(size, PixelFormat::ARGB(), 32);
+        verify_differ_ = std::make_unique<Differ>(size);
+    }
+
+    if (!verify_frame_)
+    {
+        LOG(LS_ERROR) << "Unable to create verification frame";
+        return false;
+    }
+
+    verify_frame_->setTopLeft(selected_monitor_rect_.topLeft());
+
+    x_server_pixel_buffer_.synchronize();
+    if (!x_server_pixel_buffer_.captureRect(selected_monitor_rect_, verify_frame_.get()))
+        return false;
+
+    Region missed_region;
+    verify_differ_->calcDirtyRegion(
+        frame->frameData(), verify_frame_->frameData(), &missed_region);
+
+    if (missed_region.isEmpty())
+        return true;
+
+    LOG(LS_INFO) << "XDamage missed some changes on the screen";
+
+    for (Region::Iterator it(missed_region); !it.isAtEnd(); it.advance())
+        frame->copyPixelsFrom(*verify_frame_, it.rect().topLeft(), it.rect());
+
+    // The updated region is in the root window coordinates at this point.
+    missed_region.translate(selected_monitor_rect_.left(), selected_monitor_rect_.top());
+    frame->updatedRegion()->addRegion(missed_region);
+    return true;
+}
+
 } // namespace base
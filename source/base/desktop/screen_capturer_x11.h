@@ -19,6 +19,7 @@
 #ifndef BASE_DESKTOP_SCREEN_CAPTURER_X11_H
 #define BASE_DESKTOP_SCREEN_CAPTURER_X11_H
 
+#include "base/desktop/differ.h"
 #include "base/desktop/screen_capturer.h"
 #include "base/desktop/screen_capturer_helper.h"
 #include "base/desktop/frame.h"
@@ -76,17 +77,14 @@ private:
     // Called when the screen configuration is changed.
     void screenConfigurationChanged();
 
-    // Synchronize the current buffer with |last_buffer_|, by copying pixels from the area of
-    // |last_invalid_rects|.
-    // Note this only works on the assumption that kNumBuffers == 2, as |last_invalid_rects| holds
-    // the differences from the previous buffer and the one prior to that (which will then be the
-    // current buffer).
-    void synchronizeFrame();
-
     void deinitXlib();
 
     Frame* captureFrameImpl();
 
+    // Captures the whole screen and compares it with |frame|. Areas for which XDamage did not
+    // report changes are copied to |frame| and added to its updated region.
+    bool verifyFrame(Frame* frame);
+
     base::local_shared_ptr<SharedXDisplay> display_;
 
     // X11 graphics context.
@@ -123,6 +121,20 @@ private:
     int damage_error_base_ = -1;
     XserverRegion damage_region_ = 0;
 
+    // True if XDamage has reported changes since the last capture.
+    bool damage_pending_ = false;
+
+    // True if the current frame contains the whole screen. After that only the damaged areas are
+    // captured into it.
+    bool has_full_frame_ = false;
+
+    // Every N-th frame the whole screen is captured to find changes not reported by XDamage.
+    // 0 disables the verification.
+    int verify_interval_ = 0;
+    int frames_since_verify_ = 0;
+    std::unique_ptr<Frame> verify_frame_;
+    std::unique_ptr<Differ> verify_differ_;
+
     // Access to the X Server's pixel buffer.
     XServerPixelBuffer x_server_pixel_buffer_;
 
@@ -130,13 +142,10 @@ private:
     // recently captured screen.
     ScreenCapturerHelper helper_;
 
-    // Queue of the frames buffers.
+    // Queue of the frames buffers. Only the current frame is used: it always contains the whole
+    // screen and only the damaged areas are updated in it.
     FrameQueue<Frame> queue_;
 
-    // Invalid region from the previous capture. This is used to synchronize the
-    // current with the last buffer used.
-    Region last_invalid_region_;
-
     std::unique_ptr<XAtomCache> atom_cache_;
     std::unique_ptr<MouseCursor> mouse_cursor_;
 
@@ -0,0 +1,299 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/shared_frame_ring.h"
+
+#include "base/logging.h"
+#include "base/ipc/shared_memory.h"
+#include "base/ipc/shared_memory_factory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+namespace base {
+
+namespace {
+
+const uint32_t kMagic = 0x41535246; // "ASRF"
+const uint32_t kNewFrameFlag = 0x80000000;
+const uint32_t kSlotMask = 0x0000000F;
+const int kMaxRects = 128;
+const int kMaxFrameSize = 16384;
+const size_t kAlignment = 64;
+
+// The index is shared between processes, so it must not use a lock.
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+size_t alignSize(size_t size)
+{
+    return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+bool isValidSize(const Size& size)
+{
+    return !size.isEmpty() && size.width() <= kMaxFrameSize && size.height() <= kMaxFrameSize;
+}
+
+} // namespace
+
+struct SharedFrameRing::Header
+{
+    struct Slot
+    {
+        uint32_t capturer_type;
+
+        // Updated region of the frame: x, y, width and height of each rectangle.
+        int32_t rect_count;
+        int32_t rects[kMaxRects][4];
+    };
+
+    uint32_t magic;
+    int32_t width;
+    int32_t height;
+
+    // Index of the slot with the latest published frame. kNewFrameFlag is set until the reader
+    // takes the frame.
+    std::atomic<uint32_t> latest_slot;
+
+    Slot slots[kSlotCount];
+};
+
+class SharedFrameRing::SlotFrame final : public Frame
+{
+public:
+    SlotFrame(const Size& size, uint8_t* data, SharedMemoryBase* shared_memory)
+        : Frame(size, PixelFormat::ARGB(), size.width() * PixelFormat::ARGB().bytesPerPixel(),
+                data, shared_memory)
+    {
+        // Nothing
+    }
+
+    ~SlotFrame() final = default;
+
+    static size_t memorySize(const Size& size)
+    {
+        return alignSize(calcMemorySize(size, PixelFormat::ARGB().bytesPerPixel()));
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(SlotFrame);
+};
+
+//--------------------------------------------------------------------------------------------------
+SharedFrameRing::SharedFrameRing(const Size& size, std::unique_ptr<SharedMemoryBase> shared_memory)
+    : size_(size),
+      shared_memory_(std::move(shared_memory)),
+      header_(reinterpret_cast<Header*>(shared_memory_->data())),
+      own_slot_(0)
+{
+    uint8_t* data = reinterpret_cast<uint8_t*>(shared_memory_->data()) + alignSize(sizeof(Header));
+    const size_t slot_size = SlotFrame::memorySize(size_);
+
+    for (int i = 0; i < kSlotCount; ++i)
+        frames_[i] = std::make_unique<SlotFrame>(size_, data + i * slot_size, shared_memory_.get());
+}
+
+//--------------------------------------------------------------------------------------------------
+SharedFrameRing::~SharedFrameRing() = default;
+
+//--------------------------------------------------------------------------------------------------
+// static
+std::unique_ptr<SharedFrameRing> SharedFrameRing::create(
+    const Size& size, SharedMemoryFactory* shared_memory_factory)
+{
+    DCHECK(shared_memory_factory);
+
+    if (!isValidSize(size))
+    {
+        LOG(LS_ERROR) << "Invalid frame size: " << size;
+        return nullptr;
+    }
+
+    const size_t memory_size = alignSize(sizeof(Header)) + SlotFrame::memorySize(size) * kSlotCount;
+
+    std::unique_ptr<SharedMemory> shared_memory = shared_memory_factory->create(memory_size);
+    if (!shared_memory)
+    {
+        LOG(LS_ERROR) << "SharedMemoryFactory::create failed for size: " << memory_size;
+        return nullptr;
+    }
+
+    Header* header = new (shared_memory->data()) Header();
+    header->magic = kMagic;
+    header->width = size.width();
+    header->height = size.height();
+
+    // The writer starts with slot 0 and the reader with slot 2. Slot 1 holds no frame yet.
+    header->latest_slot.store(1, std::memory_order_release);
+
+    std::unique_ptr<SharedFrameRing> ring(new SharedFrameRing(size, std::move(shared_memory)));
+    ring->own_slot_ = 0;
+
+    // No slot contains the image yet.
+    for (int i = 0; i < kSlotCount; ++i)
+        ring->stale_region_[i] = Region(Rect::makeSize(size));
+
+    return ring;
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+std::unique_ptr<SharedFrameRing> SharedFrameRing::attach(
+    std::unique_ptr<SharedMemoryBase> shared_memory)
+{
+    if (!shared_memory)
+        return nullptr;
+
+    const Header* header = reinterpret_cast<const Header*>(shared_memory->data());
+    if (header->magic != kMagic)
+    {
+        LOG(LS_ERROR) << "Shared memory " << shared_memory->id() << " is not a frame ring";
+        return nullptr;
+    }
+
+    Size size(header->width, header->height);
+    if (!isValidSize(size))
+    {
+        LOG(LS_ERROR) << "Invalid frame size: " << size;
+        return nullptr;
+    }
+
+    std::unique_ptr<SharedFrameRing> ring(new SharedFrameRing(size, std::move(shared_memory)));
+    ring->own_slot_ = 2;
+    return ring;
+}
+
+//--------------------------------------------------------------------------------------------------
+int SharedFrameRing::id() const
+{
+    return shared_memory_->id();
+}
+
+//--------------------------------------------------------------------------------------------------
+void SharedFrameRing::writeFrame(const Frame& frame)
+{
+    DCHECK(frame.size() == size_);
+    DCHECK_LT(own_slot_, static_cast<uint32_t>(kSlotCount));
+
+    const Region& updated_region = frame.constUpdatedRegion();
+
+    // The slot gets the changes of the frame and the changes it has missed since it was written
+    // last time. After that it contains the whole image of the frame.
+    Region* stale_region = &stale_region_[own_slot_];
+    stale_region->addRegion(updated_region);
+
+    SlotFrame* slot_frame = frames_[own_slot_].get();
+    for (Region::Iterator it(*stale_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        slot_frame->copyPixelsFrom(frame, rect.topLeft(), rect);
+    }
+
+    stale_region->clear();
+
+    for (uint32_t i = 0; i < kSlotCount; ++i)
+    {
+        if (i != own_slot_)
+            stale_region_[i].addRegion(updated_region);
+    }
+
+    // If the reader has not taken the previous frame, it will take this one instead. The changes
+    // of the previous frame are passed on with this one. Only the reader clears the flag, so if
+    // it is not set now, the previous frame has already been taken.
+    Region region(updated_region);
+    if (header_->latest_slot.load(std::memory_order_acquire) & kNewFrameFlag)
+        region.addRegion(last_region_);
+
+    Header::Slot* slot = &header_->slots[own_slot_];
+    slot->capturer_type = frame.capturerType();
+
+    int rect_count = 0;
+    Rect bounds;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        if (rect_count < kMaxRects)
+        {
+            slot->rects[rect_count][0] = rect.x();
+            slot->rects[rect_count][1] = rect.y();
+            slot->rects[rect_count][2] = rect.width();
+            slot->rects[rect_count][3] = rect.height();
+        }
+
+        bounds.unionWith(rect);
+        ++rect_count;
+    }
+
+    if (rect_count > kMaxRects)
+    {
+        // Too many rectangles. The reader gets the bounding rectangle of the region.
+        slot->rects[0][0] = bounds.x();
+        slot->rects[0][1] = bounds.y();
+        slot->rects[0][2] = bounds.width();
+        slot->rects[0][3] = bounds.height();
+        rect_count = 1;
+    }
+
+    slot->rect_count = rect_count;
+    last_region_.swap(&region);
+
+    // Publish the slot and take the previous one. It is free: the reader holds another slot.
+    own_slot_ = header_->latest_slot.exchange(
+        own_slot_ | kNewFrameFlag, std::memory_order_acq_rel) & kSlotMask;
+}
+
+//--------------------------------------------------------------------------------------------------
+Frame* SharedFrameRing::readFrame()
+{
+    if (!(header_->latest_slot.load(std::memory_order_acquire) & kNewFrameFlag))
+        return nullptr;
+
+    uint32_t slot_index =
+        header_->latest_slot.exchange(own_slot_, std::memory_order_acq_rel) & kSlotMask;
+    if (slot_index >= kSlotCount)
+    {
+        LOG(LS_ERROR) << "Invalid slot index: " << slot_index;
+        return nullptr;
+    }
+
+    own_slot_ = slot_index;
+
+    const Header::Slot& slot = header_->slots[own_slot_];
+    SlotFrame* frame = frames_[own_slot_].get();
+
+    Region* updated_region = frame->updatedRegion();
+    updated_region->clear();
+
+    const int rect_count = std::clamp(slot.rect_count, 0, kMaxRects);
+    for (int i = 0; i < rect_count; ++i)
+    {
+        updated_region->addRect(Rect::makeXYWH(
+            slot.rects[i][0], slot.rects[i][1], slot.rects[i][2], slot.rects[i][3]));
+    }
+
+    // The header is written by another process. The region must not go beyond the frame.
+    updated_region->intersectWith(Rect::makeSize(size_));
+
+    frame->setCapturerType(slot.capturer_type);
+    return frame;
+}
+
+} // namespace base
@@ -0,0 +1,90 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_DESKTOP_SHARED_FRAME_RING_H
+#define BASE_DESKTOP_SHARED_FRAME_RING_H
+
+#include "base/desktop/frame.h"
+
+#include <memory>
+
+namespace base {
+
+class SharedMemoryBase;
+class SharedMemoryFactory;
+
+// Ring of frames in one shared memory that passes captured frames from the desktop agent to the
+// service. The writer always has a free slot to capture into and the reader always gets the
+// latest completed frame, so neither side waits for the other.
+// The slots are exchanged through a single atomic index in the shared header (a lock-free triple
+// buffer). The header also holds the updated region of each slot. If the reader skips a frame,
+// the updated region of the skipped frame is merged into the next one, so no changes are lost.
+// Only one writer and one reader may use a ring.
+class SharedFrameRing
+{
+public:
+    ~SharedFrameRing();
+
+    // Creates a ring for frames of |size| on the writer side.
+    static std::unique_ptr<SharedFrameRing> create(
+        const Size& size, SharedMemoryFactory* shared_memory_factory);
+
+    // Attaches to a ring created by the writer on the reader side. The shared memory must be
+    // opened for writing.
+    static std::unique_ptr<SharedFrameRing> attach(std::unique_ptr<SharedMemoryBase> shared_memory);
+
+    int id() const;
+    const Size& size() const { return size_; }
+
+    // Copies the changed areas of |frame| into a free slot and publishes it as the latest frame.
+    // The frame must contain the whole image, not just the updated region.
+    void writeFrame(const Frame& frame);
+
+    // Takes the latest published frame. Its updated region contains all changes since the frame
+    // returned by the previous call. Returns nullptr if nothing has been published since then.
+    // The frame is valid until the next call.
+    Frame* readFrame();
+
+private:
+    class SlotFrame;
+    struct Header;
+
+    SharedFrameRing(const Size& size, std::unique_ptr<SharedMemoryBase> shared_memory);
+
+    static const int kSlotCount = 3;
+
+    const Size size_;
+    std::unique_ptr<SharedMemoryBase> shared_memory_;
+    Header* header_;
+    std::unique_ptr<SlotFrame> frames_[kSlotCount];
+
+    // Slot owned by this side of the ring (the back slot for the writer, the front slot for the
+    // reader).
+    uint32_t own_slot_;
+
+    // Used only by the writer. Areas that each slot misses compared to the latest frame and the
+    // updated region of the last published frame.
+    Region stale_region_[kSlotCount];
+    Region last_region_;
+
+    DISALLOW_COPY_AND_ASSIGN(SharedFrameRing);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_SHARED_FRAME_RING_H
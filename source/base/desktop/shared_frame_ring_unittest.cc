@@ -0,0 +1,212 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/shared_frame_ring.h"
+
+#include "base/desktop/frame_simple.h"
+#include "base/ipc/shared_memory.h"
+#include "base/ipc/shared_memory_factory.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+
+namespace base {
+
+namespace {
+
+const Size kScreenSize(320, 240);
+
+class FakeSharedMemoryDelegate : public SharedMemoryFactory::Delegate
+{
+public:
+    void onSharedMemoryCreate(int /* id */) override {}
+    void onSharedMemoryDestroy(int /* id */) override {}
+};
+
+void fillRect(Frame* frame, const Rect& rect, std::mt19937& random)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+        for (int x = 0; x < rect.width() * 4; ++x)
+            row[x] = static_cast<uint8_t>(random());
+    }
+
+    frame->updatedRegion()->addRect(rect);
+}
+
+Rect randomRect(std::mt19937& random)
+{
+    int x = static_cast<int>(random() % (kScreenSize.width() - 1));
+    int y = static_cast<int>(random() % (kScreenSize.height() - 1));
+    int width = 1 + static_cast<int>(random() % (kScreenSize.width() - x));
+    int height = 1 + static_cast<int>(random() % (kScreenSize.height() - y));
+    return Rect::makeXYWH(x, y, width, height);
+}
+
+bool isSameFrame(const Frame& frame1, const Frame& frame2)
+{
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(0, y), frame2.frameDataAtPos(0, y),
+                   static_cast<size_t>(frame1.size().width() * 4)) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+class SharedFrameRingTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        factory_ = std::make_unique<SharedMemoryFactory>(&delegate_);
+
+        writer_ = SharedFrameRing::create(kScreenSize, factory_.get());
+        ASSERT_TRUE(writer_);
+
+        reader_ = SharedFrameRing::attach(
+            SharedMemory::open(SharedMemory::Mode::READ_WRITE, writer_->id()));
+        ASSERT_TRUE(reader_);
+        EXPECT_EQ(reader_->size(), kScreenSize);
+
+        source_ = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+        mirror_ = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    }
+
+    // Applies the updated region of |frame| to the mirror, as the service does.
+    void applyToMirror(const Frame& frame)
+    {
+        for (Region::Iterator it(frame.constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        {
+            const Rect& rect = it.rect();
+            mirror_->copyPixelsFrom(frame, rect.topLeft(), rect);
+        }
+    }
+
+    FakeSharedMemoryDelegate delegate_;
+    std::unique_ptr<SharedMemoryFactory> factory_;
+    std::unique_ptr<SharedFrameRing> writer_;
+    std::unique_ptr<SharedFrameRing> reader_;
+    std::unique_ptr<Frame> source_;
+    std::unique_ptr<Frame> mirror_;
+};
+
+} // namespace
+
+TEST_F(SharedFrameRingTest, NoFrames)
+{
+    EXPECT_EQ(reader_->readFrame(), nullptr);
+}
+
+TEST_F(SharedFrameRingTest, ReadEachFrame)
+{
+    std::mt19937 random(1);
+
+    fillRect(source_.get(), Rect::makeSize(kScreenSize), random);
+    source_->setCapturerType(7);
+    writer_->writeFrame(*source_);
+
+    Frame* frame = reader_->readFrame();
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->capturerType(), 7u);
+    EXPECT_TRUE(frame->constUpdatedRegion().equals(Region(Rect::makeSize(kScreenSize))));
+    EXPECT_TRUE(isSameFrame(*frame, *source_));
+    EXPECT_EQ(reader_->readFrame(), nullptr);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        source_->updatedRegion()->clear();
+        fillRect(source_.get(), randomRect(random), random);
+        writer_->writeFrame(*source_);
+
+        frame = reader_->readFrame();
+        ASSERT_TRUE(frame);
+        EXPECT_TRUE(frame->constUpdatedRegion().equals(source_->constUpdatedRegion()));
+        EXPECT_TRUE(isSameFrame(*frame, *source_));
+    }
+}
+
+TEST_F(SharedFrameRingTest, SkippedFrames)
+{
+    std::mt19937 random(2);
+
+    fillRect(source_.get(), Rect::makeSize(kScreenSize), random);
+    writer_->writeFrame(*source_);
+    applyToMirror(*reader_->readFrame());
+
+    Region expected;
+
+    for (int i = 0; i < 5; ++i)
+    {
+        source_->updatedRegion()->clear();
+        fillRect(source_.get(), randomRect(random), random);
+        expected.addRegion(source_->constUpdatedRegion());
+        writer_->writeFrame(*source_);
+    }
+
+    // The reader gets only the latest frame, but with the changes of all skipped frames.
+    Frame* frame = reader_->readFrame();
+    ASSERT_TRUE(frame);
+    EXPECT_TRUE(frame->constUpdatedRegion().equals(expected));
+    EXPECT_TRUE(isSameFrame(*frame, *source_));
+
+    applyToMirror(*frame);
+    EXPECT_TRUE(isSameFrame(*mirror_, *source_));
+}
+
+TEST_F(SharedFrameRingTest, RandomReads)
+{
+    std::mt19937 random(3);
+
+    fillRect(source_.get(), Rect::makeSize(kScreenSize), random);
+    writer_->writeFrame(*source_);
+
+    for (int i = 0; i < 500; ++i)
+    {
+        if (random() % 3 == 0)
+        {
+            Frame* frame = reader_->readFrame();
+            if (frame)
+            {
+                applyToMirror(*frame);
+                EXPECT_TRUE(isSameFrame(*mirror_, *source_));
+            }
+        }
+
+        source_->updatedRegion()->clear();
+
+        const int rect_count = 1 + static_cast<int>(random() % 4);
+        for (int j = 0; j < rect_count; ++j)
+            fillRect(source_.get(), randomRect(random), random);
+
+        writer_->writeFrame(*source_);
+    }
+
+    Frame* frame = reader_->readFrame();
+    ASSERT_TRUE(frame);
+    applyToMirror(*frame);
+    EXPECT_TRUE(isSameFrame(*mirror_, *source_));
+}
+
+} // namespace base
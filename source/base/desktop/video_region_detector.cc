@@ -0,0 +1,211 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/video_region_detector.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+// With every frame the score of a block is multiplied by 7/8 and increased by |kChangeScore| if
+// the block is changed. The score of a block that changes in every frame tends to 256.
+const int kChangeScore = 32;
+
+// A block that has changed in about 8 frames in a row is active.
+const int kActiveScore = 160;
+
+// The detected area is kept while at least half of its blocks have this score.
+const int kKeepScore = 96;
+
+// Minimum number of active blocks in a new area.
+const int kMinActiveBlocks = 4;
+
+// Number of samples along each side of a block that are used to check the content.
+const int kSamplesPerSide = 16;
+
+// A block with at least this number of different colors among the samples contains a natural
+// image. Text and user interface elements have much fewer colors, even with anti-aliasing.
+const size_t kMinNaturalColors = 64;
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+VideoRegionDetector::VideoRegionDetector() = default;
+
+//--------------------------------------------------------------------------------------------------
+VideoRegionDetector::~VideoRegionDetector() = default;
+
+//--------------------------------------------------------------------------------------------------
+Rect VideoRegionDetector::detect(const Frame& frame, const Region& changed_region)
+{
+    if (size_ != frame.size())
+    {
+        size_ = frame.size();
+        columns_ = (size_.width() + kBlockSize - 1) / kBlockSize;
+        rows_ = (size_.height() + kBlockSize - 1) / kBlockSize;
+
+        blocks_.clear();
+        blocks_.resize(static_cast<size_t>(columns_ * rows_));
+        current_rect_ = Rect();
+    }
+
+    std::vector<bool> changed(blocks_.size(), false);
+
+    for (Region::Iterator it(changed_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        for (int row = rect.top() / kBlockSize; row <= (rect.bottom() - 1) / kBlockSize; ++row)
+        {
+            for (int column = rect.left() / kBlockSize;
+                 column <= (rect.right() - 1) / kBlockSize; ++column)
+            {
+                changed[static_cast<size_t>(row * columns_ + column)] = true;
+            }
+        }
+    }
+
+    Rect bounds;
+    int active_count = 0;
+
+    for (int row = 0; row < rows_; ++row)
+    {
+        for (int column = 0; column < columns_; ++column)
+        {
+            const size_t index = static_cast<size_t>(row * columns_ + column);
+            Block& block = blocks_[index];
+
+            block.score = block.score * 7 / 8;
+
+            if (changed[index])
+            {
+                block.score += kChangeScore;
+
+                // The content is checked only for blocks that change often.
+                if (block.score >= kKeepScore)
+                    block.natural = isNaturalImage(frame, blockRect(column, row));
+            }
+
+            if (block.score >= kActiveScore && block.natural)
+            {
+                bounds.unionWith(blockRect(column, row));
+                ++active_count;
+            }
+        }
+    }
+
+    if (!current_rect_.isEmpty() && (bounds.isEmpty() || current_rect_.containsRect(bounds)))
+    {
+        int kept_count = 0;
+        int total_count = 0;
+
+        for (int row = current_rect_.top() / kBlockSize;
+             row <= (current_rect_.bottom() - 1) / kBlockSize; ++row)
+        {
+            for (int column = current_rect_.left() / kBlockSize;
+                 column <= (current_rect_.right() - 1) / kBlockSize; ++column)
+            {
+                const Block& block = blocks_[static_cast<size_t>(row * columns_ + column)];
+                if (block.score >= kKeepScore && block.natural)
+                    ++kept_count;
+                ++total_count;
+            }
+        }
+
+        if (kept_count * 2 >= total_count)
+            return current_rect_;
+    }
+
+    const int bounds_count = ((bounds.width() + kBlockSize - 1) / kBlockSize) *
+                             ((bounds.height() + kBlockSize - 1) / kBlockSize);
+
+    // Scattered active blocks (for example, several small animations) are not an area.
+    if (active_count < kMinActiveBlocks || active_count * 2 < bounds_count)
+    {
+        if (!current_rect_.isEmpty())
+            LOG(LS_INFO) << "Video region finished";
+
+        current_rect_ = Rect();
+        return current_rect_;
+    }
+
+    if (!current_rect_.equals(bounds))
+    {
+        LOG(LS_INFO) << "Video region: " << bounds.x() << "," << bounds.y() << " "
+                     << bounds.width() << "x" << bounds.height();
+    }
+
+    current_rect_ = bounds;
+    return current_rect_;
+}
+
+//--------------------------------------------------------------------------------------------------
+void VideoRegionDetector::reset()
+{
+    size_ = Size();
+    columns_ = 0;
+    rows_ = 0;
+    blocks_.clear();
+    current_rect_ = Rect();
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+bool VideoRegionDetector::isNaturalImage(const Frame& frame, const Rect& rect)
+{
+    std::array<uint32_t, kSamplesPerSide * kSamplesPerSide> colors;
+    size_t count = 0;
+
+    for (int i = 0; i < kSamplesPerSide; ++i)
+    {
+        const int y = rect.top() + i * rect.height() / kSamplesPerSide;
+
+        for (int j = 0; j < kSamplesPerSide; ++j)
+        {
+            const int x = rect.left() + j * rect.width() / kSamplesPerSide;
+
+            uint32_t color;
+            memcpy(&color, frame.frameDataAtPos(x, y), sizeof(color));
+            colors[count++] = color & 0x00FFFFFF;
+        }
+    }
+
+    std::sort(colors.begin(), colors.end());
+
+    const size_t unique_count = static_cast<size_t>(
+        std::unique(colors.begin(), colors.end()) - colors.begin());
+
+    return unique_count >= kMinNaturalColors;
+}
+
+//--------------------------------------------------------------------------------------------------
+Rect VideoRegionDetector::blockRect(int column, int row) const
+{
+    Rect rect = Rect::makeXYWH(column * kBlockSize, row * kBlockSize, kBlockSize, kBlockSize);
+    rect.intersectWith(Rect::makeSize(size_));
+    return rect;
+}
+
+} // namespace base
@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_DESKTOP_VIDEO_REGION_DETECTOR_H
+#define BASE_DESKTOP_VIDEO_REGION_DETECTOR_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+
+#include <vector>
+
+namespace base {
+
+class Frame;
+
+// Finds the area of the screen that changes in most frames and contains a natural image (for
+// example, a playing video). Such an area is better encoded with a lossy video codec, while text
+// and other synthetic content stays lossless. The screen is divided into blocks, and each block
+// keeps a score that grows when the block is changed and decays otherwise.
+class VideoRegionDetector
+{
+public:
+    // Size of the side of a block in pixels. The detected area is aligned to blocks.
+    static constexpr int kBlockSize = 64;
+
+    VideoRegionDetector();
+    ~VideoRegionDetector();
+
+    // Updates the scores with |changed_region| of |frame| (32 bits per pixel) and returns the
+    // detected area. Returns an empty rectangle if there is no such area. The area is kept while it
+    // is still active, so it does not change with every frame.
+    Rect detect(const Frame& frame, const Region& changed_region);
+
+    void reset();
+
+private:
+    struct Block
+    {
+        int score = 0;
+        bool natural = false;
+    };
+
+    static bool isNaturalImage(const Frame& frame, const Rect& rect);
+    Rect blockRect(int column, int row) const;
+
+    Size size_;
+    int columns_ = 0;
+    int rows_ = 0;
+    std::vector<Block> blocks_;
+    Rect current_rect_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoRegionDetector);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_VIDEO_REGION_DETECTOR_H
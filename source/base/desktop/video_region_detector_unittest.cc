@@ -0,0 +1,142 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/video_region_detector.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+
+namespace base {
+
+namespace {
+
+const Size kScreenSize(640, 480);
+const Rect kVideoRect = Rect::makeXYWH(128, 64, 256, 192);
+
+void fillNoise(Frame* frame, const Rect& rect, std::mt19937& random)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+        for (int x = 0; x < rect.width() * 4; ++x)
+            row[x] = static_cast<uint8_t>(random());
+    }
+}
+
+void fillText(Frame* frame, const Rect& rect, int frame_number)
+{
+    // Two colors in a pattern that is different for every frame.
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            const uint8_t value = ((x + y + frame_number) % 3 == 0) ? 0x00 : 0xFF;
+            memset(row + x * 4, value, 4);
+        }
+    }
+}
+
+} // namespace
+
+TEST(VideoRegionDetectorTest, Video)
+{
+    std::mt19937 random(1);
+    std::unique_ptr<Frame> frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    VideoRegionDetector detector;
+
+    Rect result;
+    int frames = 0;
+    for (; frames < 30 && result.isEmpty(); ++frames)
+    {
+        fillNoise(frame.get(), kVideoRect, random);
+        result = detector.detect(*frame, Region(kVideoRect));
+    }
+
+    // The area is detected after a few frames, not on the first change.
+    EXPECT_GT(frames, 1);
+    EXPECT_TRUE(result.equals(kVideoRect));
+
+    // The area does not change while the video is playing.
+    for (int i = 0; i < 30; ++i)
+    {
+        fillNoise(frame.get(), kVideoRect, random);
+        EXPECT_TRUE(detector.detect(*frame, Region(kVideoRect)).equals(kVideoRect));
+    }
+
+    // The area disappears when the video stops.
+    for (int i = 0; i < 30 && !result.isEmpty(); ++i)
+        result = detector.detect(*frame, Region());
+
+    EXPECT_TRUE(result.isEmpty());
+}
+
+TEST(VideoRegionDetectorTest, Text)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    VideoRegionDetector detector;
+
+    // Content with few colors stays lossless, even if it changes in every frame.
+    for (int i = 0; i < 30; ++i)
+    {
+        fillText(frame.get(), kVideoRect, i);
+        EXPECT_TRUE(detector.detect(*frame, Region(kVideoRect)).isEmpty());
+    }
+}
+
+TEST(VideoRegionDetectorTest, SmallArea)
+{
+    std::mt19937 random(2);
+    std::unique_ptr<Frame> frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    VideoRegionDetector detector;
+
+    // An animated icon is too small for the video codec.
+    const Rect icon_rect = Rect::makeXYWH(0, 0, VideoRegionDetector::kBlockSize,
+                                          VideoRegionDetector::kBlockSize);
+
+    for (int i = 0; i < 30; ++i)
+    {
+        fillNoise(frame.get(), icon_rect, random);
+        EXPECT_TRUE(detector.detect(*frame, Region(icon_rect)).isEmpty());
+    }
+}
+
+TEST(VideoRegionDetectorTest, ScreenSizeChanged)
+{
+    std::mt19937 random(3);
+    std::unique_ptr<Frame> frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    VideoRegionDetector detector;
+
+    for (int i = 0; i < 30; ++i)
+    {
+        fillNoise(frame.get(), kVideoRect, random);
+        detector.detect(*frame, Region(kVideoRect));
+    }
+
+    // The scores of the previous screen are not used.
+    frame = FrameSimple::create(Size(320, 240), PixelFormat::ARGB());
+    const Rect rect = Rect::makeSize(frame->size());
+    fillNoise(frame.get(), rect, random);
+    EXPECT_TRUE(detector.detect(*frame, Region(rect)).isEmpty());
+}
+
+} // namespace base
@@ -282,6 +282,9 @@ void XServerPixelBuffer::initShm(const XWindowAttributes& attributes)
     Visual* default_visual = attributes.visual;
     int default_depth = attributes.depth;
 
+    visual_ = default_visual;
+    depth_ = default_depth;
+
     int major, minor;
     Bool have_pixmaps;
 
@@ -427,6 +430,131 @@ void XServerPixelBuffer::synchronize()
     }
 }
 
+//--------------------------------------------------------------------------------------------------
+bool XServerPixelBuffer::captureRegion(const Region& region, Frame* frame)
+{
+    if (region.isEmpty())
+        return true;
+
+    if (!shm_segment_info_)
+    {
+        // Without shared memory each rectangle is requested with XGetImage.
+        for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+            if (!captureRect(it.rect(), frame))
+                return false;
+        }
+
+        return true;
+    }
+
+    XImage* image = x_shm_image_;
+
+    if (shm_pixmap_)
+    {
+        // Queue copies of all rectangles and wait for the X server only once.
+        for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+            const Rect& rect = it.rect();
+            XCopyArea(display_, window_, shm_pixmap_, shm_gc_, rect.left(), rect.top(),
+                      rect.width(), rect.height(), rect.left(), rect.top());
+        }
+
+        XSync(display_, False);
+    }
+    else
+    {
+        int64_t region_area = 0;
+        for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+            region_area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+
+        const int64_t window_area =
+            static_cast<int64_t>(window_rect_.width()) * window_rect_.height();
+
+        // If most of the window has changed, one request for the whole window is cheaper than a
+        // request for each rectangle.
+        if (region_area * 2 < window_area)
+        {
+            for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+            {
+                if (!captureShmRect(it.rect(), frame))
+                    return false;
+            }
+
+            return true;
+        }
+
+        synchronize();
+        if (!xshm_get_image_succeeded_)
+        {
+            for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+            {
+                if (!captureRect(it.rect(), frame))
+                    return false;
+            }
+
+            return true;
+        }
+    }
+
+    const bool is_rgb = isXImageRGBFormat(image);
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        uint8_t* data = reinterpret_cast<uint8_t*>(image->data) +
+            rect.top() * image->bytes_per_line + rect.left() * image->bits_per_pixel / 8;
+
+        if (is_rgb)
+            fastBlit(image, data, rect, frame);
+        else
+            slowBlit(image, data, rect, frame);
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Reads one rectangle into the beginning of the shared memory segment.
+bool XServerPixelBuffer::captureShmRect(const Rect& rect, Frame* frame)
+{
+    XImage* image = XShmCreateImage(display_, visual_, depth_, ZPixmap,
+                                    shm_segment_info_->shmaddr, shm_segment_info_,
+                                    rect.width(), rect.height());
+    if (!image)
+        return captureRect(rect, frame);
+
+    // The contents of the full window image are overwritten.
+    xshm_get_image_succeeded_ = false;
+
+    bool result;
+    {
+        XErrorTrap error_trap(display_);
+        result = XShmGetImage(display_, window_, image, rect.left(), rect.top(), AllPlanes);
+        if (error_trap.lastErrorAndDisable() != 0)
+            result = false;
+    }
+
+    if (result)
+    {
+        uint8_t* data = reinterpret_cast<uint8_t*>(image->data);
+
+        if (isXImageRGBFormat(image))
+            fastBlit(image, data, rect, frame);
+        else
+            slowBlit(image, data, rect, frame);
+    }
+
+    // The data belongs to the shared memory segment and must not be freed with the image.
+    image->data = nullptr;
+    XDestroyImage(image);
+
+    if (!result)
+        return captureRect(rect, frame);
+
+    return true;
+}
+
 //--------------------------------------------------------------------------------------------------
 bool XServerPixelBuffer::captureRect(const Rect& rect, Frame* frame)
 {
@@ -23,6 +23,7 @@
 
 #include "base/macros_magic.h"
 #include "base/desktop/geometry.h"
+#include "base/desktop/region.h"
 
 #include <memory>
 #include <vector>
@@ -70,8 +71,14 @@ public:
     // any more work. The caller must ensure that |rect| is not larger than windowSize().
     bool captureRect(const Rect& rect, Frame* frame);
 
+    // Captures only the rectangles of |region| and stores them in the |frame|. Unlike
+    // captureRect(), it does not need synchronize() to be called and reads only the requested
+    // areas from the X server unless they cover most of the window.
+    bool captureRegion(const Region& region, Frame* frame);
+
 private:
     void releaseSharedMemorySegment();
+    bool captureShmRect(const Rect& rect, Frame* frame);
 
     void initShm(const XWindowAttributes& attributes);
     bool initPixmaps(int depth);
@@ -82,6 +89,8 @@ private:
     XImage* x_image_ = nullptr;
     XShmSegmentInfo* shm_segment_info_ = nullptr;
     XImage* x_shm_image_ = nullptr;
+    Visual* visual_ = nullptr;
+    int depth_ = 0;
     Pixmap shm_pixmap_ = 0;
     GC shm_gc_ = nullptr;
     bool xshm_get_image_succeeded_ = false;
@@ -40,6 +40,14 @@ namespace base {
 namespace {
 
 const uint32_t kMaxMessageSize = 16 * 1024 * 1024; // 16MB
+const size_t kReadAheadBufferSize = 64 * 1024; // 64kB
+
+// Maximum number of messages that can be sent with a single write operation.
+const size_t kMaxWriteBatchCount = 32;
+
+// If the total size of the messages in a write operation reaches this value, then no more messages
+// are added to it.
+const size_t kMaxWriteBatchBytes = 256 * 1024; // 256kB
 
 #if defined(OS_POSIX)
 const char16_t kLocalSocketPrefix[] = u"/tmp/aspia_";
@@ -118,9 +126,8 @@ public:
 
     void dettach();
 
-    void onWriteSize(const std::error_code& error_code, size_t bytes_transferred);
-    void onWriteData(const std::error_code& error_code, size_t bytes_transferred);
-    void onReadSize(const std::error_code& error_code, size_t bytes_transferred);
+    void onWrite(const std::error_code& error_code, size_t bytes_transferred);
+    void onReadSome(const std::error_code& error_code, size_t bytes_transferred);
     void onReadData(const std::error_code& error_code, size_t bytes_transferred);
 
 private:
@@ -145,24 +152,17 @@ void IpcChannel::Handler::dettach()
 }
 
 //--------------------------------------------------------------------------------------------------
-void IpcChannel::Handler::onWriteSize(const std::error_code& error_code, size_t bytes_transferred)
-{
-    if (channel_)
-        channel_->onWriteSize(error_code, bytes_transferred);
-}
-
-//--------------------------------------------------------------------------------------------------
-void IpcChannel::Handler::onWriteData(const std::error_code& error_code, size_t bytes_transferred)
+void IpcChannel::Handler::onWrite(const std::error_code& error_code, size_t bytes_transferred)
 {
     if (channel_)
-        channel_->onWriteData(error_code, bytes_transferred);
+        channel_->onWrite(error_code, bytes_transferred);
 }
 
 //--------------------------------------------------------------------------------------------------
-void IpcChannel::Handler::onReadSize(const std::error_code& error_code, size_t bytes_transferred)
+void IpcChannel::Handler::onReadSome(const std::error_code& error_code, size_t bytes_transferred)
 {
     if (channel_)
-        channel_->onReadSize(error_code, bytes_transferred);
+        channel_->onReadSome(error_code, bytes_transferred);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -354,12 +354,23 @@ void IpcChannel::resume()
     LOG(LS_INFO) << "resume channel (channel_name=" << channel_name_ << ")";
     is_paused_ = false;
 
+    // The channel was paused and resumed by the listener while it handled a message. The read
+    // loop that delivered the message continues by itself.
+    if (is_processing_)
+        return;
+
     // If we have a message that was received before the pause command.
     if (read_size_)
         onMessageReceived();
 
     DCHECK_EQ(read_size_, 0);
-    doReadSize();
+
+    // The read operation started before the pause will continue by itself.
+    if (is_reading_)
+        return;
+
+    // Messages that were read before the pause command are processed first.
+    processReadBuffer();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -370,10 +381,10 @@ void IpcChannel::send(ByteArray&& buffer)
     const bool schedule_write = write_queue_.empty();
 
     // Add the buffer to the queue for sending.
-    write_queue_.emplace(std::move(buffer));
+    write_queue_.emplace_back(std::move(buffer));
 
     if (schedule_write)
-        doWriteSize();
+        doWrite();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -445,54 +456,57 @@ void IpcChannel::onErrorOccurred(const Location& location, const std::error_code
 }
 
 //--------------------------------------------------------------------------------------------------
-void IpcChannel::doWriteSize()
+void IpcChannel::doWrite()
 {
-    write_size_ = static_cast<uint32_t>(write_queue_.front().size());
+    DCHECK(!write_queue_.empty());
+    DCHECK_EQ(write_batch_size_, 0u);
 
-    if (!write_size_ || write_size_ > kMaxMessageSize)
-    {
-        onErrorOccurred(FROM_HERE, asio::error::message_size);
-        return;
-    }
+    write_sizes_.clear();
+    write_buffers_.clear();
 
-    asio::async_write(stream_,
-                      asio::buffer(&write_size_, sizeof(write_size_)),
-                      std::bind(&Handler::onWriteSize,
-                                handler_,
-                                std::placeholders::_1,
-                                std::placeholders::_2));
-}
+    size_t batch_bytes = 0;
 
-//--------------------------------------------------------------------------------------------------
-void IpcChannel::onWriteSize(const std::error_code& error_code, size_t bytes_transferred)
-{
-    if (error_code)
+    // Take several messages from the front of the queue. Each message and its size are sent with
+    // a single gathered write.
+    while (write_sizes_.size() < write_queue_.size() &&
+           write_sizes_.size() < kMaxWriteBatchCount &&
+           batch_bytes < kMaxWriteBatchBytes)
     {
-        onErrorOccurred(FROM_HERE, error_code);
-        return;
+        const ByteArray& buffer = write_queue_[write_sizes_.size()];
+
+        if (buffer.empty() || buffer.size() > kMaxMessageSize)
+        {
+            onErrorOccurred(FROM_HERE, asio::error::message_size);
+            return;
+        }
+
+        write_sizes_.emplace_back(static_cast<uint32_t>(buffer.size()));
+        batch_bytes += buffer.size();
     }
 
-    DCHECK_EQ(bytes_transferred, sizeof(write_size_));
-    doWriteData();
-}
+    write_batch_size_ = write_sizes_.size();
 
-//--------------------------------------------------------------------------------------------------
-void IpcChannel::doWriteData()
-{
-    DCHECK(!write_queue_.empty());
+    // |write_sizes_| is not changed until the end of the write operation, so the pointers to its
+    // elements remain valid.
+    for (size_t i = 0; i < write_batch_size_; ++i)
+    {
+        const ByteArray& buffer = write_queue_[i];
 
-    const ByteArray& buffer = write_queue_.front();
+        write_buffers_.emplace_back(&write_sizes_[i], sizeof(uint32_t));
+        write_buffers_.emplace_back(buffer.data(), buffer.size());
+    }
 
-    // Send the buffer to the recipient.
-    asio::async_write(stream_, asio::buffer(buffer.data(), buffer.size()),
-                      std::bind(&Handler::onWriteData,
+    // Send the buffers to the recipient.
+    asio::async_write(stream_,
+                      write_buffers_,
+                      std::bind(&Handler::onWrite,
                                 handler_,
                                 std::placeholders::_1,
                                 std::placeholders::_2));
 }
 
 //--------------------------------------------------------------------------------------------------
-void IpcChannel::onWriteData(const std::error_code& error_code, size_t bytes_transferred)
+void IpcChannel::onWrite(const std::error_code& error_code, size_t bytes_transferred)
 {
     if (error_code)
     {
@@ -500,67 +514,111 @@ void IpcChannel::onWriteData(const std::error_code& error_code, size_t bytes_tra
         return;
     }
 
-    DCHECK_EQ(bytes_transferred, write_size_);
-    DCHECK(!write_queue_.empty());
+    DCHECK_NE(write_batch_size_, 0u);
+    DCHECK_GE(write_queue_.size(), write_batch_size_);
 
-    ByteArray buffer = std::move(write_queue_.front());
+    std::vector<ByteArray> written_buffers;
+    written_buffers.reserve(write_batch_size_);
 
-    // Delete the sent message from the queue.
-    write_queue_.pop();
+    // Delete the sent messages from the queue.
+    for (size_t i = 0; i < write_batch_size_; ++i)
+    {
+        written_buffers.emplace_back(std::move(write_queue_.front()));
+        write_queue_.pop_front();
+    }
 
-    onMessageWritten(std::move(buffer));
+    write_batch_size_ = 0;
 
-    // If the queue is not empty, then we send the following message.
-    if (write_queue_.empty() && !proxy_->reloadWriteQueue(&write_queue_))
-        return;
+    // If the queue is not empty, then we send the following messages.
+    const bool schedule_write = !write_queue_.empty() || proxy_->reloadWriteQueue(&write_queue_);
 
-    doWriteSize();
+    for (auto& buffer : written_buffers)
+        onMessageWritten(std::move(buffer));
+
+    if (schedule_write)
+        doWrite();
 }
 
 //--------------------------------------------------------------------------------------------------
-void IpcChannel::doReadSize()
+void IpcChannel::doReadSome()
 {
-    asio::async_read(stream_,
-                     asio::buffer(&read_size_, sizeof(read_size_)),
-                     std::bind(&Handler::onReadSize,
-                               handler_,
-                               std::placeholders::_1,
-                               std::placeholders::_2));
+    DCHECK(!is_reading_);
+
+    if (read_ahead_buffer_.empty())
+        read_ahead_buffer_.resize(kReadAheadBufferSize);
+
+    if (read_ahead_begin_ == read_ahead_end_)
+    {
+        // All data has been processed. Start filling the buffer from the beginning.
+        read_ahead_begin_ = 0;
+        read_ahead_end_ = 0;
+    }
+    else if (read_ahead_end_ == read_ahead_buffer_.size())
+    {
+        // There is no free space at the end of the buffer. Move the beginning of an incomplete
+        // message to the beginning of the buffer.
+        const size_t size = read_ahead_end_ - read_ahead_begin_;
+
+        memmove(read_ahead_buffer_.data(), read_ahead_buffer_.data() + read_ahead_begin_, size);
+
+        read_ahead_begin_ = 0;
+        read_ahead_end_ = size;
+    }
+
+    is_reading_ = true;
+    stream_.async_read_some(asio::buffer(read_ahead_buffer_.data() + read_ahead_end_,
+                                         read_ahead_buffer_.size() - read_ahead_end_),
+                            std::bind(&Handler::onReadSome,
+                                      handler_,
+                                      std::placeholders::_1,
+                                      std::placeholders::_2));
 }
 
 //--------------------------------------------------------------------------------------------------
-void IpcChannel::onReadSize(const std::error_code& error_code, size_t bytes_transferred)
+void IpcChannel::onReadSome(const std::error_code& error_code, size_t bytes_transferred)
 {
+    is_reading_ = false;
+
     if (error_code)
     {
         onErrorOccurred(FROM_HERE, error_code);
         return;
     }
 
-    DCHECK_EQ(bytes_transferred, sizeof(read_size_));
+    DCHECK_LE(read_ahead_end_ + bytes_transferred, read_ahead_buffer_.size());
+    read_ahead_end_ += bytes_transferred;
 
-    if (!read_size_ || read_size_ > kMaxMessageSize)
-    {
-        onErrorOccurred(FROM_HERE, asio::error::message_size);
-        return;
-    }
-
-    doReadData();
+    processReadBuffer();
 }
 
 //--------------------------------------------------------------------------------------------------
-void IpcChannel::doReadData()
+void IpcChannel::doReadData(uint32_t message_size)
 {
-    if (read_buffer_.capacity() < read_size_)
+    DCHECK(!is_reading_);
+
+    if (read_buffer_.capacity() < message_size)
     {
         read_buffer_.clear();
-        read_buffer_.reserve(read_size_);
+        read_buffer_.reserve(message_size);
     }
 
-    read_buffer_.resize(read_size_);
+    read_buffer_.resize(message_size);
+
+    // Copy the beginning of the message that is already in the read-ahead buffer.
+    const size_t received = read_ahead_end_ - read_ahead_begin_ - sizeof(uint32_t);
+    DCHECK_LT(received, message_size);
+
+    memcpy(read_buffer_.data(),
+           read_ahead_buffer_.data() + read_ahead_begin_ + sizeof(uint32_t),
+           received);
 
+    read_ahead_begin_ = 0;
+    read_ahead_end_ = 0;
+
+    // The rest of the message is read directly into the message buffer.
+    is_reading_ = true;
     asio::async_read(stream_,
-                     asio::buffer(read_buffer_.data(), read_buffer_.size()),
+                     asio::buffer(read_buffer_.data() + received, read_buffer_.size() - received),
                      std::bind(&Handler::onReadData,
                                handler_,
                                std::placeholders::_1,
@@ -570,24 +628,76 @@ void IpcChannel::doReadData()
 //--------------------------------------------------------------------------------------------------
 void IpcChannel::onReadData(const std::error_code& error_code, size_t bytes_transferred)
 {
+    is_reading_ = false;
+
     if (error_code)
     {
         onErrorOccurred(FROM_HERE, error_code);
         return;
     }
 
-    DCHECK_EQ(bytes_transferred, read_size_);
+    DCHECK_EQ(read_size_, 0);
+    read_size_ = static_cast<uint32_t>(read_buffer_.size());
 
     if (is_paused_)
         return;
 
     onMessageReceived();
+    processReadBuffer();
+}
 
-    if (is_paused_)
+//--------------------------------------------------------------------------------------------------
+void IpcChannel::processReadBuffer()
+{
+    while (is_connected_ && !is_paused_)
+    {
+        const size_t available = read_ahead_end_ - read_ahead_begin_;
+        if (available < sizeof(uint32_t))
+            break;
+
+        const uint8_t* data = read_ahead_buffer_.data() + read_ahead_begin_;
+
+        uint32_t message_size;
+        memcpy(&message_size, data, sizeof(message_size));
+
+        if (!message_size || message_size > kMaxMessageSize)
+        {
+            onErrorOccurred(FROM_HERE, asio::error::message_size);
+            return;
+        }
+
+        if (available - sizeof(uint32_t) < message_size)
+        {
+            // The message does not fit into the read-ahead buffer. We read it directly.
+            if (sizeof(uint32_t) + message_size > read_ahead_buffer_.size())
+            {
+                doReadData(message_size);
+                return;
+            }
+
+            // The message is incomplete. We need to read more data.
+            break;
+        }
+
+        if (read_buffer_.capacity() < message_size)
+        {
+            read_buffer_.clear();
+            read_buffer_.reserve(message_size);
+        }
+
+        read_buffer_.resize(message_size);
+        memcpy(read_buffer_.data(), data + sizeof(uint32_t), message_size);
+
+        read_ahead_begin_ += sizeof(uint32_t) + message_size;
+        read_size_ = message_size;
+
+        onMessageReceived();
+    }
+
+    if (!is_connected_ || is_paused_)
         return;
 
-    DCHECK_EQ(read_size_, 0);
-    doReadSize();
+    doReadSome();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -595,7 +705,9 @@ void IpcChannel::onMessageReceived()
 {
     if (listener_)
     {
+        is_processing_ = true;
         listener_->onIpcMessageReceived(read_buffer_);
+        is_processing_ = false;
     }
     else
     {
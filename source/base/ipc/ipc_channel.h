@@ -31,8 +31,9 @@
 #include <asio/local/stream_protocol.hpp>
 #endif
 
+#include <deque>
 #include <filesystem>
-#include <queue>
+#include <vector>
 
 namespace base {
 
@@ -93,14 +94,13 @@ private:
     static std::u16string channelName(std::u16string_view channel_id);
 
     void onErrorOccurred(const Location& location, const std::error_code& error_code);
-    void doWriteSize();
-    void onWriteSize(const std::error_code& error_code, size_t bytes_transferred);
-    void doWriteData();
-    void onWriteData(const std::error_code& error_code, size_t bytes_transferred);
-    void doReadSize();
-    void onReadSize(const std::error_code& error_code, size_t bytes_transferred);
-    void doReadData();
+    void doWrite();
+    void onWrite(const std::error_code& error_code, size_t bytes_transferred);
+    void doReadSome();
+    void onReadSome(const std::error_code& error_code, size_t bytes_transferred);
+    void doReadData(uint32_t message_size);
     void onReadData(const std::error_code& error_code, size_t bytes_transferred);
+    void processReadBuffer();
 
     void onMessageReceived();
     void onMessageWritten(ByteArray&& buffer);
@@ -113,9 +113,23 @@ private:
 
     bool is_connected_ = false;
     bool is_paused_ = true;
-
-    std::queue<ByteArray> write_queue_;
-    uint32_t write_size_ = 0;
+    bool is_processing_ = false;
+
+    // Several messages from the front of the queue are sent with a single write operation.
+    // Each message is preceded by its size. |write_batch_size_| is the number of messages in the
+    // current write operation.
+    std::deque<ByteArray> write_queue_;
+    std::vector<uint32_t> write_sizes_;
+    std::vector<asio::const_buffer> write_buffers_;
+    size_t write_batch_size_ = 0;
+
+    // Data from the stream is read in large blocks. A single read can contain several small
+    // messages. Messages that do not fit into the read-ahead buffer are read directly into
+    // |read_buffer_|.
+    ByteArray read_ahead_buffer_;
+    size_t read_ahead_begin_ = 0;
+    size_t read_ahead_end_ = 0;
+    bool is_reading_ = false;
 
     uint32_t read_size_ = 0;
     ByteArray read_buffer_;
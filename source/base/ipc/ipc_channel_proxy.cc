@@ -47,7 +47,7 @@ void IpcChannelProxy::send(ByteArray&& buffer)
         std::scoped_lock lock(incoming_queue_lock_);
 
         schedule_write = incoming_queue_.empty();
-        incoming_queue_.emplace(std::move(buffer));
+        incoming_queue_.emplace_back(std::move(buffer));
     }
 
     if (!schedule_write)
@@ -72,11 +72,11 @@ void IpcChannelProxy::scheduleWrite()
     if (!reloadWriteQueue(&channel_->write_queue_))
         return;
 
-    channel_->doWriteSize();
+    channel_->doWrite();
 }
 
 //--------------------------------------------------------------------------------------------------
-bool IpcChannelProxy::reloadWriteQueue(std::queue<ByteArray>* work_queue)
+bool IpcChannelProxy::reloadWriteQueue(std::deque<ByteArray>* work_queue)
 {
     if (!work_queue->empty())
         return false;
@@ -40,12 +40,12 @@ private:
     void willDestroyCurrentChannel();
 
     void scheduleWrite();
-    bool reloadWriteQueue(std::queue<ByteArray>* work_queue);
+    bool reloadWriteQueue(std::deque<ByteArray>* work_queue);
 
     std::shared_ptr<TaskRunner> task_runner_;
     IpcChannel* channel_;
 
-    std::queue<ByteArray> incoming_queue_;
+    std::deque<ByteArray> incoming_queue_;
     std::mutex incoming_queue_lock_;
 
     DISALLOW_COPY_AND_ASSIGN(IpcChannelProxy);
@@ -19,6 +19,7 @@
 #include "base/ipc/shared_memory.h"
 
 #include "base/ipc/shared_memory_factory_proxy.h"
+#include "base/memory/memory_policy.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
 #include "base/strings/unicode.h"
@@ -313,6 +314,8 @@ std::unique_ptr<SharedMemory> SharedMemory::create(
         return nullptr;
     }
 
+    // The memory is not touched yet, so the policy applies to all its pages.
+    MemoryPolicy::adviseLargeBuffer(memory, size);
     memset(memory, 0, size);
 
     return std::unique_ptr<SharedMemory>(
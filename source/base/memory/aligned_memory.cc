@@ -19,11 +19,14 @@
 #include "base/memory/aligned_memory.h"
 
 #include "base/logging.h"
+#include "base/memory/memory_policy.h"
 
 #if defined(OS_ANDROID)
 #include <malloc.h>
 #endif
 
+#include <algorithm>
+
 namespace base {
 
 //--------------------------------------------------------------------------------------------------
@@ -35,6 +38,22 @@ void* alignedAlloc(size_t size, size_t alignment)
 
     void* ptr = nullptr;
 
+    // Explicit huge pages are always aligned to the huge page size.
+    if (alignment <= MemoryPolicy::kHugePageSize)
+    {
+        ptr = MemoryPolicy::allocHugePages(size);
+        if (ptr)
+            return ptr;
+    }
+
+    // Large buffers are aligned to the huge page size, so that transparent huge pages can back
+    // them completely.
+    if (MemoryPolicy::isLargeBuffer(size) &&
+        MemoryPolicy::hugePages() != MemoryPolicy::HugePages::DISABLED)
+    {
+        alignment = std::max(alignment, MemoryPolicy::kHugePageSize);
+    }
+
 #if defined(OS_WIN)
     ptr = _aligned_malloc(size, alignment);
 #elif defined(OS_ANDROID)
@@ -48,7 +67,22 @@ void* alignedAlloc(size_t size, size_t alignment)
 
     // Sanity check alignment just to be safe.
     DCHECK_EQ((reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)), 0U);
+
+    MemoryPolicy::adviseLargeBuffer(ptr, size);
     return ptr;
 }
 
+//--------------------------------------------------------------------------------------------------
+void alignedFree(void* ptr)
+{
+    if (MemoryPolicy::freeHugePages(ptr))
+        return;
+
+#if defined(OS_WIN)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
 } // namespace base
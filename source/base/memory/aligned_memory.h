@@ -60,16 +60,9 @@
 
 namespace base {
 
+// Large buffers are allocated according to MemoryPolicy (huge pages, NUMA node).
 void* alignedAlloc(size_t size, size_t alignment);
-
-inline void alignedFree(void* ptr)
-{
-#if defined(OS_WIN)
-    _aligned_free(ptr);
-#else
-    free(ptr);
-#endif
-}
+void alignedFree(void* ptr);
 
 // Deleter for use with unique_ptr. E.g., use as std::unique_ptr<Foo, AlignedFreeDeleter> foo;
 struct AlignedFreeDeleter
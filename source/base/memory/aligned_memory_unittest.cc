@@ -20,6 +20,8 @@
 
 #include <gtest/gtest.h>
 
+#include <cstring>
+
 namespace base {
 
 #define EXPECT_ALIGNED(ptr, align) \
@@ -48,6 +50,21 @@ TEST(aligned_memory_test, dynamic_allocation)
     alignedFree(p);
 }
 
+TEST(aligned_memory_test, large_allocation)
+{
+    const size_t kSize = 8 * 1024 * 1024 + 123;
+
+    uint8_t* p = static_cast<uint8_t*>(alignedAlloc(kSize, 32));
+    EXPECT_TRUE(p);
+    EXPECT_ALIGNED(p, 32);
+
+    // The whole buffer must be writable.
+    memset(p, 0xAA, kSize);
+    EXPECT_EQ(p[0], 0xAA);
+    EXPECT_EQ(p[kSize - 1], 0xAA);
+    alignedFree(p);
+}
+
 TEST(aligned_memory_test, scoped_dynamic_allocation)
 {
     std::unique_ptr<float, AlignedFreeDeleter> p(static_cast<float*>(alignedAlloc(8, 8)));
@@ -0,0 +1,226 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/memory_policy.h"
+
+#include "base/environment.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "build/build_config.h"
+
+#if defined(OS_LINUX)
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // defined(OS_LINUX)
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace base {
+
+namespace {
+
+//--------------------------------------------------------------------------------------------------
+int intFromEnvironment(std::string_view variable_name, int default_value, int max_value)
+{
+    std::string value_string;
+    if (!Environment::get(variable_name, &value_string))
+        return default_value;
+
+    int value = 0;
+    if (!stringToInt(value_string, &value) || value < 0 || value > max_value)
+    {
+        LOG(LS_INFO) << "Environment variable " << variable_name
+                     << " contains an incorrect value: " << value_string;
+        return default_value;
+    }
+
+    LOG(LS_INFO) << "Environment variable " << variable_name << " specified: " << value;
+    return value;
+}
+
+class Policy
+{
+public:
+    Policy()
+    {
+#if defined(OS_LINUX)
+        huge_pages = static_cast<MemoryPolicy::HugePages>(intFromEnvironment(
+            "ASPIA_HUGE_PAGES", static_cast<int>(MemoryPolicy::HugePages::TRANSPARENT_PAGES),
+            static_cast<int>(MemoryPolicy::HugePages::EXPLICIT_PAGES)));
+        numa_local = intFromEnvironment("ASPIA_NUMA_LOCAL", 1, 1) != 0;
+#endif // defined(OS_LINUX)
+    }
+
+    MemoryPolicy::HugePages huge_pages = MemoryPolicy::HugePages::DISABLED;
+    bool numa_local = false;
+
+    // Cleared after the first failure, if the system does not support the feature.
+    std::atomic_bool explicit_pages_available { true };
+    std::atomic_bool numa_available { true };
+
+    // Buffers allocated from explicit huge pages and their sizes.
+    std::mutex explicit_pages_lock;
+    std::unordered_map<void*, size_t> explicit_pages;
+    std::atomic_int explicit_pages_count { 0 };
+};
+
+//--------------------------------------------------------------------------------------------------
+Policy& policy()
+{
+    static Policy policy;
+    return policy;
+}
+
+#if defined(OS_LINUX)
+
+//--------------------------------------------------------------------------------------------------
+void bindToCurrentNode(void* ptr, size_t size)
+{
+    Policy& current = policy();
+    if (!current.numa_local || !current.numa_available)
+        return;
+
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= sizeof(unsigned long) * 8)
+        return;
+
+    unsigned long node_mask = 1UL << node;
+
+    // The memory is taken from the node while it has free memory and from other nodes after that.
+    if (syscall(SYS_mbind, ptr, size, MPOL_PREFERRED, &node_mask, sizeof(node_mask) * 8, 0) != 0)
+    {
+        PLOG(LS_INFO) << "NUMA binding is not available";
+        current.numa_available = false;
+    }
+}
+
+#endif // defined(OS_LINUX)
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// static
+MemoryPolicy::HugePages MemoryPolicy::hugePages()
+{
+    return policy().huge_pages;
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+bool MemoryPolicy::isNumaLocal()
+{
+    return policy().numa_local;
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+void* MemoryPolicy::allocHugePages(size_t size)
+{
+#if defined(OS_LINUX)
+    Policy& current = policy();
+
+    if (!isLargeBuffer(size) || current.huge_pages != HugePages::EXPLICIT_PAGES ||
+        !current.explicit_pages_available)
+    {
+        return nullptr;
+    }
+
+    const size_t mapped_size = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+
+    void* ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr == MAP_FAILED)
+    {
+        PLOG(LS_INFO) << "Explicit huge pages are not available, transparent huge pages are used";
+        current.explicit_pages_available = false;
+        return nullptr;
+    }
+
+    bindToCurrentNode(ptr, mapped_size);
+
+    std::scoped_lock lock(current.explicit_pages_lock);
+    current.explicit_pages.emplace(ptr, mapped_size);
+    ++current.explicit_pages_count;
+    return ptr;
+#else
+    return nullptr;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+bool MemoryPolicy::freeHugePages(void* ptr)
+{
+#if defined(OS_LINUX)
+    Policy& current = policy();
+
+    // Most buffers are allocated as usual. They do not need the lock.
+    if (!ptr || current.explicit_pages_count == 0)
+        return false;
+
+    std::scoped_lock lock(current.explicit_pages_lock);
+
+    auto result = current.explicit_pages.find(ptr);
+    if (result == current.explicit_pages.end())
+        return false;
+
+    munmap(result->first, result->second);
+    current.explicit_pages.erase(result);
+    --current.explicit_pages_count;
+    return true;
+#else
+    return false;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+void MemoryPolicy::adviseLargeBuffer(void* ptr, size_t size)
+{
+#if defined(OS_LINUX)
+    if (!ptr || !isLargeBuffer(size))
+        return;
+
+    // madvise and mbind work with whole pages.
+    const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = (reinterpret_cast<uintptr_t>(ptr) + page_size - 1) & ~(page_size - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + size) & ~(page_size - 1);
+
+    if (begin >= end)
+        return;
+
+    void* range = reinterpret_cast<void*>(begin);
+    const size_t range_size = end - begin;
+
+    if (policy().huge_pages != HugePages::DISABLED)
+    {
+        // Fails if transparent huge pages are not supported. The buffer then uses ordinary pages.
+        madvise(range, range_size, MADV_HUGEPAGE);
+    }
+
+    bindToCurrentNode(range, range_size);
+#endif // defined(OS_LINUX)
+}
+
+} // namespace base
@@ -0,0 +1,68 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_MEMORY_MEMORY_POLICY_H
+#define BASE_MEMORY_MEMORY_POLICY_H
+
+#include "base/macros_magic.h"
+
+#include <cstddef>
+
+namespace base {
+
+// Allocation policy for large buffers such as screen frames (from several to hundreds of
+// megabytes). The differ, the pixel translators and the codecs scan whole frames, so with ordinary
+// pages they cause a lot of TLB misses. On Linux such buffers are backed by huge pages and placed
+// on the NUMA node of the thread that allocates them.
+//
+// The policy is read once from the environment variables:
+//   ASPIA_HUGE_PAGES - 0: disabled, 1: transparent huge pages (default), 2: explicit huge pages
+//                      from the hugetlbfs pool (transparent huge pages if the pool is empty).
+//   ASPIA_NUMA_LOCAL - 0: disabled, 1: allocate on the node of the current thread (default).
+// If the system does not support a feature, it is silently not used. On other platforms the
+// policy does nothing.
+class MemoryPolicy
+{
+public:
+    enum class HugePages { DISABLED = 0, TRANSPARENT_PAGES = 1, EXPLICIT_PAGES = 2 };
+
+    // Buffers smaller than the size of a huge page are allocated as usual.
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+    static HugePages hugePages();
+    static bool isNumaLocal();
+    static bool isLargeBuffer(size_t size) { return size >= kHugePageSize; }
+
+    // Allocates a large buffer from explicit huge pages. Returns nullptr if the policy does not
+    // allow it or there are no free huge pages. The memory is aligned to kHugePageSize.
+    static void* allocHugePages(size_t size);
+
+    // Releases the memory if it was allocated by allocHugePages(). Otherwise returns false.
+    static bool freeHugePages(void* ptr);
+
+    // Applies the policy to a large buffer that is mapped, but not touched yet: asks the kernel
+    // for transparent huge pages and binds the memory to the NUMA node of the current thread.
+    static void adviseLargeBuffer(void* ptr, size_t size);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(MemoryPolicy);
+};
+
+} // namespace base
+
+#endif // BASE_MEMORY_MEMORY_POLICY_H
@@ -32,6 +32,8 @@
 #include <asio/read.hpp>
 #include <asio/write.hpp>
 
+#include <array>
+
 namespace base {
 
 namespace {
@@ -50,6 +52,13 @@ std::string endpointsToString(const asio::ip::tcp::resolver::results_type& endpo
     return str;
 }
 
+// Maximum number of messages that can be sent with a single write operation.
+const size_t kMaxWriteBatchCount = 32;
+
+// If the total size of the messages in a write operation reaches this value, then no more messages
+// are added to it.
+const size_t kMaxWriteBatchBytes = 256 * 1024; // 256 kB
+
 } // namespace
 
 class TcpChannel::Handler
@@ -575,45 +584,31 @@ void TcpChannel::onMessageWritten(uint8_t channel_id, ByteArray&& buffer)
 //--------------------------------------------------------------------------------------------------
 void TcpChannel::onMessageReceived()
 {
-    uint8_t* read_data = read_buffer_.data();
-    size_t read_size = read_buffer_.size();
+    const uint8_t* prefix = read_prefix_.data();
 
     UserDataHeader header;
 
     if (is_channel_id_supported_)
     {
-        if (read_size < sizeof(header))
-        {
-            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
-            return;
-        }
-
-        memcpy(&header, read_data, sizeof(header));
-
-        read_data += sizeof(header);
-        read_size -= sizeof(header);
+        memcpy(&header, prefix, sizeof(header));
+        prefix += sizeof(header);
     }
     else
     {
         memset(&header, 0, sizeof(header));
     }
 
-    if (!read_size)
-    {
-        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
-        return;
-    }
+    DCHECK_EQ(prefix + decryptor_->prefixSize(), read_prefix_.data() + read_prefix_.size());
 
-    resizeBuffer(&decrypt_buffer_, decryptor_->decryptedDataSize(read_size));
-
-    if (!decryptor_->decrypt(read_data, read_size, decrypt_buffer_.data()))
+    // The message is decrypted in the same buffer in which it was read.
+    if (!decryptor_->decryptInPlace(prefix, read_buffer_.data(), read_buffer_.size()))
     {
         onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
         return;
     }
 
     if (listener_)
-        listener_->onTcpMessageReceived(header.channel_id, decrypt_buffer_);
+        listener_->onTcpMessageReceived(header.channel_id, read_buffer_);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -622,7 +617,7 @@ void TcpChannel::addWriteTask(WriteTask::Type type, uint8_t channel_id, ByteArra
     const bool schedule_write = write_queue_.empty();
 
     // Add the buffer to the queue for sending.
-    write_queue_.emplace(type, channel_id, std::move(data));
+    write_queue_.emplace_back(type, channel_id, std::move(data));
 
     if (schedule_write)
         doWrite();
@@ -631,75 +626,121 @@ void TcpChannel::addWriteTask(WriteTask::Type type, uint8_t channel_id, ByteArra
 //--------------------------------------------------------------------------------------------------
 void TcpChannel::doWrite()
 {
-    const WriteTask& task = write_queue_.front();
-    const ByteArray& source_buffer = task.data();
-    const uint8_t channel_id = task.channelId();
+    DCHECK(!write_queue_.empty());
+    DCHECK_EQ(write_batch_size_, 0u);
 
-    if (source_buffer.empty())
-    {
-        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
-        return;
-    }
+    write_buffer_list_.clear();
 
-    if (task.type() == WriteTask::Type::USER_DATA)
+    size_t batch_size = 0;
+    size_t batch_bytes = 0;
+
+    // Take several messages from the front of the queue and send them with a single write
+    // operation. Small messages (cursor, audio, input, etc.) often come in bursts, and this allows
+    // to send them with one system call.
+    while (batch_size < write_queue_.size() &&
+           batch_size < kMaxWriteBatchCount &&
+           batch_bytes < kMaxWriteBatchBytes)
     {
-        // Calculate the size of the encrypted message.
-        size_t target_data_size = encryptor_->encryptedDataSize(source_buffer.size());
-        if (is_channel_id_supported_)
-            target_data_size += sizeof(UserDataHeader);
+        WriteTask& task = write_queue_[batch_size];
+        const ByteArray& source_buffer = task.data();
 
-        if (target_data_size > kMaxMessageSize)
+        if (source_buffer.empty())
         {
-            LOG(LS_ERROR) << "Too big outgoing message: " << target_data_size;
             onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
             return;
         }
 
-        asio::const_buffer variable_size = variable_size_writer_.variableSize(target_data_size);
+        if (task.type() == WriteTask::Type::USER_DATA)
+        {
+            if (write_buffers_.size() <= batch_size)
+                write_buffers_.resize(batch_size + 1);
 
-        resizeBuffer(&write_buffer_, variable_size.size() + target_data_size);
+            ByteArray* prefix_buffer = &write_buffers_[batch_size];
 
-        // Copy the size of the message to the buffer.
-        memcpy(write_buffer_.data(), variable_size.data(), variable_size.size());
+            // The message is encrypted in place. Only the message prefix (size, header and data
+            // added by the encryptor) is written to a separate buffer.
+            if (!encryptUserData(&task, prefix_buffer))
+                return;
 
-        uint8_t* write_buffer = write_buffer_.data() + variable_size.size();
-        if (is_channel_id_supported_)
+            write_buffer_list_.emplace_back(prefix_buffer->data(), prefix_buffer->size());
+            write_buffer_list_.emplace_back(source_buffer.data(), source_buffer.size());
+        }
+        else
         {
-            UserDataHeader header;
-            header.channel_id = channel_id;
-            header.reserved = 0;
+            DCHECK_EQ(task.type(), WriteTask::Type::SERVICE_DATA);
 
-            // Copy the channel id to the buffer.
-            memcpy(write_buffer, &header, sizeof(header));
-            write_buffer += sizeof(header);
+            // Service data does not need encryption. The buffer stays in the queue until the write
+            // is completed, so we send it directly.
+            write_buffer_list_.emplace_back(source_buffer.data(), source_buffer.size());
         }
 
-        // Encrypt the message.
-        if (!encryptor_->encrypt(source_buffer.data(), source_buffer.size(), write_buffer))
-        {
-            onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
-            return;
-        }
+        batch_bytes += source_buffer.size();
+        ++batch_size;
     }
-    else
-    {
-        DCHECK_EQ(task.type(), WriteTask::Type::SERVICE_DATA);
 
-        resizeBuffer(&write_buffer_, source_buffer.size());
+    write_batch_size_ = batch_size;
 
-        // Service data does not need encryption. Copy the source buffer.
-        memcpy(write_buffer_.data(), source_buffer.data(), source_buffer.size());
-    }
-
-    // Send the buffer to the recipient.
+    // Send the buffers to the recipient.
     asio::async_write(socket_,
-                      asio::buffer(write_buffer_.data(), write_buffer_.size()),
+                      write_buffer_list_,
                       std::bind(&Handler::onWrite,
                                 handler_,
                                 std::placeholders::_1,
                                 std::placeholders::_2));
 }
 
+//--------------------------------------------------------------------------------------------------
+bool TcpChannel::encryptUserData(WriteTask* task, ByteArray* prefix_buffer)
+{
+    ByteArray& source_buffer = task->data();
+
+    // Calculate the size of the encrypted message.
+    const size_t encrypted_data_size = encryptor_->encryptedDataSize(source_buffer.size());
+    const size_t encryptor_prefix_size = encrypted_data_size - source_buffer.size();
+
+    size_t target_data_size = encrypted_data_size;
+    if (is_channel_id_supported_)
+        target_data_size += sizeof(UserDataHeader);
+
+    if (target_data_size > kMaxMessageSize)
+    {
+        LOG(LS_ERROR) << "Too big outgoing message: " << target_data_size;
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return false;
+    }
+
+    asio::const_buffer variable_size = variable_size_writer_.variableSize(target_data_size);
+
+    resizeBuffer(prefix_buffer,
+                 variable_size.size() + (target_data_size - source_buffer.size()));
+
+    // Copy the size of the message to the buffer.
+    memcpy(prefix_buffer->data(), variable_size.data(), variable_size.size());
+
+    uint8_t* write_buffer = prefix_buffer->data() + variable_size.size();
+    if (is_channel_id_supported_)
+    {
+        UserDataHeader header;
+        header.channel_id = task->channelId();
+        header.reserved = 0;
+
+        // Copy the channel id to the buffer.
+        memcpy(write_buffer, &header, sizeof(header));
+        write_buffer += sizeof(header);
+    }
+
+    DCHECK_EQ(write_buffer + encryptor_prefix_size, prefix_buffer->data() + prefix_buffer->size());
+
+    // Encrypt the message.
+    if (!encryptor_->encryptInPlace(source_buffer.data(), source_buffer.size(), write_buffer))
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
+        return false;
+    }
+
+    return true;
+}
+
 //--------------------------------------------------------------------------------------------------
 void TcpChannel::onWrite(const std::error_code& error_code, size_t bytes_transferred)
 {
@@ -709,24 +750,32 @@ void TcpChannel::onWrite(const std::error_code& error_code, size_t bytes_transfe
         return;
     }
 
-    DCHECK(!write_queue_.empty());
+    DCHECK_NE(write_batch_size_, 0u);
+    DCHECK_GE(write_queue_.size(), write_batch_size_);
 
     // Update TX statistics.
     addTxBytes(bytes_transferred);
 
-    const WriteTask& task = write_queue_.front();
-    WriteTask::Type task_type = task.type();
-    uint8_t channel_id = task.channelId();
-    ByteArray buffer = std::move(task.data());
+    std::vector<WriteTask> written_tasks;
+    written_tasks.reserve(write_batch_size_);
+
+    // Delete the sent messages from the queue.
+    for (size_t i = 0; i < write_batch_size_; ++i)
+    {
+        written_tasks.emplace_back(std::move(write_queue_.front()));
+        write_queue_.pop_front();
+    }
 
-    // Delete the sent message from the queue.
-    write_queue_.pop();
+    write_batch_size_ = 0;
 
-    // If the queue is not empty, then we send the following message.
+    // If the queue is not empty, then we send the following messages.
     bool schedule_write = !write_queue_.empty() || proxy_->reloadWriteQueue(&write_queue_);
 
-    if (task_type == WriteTask::Type::USER_DATA)
-        onMessageWritten(channel_id, std::move(buffer));
+    for (auto& task : written_tasks)
+    {
+        if (task.type() == WriteTask::Type::USER_DATA)
+            onMessageWritten(task.channelId(), std::move(task.data()));
+    }
 
     if (schedule_write)
         doWrite();
@@ -787,11 +836,30 @@ void TcpChannel::onReadSize(const std::error_code& error_code, size_t bytes_tran
 //--------------------------------------------------------------------------------------------------
 void TcpChannel::doReadUserData(size_t length)
 {
-    resizeBuffer(&read_buffer_, length);
+    size_t prefix_size = decryptor_->prefixSize();
+    if (is_channel_id_supported_)
+        prefix_size += sizeof(UserDataHeader);
+
+    if (length <= prefix_size)
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return;
+    }
+
+    // The message prefix (header and data added by the encryptor) is read into a separate buffer,
+    // and the encrypted data is read directly into the buffer in which it will be decrypted.
+    resizeBuffer(&read_prefix_, prefix_size);
+    resizeBuffer(&read_buffer_, length - prefix_size);
+
+    std::array<asio::mutable_buffer, 2> buffers =
+    {
+        asio::buffer(read_prefix_.data(), read_prefix_.size()),
+        asio::buffer(read_buffer_.data(), read_buffer_.size())
+    };
 
     state_ = ReadState::READ_USER_DATA;
     asio::async_read(socket_,
-                     asio::buffer(read_buffer_.data(), read_buffer_.size()),
+                     buffers,
                      std::bind(&Handler::onReadUserData,
                                handler_,
                                std::placeholders::_1,
@@ -812,7 +880,7 @@ void TcpChannel::onReadUserData(const std::error_code& error_code, size_t bytes_
     // Update RX statistics.
     addRxBytes(bytes_transferred);
 
-    DCHECK_EQ(bytes_transferred, read_buffer_.size());
+    DCHECK_EQ(bytes_transferred, read_prefix_.size() + read_buffer_.size());
 
     if (paused_)
     {
@@ -29,7 +29,8 @@
 #include <asio/ip/tcp.hpp>
 #include <asio/high_resolution_timer.hpp>
 
-#include <queue>
+#include <deque>
+#include <vector>
 
 namespace base {
 
@@ -91,7 +92,8 @@ public:
     void resume();
 
     // Sending a message. The method call is thread safe. After the call, the message will be added
-    // to the queue to be sent.
+    // to the queue to be sent. The message is encrypted in place, so the buffer returned by
+    // Listener::onTcpMessageWritten contains encrypted data and can only be reused.
     void send(uint8_t channel_id, ByteArray&& buffer);
 
     // Disable or enable the algorithm of Nagle.
@@ -176,6 +178,7 @@ private:
     void addWriteTask(WriteTask::Type type, uint8_t channel_id, ByteArray&& data);
 
     void doWrite();
+    bool encryptUserData(WriteTask* task, ByteArray* prefix_buffer);
     void onWrite(const std::error_code& error_code, size_t bytes_transferred);
 
     void doReadSize();
@@ -212,14 +215,20 @@ private:
     std::unique_ptr<MessageEncryptor> encryptor_;
     std::unique_ptr<MessageDecryptor> decryptor_;
 
-    std::queue<WriteTask> write_queue_;
+    std::deque<WriteTask> write_queue_;
     VariableSizeWriter variable_size_writer_;
-    ByteArray write_buffer_;
+
+    // Several messages from the front of the queue are sent with a single write operation.
+    // |write_batch_size_| is the number of messages in the current write operation. User messages
+    // are encrypted in place, |write_buffers_| contain only their prefixes.
+    std::vector<ByteArray> write_buffers_;
+    std::vector<asio::const_buffer> write_buffer_list_;
+    size_t write_batch_size_ = 0;
 
     ReadState state_ = ReadState::IDLE;
     VariableSizeReader variable_size_reader_;
+    ByteArray read_prefix_;
     ByteArray read_buffer_;
-    ByteArray decrypt_buffer_;
 
     base::HostId host_id_ = base::kInvalidHostId;
     bool is_channel_id_supported_ = false;
@@ -43,7 +43,7 @@ void TcpChannelProxy::send(uint8_t channel_id, ByteArray&& buffer)
         std::scoped_lock lock(incoming_queue_lock_);
 
         schedule_write = incoming_queue_.empty();
-        incoming_queue_.emplace(WriteTask::Type::USER_DATA, channel_id, std::move(buffer));
+        incoming_queue_.emplace_back(WriteTask::Type::USER_DATA, channel_id, std::move(buffer));
     }
 
     if (!schedule_write)
@@ -71,7 +71,7 @@ void TcpChannelProxy::scheduleWrite()
 }
 
 //--------------------------------------------------------------------------------------------------
-bool TcpChannelProxy::reloadWriteQueue(std::queue<WriteTask>* work_queue)
+bool TcpChannelProxy::reloadWriteQueue(std::deque<WriteTask>* work_queue)
 {
     if (!work_queue->empty())
         return false;
@@ -0,0 +1,162 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/parallel_runner.h"
+
+#include "base/logging.h"
+#include "base/threading/simple_thread.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace base {
+
+namespace {
+
+const int kMaxThreadCount = 8;
+const int kMinProcessorsForThreads = 4;
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+ParallelRunner::ParallelRunner(int thread_count)
+{
+    thread_count = calcThreadCount(thread_count);
+
+    for (int i = 1; i < thread_count; ++i)
+    {
+        auto worker = std::make_unique<SimpleThread>();
+        worker->start(std::bind(&ParallelRunner::workerThread, this, i));
+        workers_.emplace_back(std::move(worker));
+    }
+
+    LOG(LS_INFO) << "Parallel runner threads: " << thread_count;
+}
+
+//--------------------------------------------------------------------------------------------------
+ParallelRunner::~ParallelRunner()
+{
+    {
+        std::scoped_lock lock(work_lock_);
+        work_terminate_ = true;
+    }
+
+    work_event_.notify_all();
+
+    for (const auto& worker : workers_)
+        worker->stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+int ParallelRunner::calcThreadCount(int thread_count)
+{
+    if (thread_count <= 0)
+    {
+        int processors = static_cast<int>(std::thread::hardware_concurrency());
+        if (processors < kMinProcessorsForThreads)
+            return 1;
+
+        // Leave half of the processors for the rest of the application.
+        thread_count = processors / 2;
+    }
+
+    return std::clamp(thread_count, 1, kMaxThreadCount);
+}
+
+//--------------------------------------------------------------------------------------------------
+void ParallelRunner::run(size_t count, const Task& task)
+{
+    if (workers_.empty() || count <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+            task(i, 0);
+        return;
+    }
+
+    {
+        std::scoped_lock lock(work_lock_);
+        work_task_ = &task;
+        work_count_ = count;
+        work_next_index_ = 0;
+        work_pending_ = workers_.size();
+        ++work_generation_;
+    }
+
+    work_event_.notify_all();
+
+    // The calling thread takes tasks along with the workers.
+    runTasks(0);
+
+    std::unique_lock lock(work_lock_);
+    done_event_.wait(lock, [this]() { return work_pending_ == 0; });
+
+    work_task_ = nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+void ParallelRunner::workerThread(int thread_index)
+{
+    uint64_t last_generation = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock lock(work_lock_);
+
+            work_event_.wait(lock, [&]()
+            {
+                return work_terminate_ || work_generation_ != last_generation;
+            });
+
+            if (work_terminate_)
+                return;
+
+            last_generation = work_generation_;
+        }
+
+        runTasks(thread_index);
+
+        bool is_last;
+
+        {
+            std::scoped_lock lock(work_lock_);
+            DCHECK_GT(work_pending_, 0U);
+            is_last = (--work_pending_ == 0);
+        }
+
+        if (is_last)
+            done_event_.notify_one();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void ParallelRunner::runTasks(int thread_index)
+{
+    // |work_task_| and |work_count_| do not change until all workers have finished the generation.
+    for (;;)
+    {
+        const size_t index = work_next_index_.fetch_add(1, std::memory_order_relaxed);
+        if (index >= work_count_)
+            break;
+
+        (*work_task_)(index, thread_index);
+    }
+}
+
+} // namespace base
@@ -0,0 +1,78 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_THREADING_PARALLEL_RUNNER_H
+#define BASE_THREADING_PARALLEL_RUNNER_H
+
+#include "base/macros_magic.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace base {
+
+class SimpleThread;
+
+// Runs a set of independent tasks on a fixed set of threads. The calling thread takes part in
+// the work, so a runner with one thread does not start any threads and runs the tasks in place.
+class ParallelRunner
+{
+public:
+    // If |thread_count| is 0 or less, the number of threads is chosen by the number of processors.
+    explicit ParallelRunner(int thread_count = 0);
+    ~ParallelRunner();
+
+    // |index| is the index of the task. |thread_index| is in the range [0, threadCount()) and is
+    // unique among the concurrently running tasks, so it can be used to select per-thread state.
+    using Task = std::function<void(size_t index, int thread_index)>;
+
+    // Calls |task| for each index in the range [0, count) and returns when all calls are done.
+    void run(size_t count, const Task& task);
+
+    // Returns the number of threads including the calling thread.
+    int threadCount() const { return static_cast<int>(workers_.size()) + 1; }
+
+    // Returns the number of threads that a runner created with |thread_count| uses.
+    static int calcThreadCount(int thread_count);
+
+private:
+    void workerThread(int thread_index);
+    void runTasks(int thread_index);
+
+    std::vector<std::unique_ptr<SimpleThread>> workers_;
+
+    std::mutex work_lock_;
+    std::condition_variable work_event_;
+    std::condition_variable done_event_;
+    const Task* work_task_ = nullptr;
+    size_t work_count_ = 0;
+    std::atomic<size_t> work_next_index_ = 0;
+    uint64_t work_generation_ = 0;
+    size_t work_pending_ = 0;
+    bool work_terminate_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ParallelRunner);
+};
+
+} // namespace base
+
+#endif // BASE_THREADING_PARALLEL_RUNNER_H
@@ -82,6 +82,9 @@ const char* videoEncodingToString(proto::VideoEncoding encoding)
         case proto::VIDEO_ENCODING_VP9:
             return "VIDEO_ENCODING_VP9";
 
+        case proto::VIDEO_ENCODING_AV1:
+            return "VIDEO_ENCODING_AV1";
+
         case proto::VIDEO_ENCODING_ZSTD:
             return "VIDEO_ENCODING_ZSTD";
 
@@ -246,7 +249,15 @@ void ClientDesktop::setDesktopConfig(const proto::DesktopConfig& desktop_config)
     input_event_filter_.setClipboardEnabled(desktop_config_.flags() & proto::ENABLE_CLIPBOARD);
 
     outgoing_message_->Clear();
-    outgoing_message_->mutable_config()->CopyFrom(desktop_config_);
+
+    proto::DesktopConfig* config = outgoing_message_->mutable_config();
+    config->CopyFrom(desktop_config_);
+
+    // The video decoder always supports copying of moved areas, tiled packets and persistent
+    // streams. These are capabilities of the client rather than options of the user, so they are
+    // added only to the configuration sent to the host and are never stored.
+    config->set_flags(config->flags() | proto::ENABLE_COPY_RECT | proto::ENABLE_VIDEO_TILES |
+                      proto::ENABLE_VIDEO_STREAM);
 
     LOG(LS_INFO) << "Send new config to host";
     sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
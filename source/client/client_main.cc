@@ -75,13 +75,17 @@ bool parseCodecValue(const QString& value, proto::DesktopConfig& config)
         {
             config.set_video_encoding(proto::VIDEO_ENCODING_VP9);
         }
+        else if (value == "av1")
+        {
+            config.set_video_encoding(proto::VIDEO_ENCODING_AV1);
+        }
         else if (value == "zstd")
         {
             config.set_video_encoding(proto::VIDEO_ENCODING_ZSTD);
         }
         else
         {
-            onInvalidValue("codec", "vp8, vp9, zstd");
+            onInvalidValue("codec", "vp8, vp9, av1, zstd");
             return false;
         }
     }
@@ -442,7 +446,7 @@ int clientMain(int argc, char* argv[])
         "desktop-manage");
 
     QCommandLineOption codec_option("codec",
-        QApplication::translate("Client", "Type of codec. Possible values: vp8, vp9, zstd."),
+        QApplication::translate("Client", "Type of codec. Possible values: vp8, vp9, av1, zstd."),
         "codec");
 
     QCommandLineOption color_depth_option("color-depth",
@@ -76,6 +76,8 @@ const char* videoEncodingToString(proto::VideoEncoding encoding)
             return "VIDEO_ENCODING_VP8";
         case proto::VIDEO_ENCODING_VP9:
             return "VIDEO_ENCODING_VP9";
+        case proto::VIDEO_ENCODING_AV1:
+            return "VIDEO_ENCODING_AV1";
         default:
             return "Unknown";
     }
@@ -103,6 +105,9 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
 
     QComboBox* combo_codec = ui->combo_codec;
 
+    if (video_encodings & proto::VIDEO_ENCODING_AV1)
+        combo_codec->addItem("AV1", proto::VIDEO_ENCODING_AV1);
+
     if (video_encodings & proto::VIDEO_ENCODING_VP9)
         combo_codec->addItem("VP9", proto::VIDEO_ENCODING_VP9);
 
@@ -147,6 +152,12 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     ui->slider_compress_ratio->setValue(static_cast<int>(config_.compress_ratio()));
     onCompressionRatioChanged(static_cast<int>(config_.compress_ratio()));
 
+    if (config_.flags() & proto::ENABLE_TILE_CACHE)
+        ui->checkbox_tile_cache->setChecked(true);
+
+    if (config_.flags() & proto::ENABLE_MOTION_LAYER)
+        ui->checkbox_motion_layer->setChecked(true);
+
     if (config_.audio_encoding() != proto::AUDIO_ENCODING_UNKNOWN)
         ui->checkbox_audio->setChecked(true);
 
@@ -295,6 +306,8 @@ void DesktopConfigDialog::onCodecChanged(int item_index)
     ui->slider_compress_ratio->setEnabled(has_pixel_format);
     ui->label_fast->setEnabled(has_pixel_format);
     ui->label_best->setEnabled(has_pixel_format);
+    ui->checkbox_tile_cache->setEnabled(has_pixel_format);
+    ui->checkbox_motion_layer->setEnabled(has_pixel_format);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -386,6 +399,12 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
         if (ui->checkbox_clear_clipboard->isChecked())
             flags |= proto::CLEAR_CLIPBOARD;
 
+        if (ui->checkbox_tile_cache->isChecked() && ui->checkbox_tile_cache->isEnabled())
+            flags |= proto::ENABLE_TILE_CACHE;
+
+        if (ui->checkbox_motion_layer->isChecked() && ui->checkbox_motion_layer->isEnabled())
+            flags |= proto::ENABLE_MOTION_LAYER;
+
         config_.set_flags(flags);
 
         emit sig_configChanged(config_);
@@ -48,8 +48,8 @@ const char kSupportedExtensionsForView[] =
     "select_screen;preferred_size;video_recording;video_pause;audio_pause";
 #endif
 
-const uint32_t kSupportedVideoEncodings =
-    proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 | proto::VIDEO_ENCODING_ZSTD;
+const uint32_t kSupportedVideoEncodings = proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 |
+    proto::VIDEO_ENCODING_AV1 | proto::VIDEO_ENCODING_ZSTD;
 const uint32_t kSupportedAudioEncodings = proto::AUDIO_ENCODING_OPUS;
 
 const char kFlagDisablePasteAsKeystrokes[] = "disable_paste_as_keystrokes";
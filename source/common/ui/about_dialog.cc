@@ -32,6 +32,7 @@
 #include <QTextStream>
 
 #include <asio/version.hpp>
+#include <aom/aom_codec.h>
 #include <curl/curl.h>
 #include <fmt/core.h>
 #include <google/protobuf/stubs/common.h>
@@ -72,6 +73,7 @@ const char* kTranslators[] =
 
 const char* kThirdParty[] =
 {
+    "aom &copy; 2016, Alliance for Open Media; BSD 2-Clause License",
     "asio &copy; 2003-2018 Christopher M. Kohlhoff; Boost Software License 1.0",
     "curl &copy; 1996-2022 Daniel Stenberg, and many contributors; CURL License",
     "fmt &copy; 2012 Victor Zverovich and contributors; MIT License",
@@ -208,6 +210,7 @@ AboutDialog::AboutDialog(const QString& application_name, QWidget* parent)
         list->addItem(tr("%1 version: %2").arg(name, version));
     };
 
+    add_version("aom", aom_codec_version_str());
     add_version("asio", QString("%1.%2.%3")
         .arg(ASIO_VERSION / 100000).arg(ASIO_VERSION / 100 % 1000).arg(ASIO_VERSION % 100));
     add_version("curl", curl_version());
@@ -71,6 +71,8 @@ const char* videoEncodingToString(proto::VideoEncoding encoding)
         return "VIDEO_ENCODING_VP8";
     case proto::VIDEO_ENCODING_VP9:
         return "VIDEO_ENCODING_VP9";
+    case proto::VIDEO_ENCODING_AV1:
+        return "VIDEO_ENCODING_AV1";
     default:
         return "Unknown";
     }
@@ -135,6 +137,7 @@ void ComputerGroupDialogDesktop::restoreSettings(
     }
 
     QComboBox* combo_codec = ui.combo_codec;
+    combo_codec->addItem("AV1", proto::VIDEO_ENCODING_AV1);
     combo_codec->addItem("VP9", proto::VIDEO_ENCODING_VP9);
     combo_codec->addItem("VP8", proto::VIDEO_ENCODING_VP8);
     combo_codec->addItem("ZSTD", proto::VIDEO_ENCODING_ZSTD);
@@ -176,6 +179,12 @@ void ComputerGroupDialogDesktop::restoreSettings(
     ui.slider_compress_ratio->setValue(static_cast<int>(desktop_config.compress_ratio()));
     onCompressionRatioChanged(static_cast<int>(desktop_config.compress_ratio()));
 
+    if (desktop_config.flags() & proto::ENABLE_TILE_CACHE)
+        ui.checkbox_tile_cache->setChecked(true);
+
+    if (desktop_config.flags() & proto::ENABLE_MOTION_LAYER)
+        ui.checkbox_motion_layer->setChecked(true);
+
     if (desktop_config.audio_encoding() != proto::AUDIO_ENCODING_UNKNOWN)
         ui.checkbox_audio->setChecked(true);
 
@@ -310,6 +319,12 @@ void ComputerGroupDialogDesktop::saveSettings(
     if (ui.checkbox_clear_clipboard->isChecked())
         flags |= proto::CLEAR_CLIPBOARD;
 
+    if (ui.checkbox_tile_cache->isChecked() && ui.checkbox_tile_cache->isEnabled())
+        flags |= proto::ENABLE_TILE_CACHE;
+
+    if (ui.checkbox_motion_layer->isChecked() && ui.checkbox_motion_layer->isEnabled())
+        flags |= proto::ENABLE_MOTION_LAYER;
+
     desktop_config->set_flags(flags);
 }
 
@@ -329,6 +344,8 @@ void ComputerGroupDialogDesktop::onCodecChanged(int item_index)
     ui.slider_compress_ratio->setEnabled(has_pixel_format);
     ui.label_fast->setEnabled(has_pixel_format);
     ui.label_best->setEnabled(has_pixel_format);
+    ui.checkbox_tile_cache->setEnabled(has_pixel_format);
+    ui.checkbox_motion_layer->setEnabled(has_pixel_format);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -50,6 +50,7 @@ bool isValidVideoEncoding(int video_encoding)
         case proto::VIDEO_ENCODING_ZSTD:
         case proto::VIDEO_ENCODING_VP8:
         case proto::VIDEO_ENCODING_VP9:
+        case proto::VIDEO_ENCODING_AV1:
             return true;
 
         default:
@@ -23,13 +23,10 @@
 #include "base/power_controller.h"
 #include "base/codec/audio_encoder_opus.h"
 #include "base/codec/cursor_encoder.h"
-#include "base/codec/scale_reducer.h"
-#include "base/codec/video_encoder_vpx.h"
-#include "base/codec/video_encoder_zstd.h"
 #include "base/desktop/frame.h"
-#include "base/desktop/screen_capturer.h"
 #include "common/desktop_session_constants.h"
 #include "host/desktop_session_proxy.h"
+#include "host/screen_encoder.h"
 #include "host/service_constants.h"
 #include "host/system_settings.h"
 #include "proto/desktop_internal.pb.h"
@@ -183,18 +180,18 @@ void ClientSessionDesktop::onReceived(uint8_t /* channel_id */, const base::Byte
             return;
         }
 
-        if (!scale_reducer_)
+        if (!screen_encoder_)
         {
-            LOG(LS_ERROR) << "Scale reducer NOT initialized";
+            LOG(LS_ERROR) << "Screen encoder NOT initialized";
             return;
         }
 
         const proto::MouseEvent& mouse_event = incoming_message_->mouse_event();
 
         int pos_x = static_cast<int>(
-            static_cast<double>(mouse_event.x() * 100) / scale_reducer_->scaleFactorX());
+            static_cast<double>(mouse_event.x() * 100) / scale_factor_x_);
         int pos_y = static_cast<int>(
-            static_cast<double>(mouse_event.y() * 100) / scale_reducer_->scaleFactorY());
+            static_cast<double>(mouse_event.y() * 100) / scale_factor_y_);
 
         proto::MouseEvent out_mouse_event;
         out_mouse_event.set_mask(mouse_event.mask());
@@ -276,102 +273,101 @@ void ClientSessionDesktop::onTaskManagerMessage(const proto::task_manager::HostT
 #endif // defined(OS_WIN)
 
 //--------------------------------------------------------------------------------------------------
-void ClientSessionDesktop::encodeScreen(const base::Frame* frame, const base::MouseCursor* cursor)
+bool ClientSessionDesktop::prepareScreenEncode(const base::Frame* frame, base::Size* size)
 {
-    if (critical_overflow_)
-        return;
+    if (critical_overflow_ || is_video_paused_ || !screen_encoder_)
+        return false;
 
-    outgoing_message_->Clear();
+    if (source_size_ != frame->size())
+    {
+        // Every time we change the resolution, we have to reset the preferred size.
+        source_size_ = frame->size();
+        preferred_size_ = base::Size();
+        forced_size_ = base::Size();
+    }
 
-    if (!is_video_paused_ && frame && video_encoder_)
+    base::Size current_size = preferred_size_;
+
+    // If the preferred size is larger than the original, then we use the original size.
+    if (current_size.width() > source_size_.width() ||
+        current_size.height() > source_size_.height())
     {
-        DCHECK(scale_reducer_);
+        current_size = source_size_;
+    }
 
-        if (source_size_ != frame->size())
-        {
-            // Every time we change the resolution, we have to reset the preferred size.
-            source_size_ = frame->size();
-            preferred_size_ = base::Size();
-            forced_size_ = base::Size();
-        }
+    // If we don't have a preferred size, then we use the original frame size.
+    if (current_size.isEmpty())
+        current_size = source_size_;
 
-        base::Size current_size = preferred_size_;
+    if (!forced_size_.isEmpty())
+    {
+        int forced = forced_size_.width() * forced_size_.height();
+        int current = current_size.width() * current_size.height();
 
-        // If the preferred size is larger than the original, then we use the original size.
-        if (current_size.width() > source_size_.width() ||
-            current_size.height() > source_size_.height())
-        {
-            current_size = source_size_;
-        }
+        if (forced < current)
+            current_size = forced_size_;
+    }
 
-        // If we don't have a preferred size, then we use the original frame size.
-        if (current_size.isEmpty())
-            current_size = source_size_;
+    *size = current_size;
+    return true;
+}
 
-        if (!forced_size_.isEmpty())
-        {
-            int forced = forced_size_.width() * forced_size_.height();
-            int current = current_size.width() * current_size.height();
+//--------------------------------------------------------------------------------------------------
+void ClientSessionDesktop::setScreenEncoder(std::shared_ptr<ScreenEncoder> screen_encoder)
+{
+    DCHECK(screen_encoder);
+    DCHECK(screen_encoder->params() == screen_encoder_params_);
 
-            if (forced < current)
-                current_size = forced_size_;
-        }
+    screen_encoder_ = std::move(screen_encoder);
+}
 
-        const base::Frame* scaled_frame = scale_reducer_->scaleFrame(frame, current_size);
-        if (!scaled_frame)
-        {
-            LOG(LS_ERROR) << "No scaled frame";
-            return;
-        }
+//--------------------------------------------------------------------------------------------------
+void ClientSessionDesktop::restartScreenEncoder()
+{
+    screen_encoder_ = ScreenEncoder::create(screen_encoder_params_);
+}
 
-        proto::VideoPacket* packet = outgoing_message_->mutable_video_packet();
+//--------------------------------------------------------------------------------------------------
+bool ClientSessionDesktop::isScreenEncoderShareable() const
+{
+    // Number of overflow detection intervals without overflows before the client can join a group.
+    static const size_t kShareableNormalCount = 5;
 
-        // Encode the frame into a video packet.
-        if (!video_encoder_->encode(scaled_frame, packet))
-        {
-            LOG(LS_ERROR) << "Unable to encode video packet";
-            return;
-        }
+    return !critical_overflow_ && write_overflow_count_ == 0 &&
+           write_normal_count_ >= kShareableNormalCount;
+}
 
-        if (packet->has_format())
-        {
-            proto::VideoPacketFormat* format = packet->mutable_format();
-
-            // In video packets that contain the format, we pass the screen capture type.
-            format->set_capturer_type(frame->capturerType());
-
-            // Real screen size.
-            proto::Size* screen_size = format->mutable_screen_size();
-            screen_size->set_width(frame->size().width());
-            screen_size->set_height(frame->size().height());
-
-            LOG(LS_INFO) << "Video packet has format";
-            LOG(LS_INFO) << "Capturer type: " << base::ScreenCapturer::typeToString(
-                static_cast<base::ScreenCapturer::Type>(frame->capturerType()));
-            LOG(LS_INFO) << "Screen size: " << screen_size->width() << "x"
-                         << screen_size->height();
-            LOG(LS_INFO) << "Video size: " << format->video_rect().width() << "x"
-                         << format->video_rect().height();
-        }
-    }
+//--------------------------------------------------------------------------------------------------
+void ClientSessionDesktop::sendScreenPacket(
+    const ScreenEncodePipeline::Target& target, base::ByteArray&& buffer)
+{
+    // The client left the group or the configuration was changed while the frame was being
+    // encoded.
+    if (target.encoder != screen_encoder_)
+        return;
 
-    if (cursor && cursor_encoder_)
-    {
-        if (!cursor_encoder_->encode(*cursor, outgoing_message_->mutable_cursor_shape()))
-            outgoing_message_->clear_cursor_shape();
-    }
+    scale_factor_x_ = target.scale_factor_x;
+    scale_factor_y_ = target.scale_factor_y;
 
-    if (outgoing_message_->has_video_packet() || outgoing_message_->has_cursor_shape())
-    {
-        sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
+    if (critical_overflow_)
+        return;
 
-        if (outgoing_message_->has_video_packet())
-        {
-            video_encoder_->setEncodeBuffer(
-                std::move(*outgoing_message_->mutable_video_packet()->mutable_data()));
-            stat_counter_.addVideoPacket();
-        }
-    }
+    sendMessage(proto::HOST_CHANNEL_ID_SESSION, std::move(buffer));
+    stat_counter_.addVideoPacket();
+}
+
+//--------------------------------------------------------------------------------------------------
+void ClientSessionDesktop::encodeCursor(const base::MouseCursor& cursor)
+{
+    if (critical_overflow_ || !cursor_encoder_)
+        return;
+
+    outgoing_message_->Clear();
+
+    if (!cursor_encoder_->encode(cursor, outgoing_message_->mutable_cursor_shape()))
+        return;
+
+    sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -418,9 +414,9 @@ void ClientSessionDesktop::setCursorPosition(const proto::CursorPosition& cursor
     outgoing_message_->Clear();
 
     int pos_x = static_cast<int>(
-        static_cast<double>(cursor_position.x()) * scale_reducer_->scaleFactorX() / 100.0);
+        static_cast<double>(cursor_position.x()) * scale_factor_x_ / 100.0);
     int pos_y = static_cast<int>(
-        static_cast<double>(cursor_position.y()) * scale_reducer_->scaleFactorY() / 100.0);
+        static_cast<double>(cursor_position.y()) * scale_factor_y_ / 100.0);
 
     proto::CursorPosition* position = outgoing_message_->mutable_cursor_position();
     position->set_x(pos_x);
@@ -520,30 +516,19 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
 //--------------------------------------------------------------------------------------------------
 void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
 {
-    switch (config.video_encoding())
-    {
-        case proto::VIDEO_ENCODING_VP8:
-            video_encoder_ = base::VideoEncoderVPX::createVP8();
-            break;
-
-        case proto::VIDEO_ENCODING_VP9:
-            video_encoder_ = base::VideoEncoderVPX::createVP9();
-            break;
-
-        case proto::VIDEO_ENCODING_ZSTD:
-            video_encoder_ = base::VideoEncoderZstd::create(
-                parsePixelFormat(config.pixel_format()), static_cast<int>(config.compress_ratio()));
-            break;
-
-        default:
-        {
-            // No supported video encoding.
-            LOG(LS_ERROR) << "Unsupported video encoding: " << config.video_encoding();
-        }
-        break;
-    }
-
-    if (!video_encoder_)
+    screen_encoder_params_.encoding = config.video_encoding();
+    screen_encoder_params_.pixel_format = parsePixelFormat(config.pixel_format());
+    screen_encoder_params_.compress_ratio = static_cast<int>(config.compress_ratio());
+    screen_encoder_params_.move_detection = (config.flags() & proto::ENABLE_COPY_RECT);
+    screen_encoder_params_.tiles = (config.flags() & proto::ENABLE_VIDEO_TILES);
+    screen_encoder_params_.persistent_stream = (config.flags() & proto::ENABLE_VIDEO_STREAM);
+    screen_encoder_params_.tile_cache = (config.flags() & proto::ENABLE_TILE_CACHE);
+    screen_encoder_params_.motion_layer = (config.flags() & proto::ENABLE_MOTION_LAYER);
+
+    // A frame that is being encoded keeps the previous encoder alive until it is finished. Its
+    // packet is not sent.
+    restartScreenEncoder();
+    if (!screen_encoder_)
     {
         LOG(LS_ERROR) << "Video encoder not initialized!";
         return;
@@ -570,8 +555,6 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
         cursor_encoder_ = std::make_unique<base::CursorEncoder>();
     }
 
-    scale_reducer_ = std::make_unique<base::ScaleReducer>();
-
     desktop_session_config_.disable_font_smoothing =
         (config.flags() & proto::DISABLE_FONT_SMOOTHING);
     desktop_session_config_.disable_effects =
@@ -662,13 +645,14 @@ void ClientSessionDesktop::readVideoPauseExtension(const std::string& data)
 
     if (!is_video_paused_)
     {
-        if (!video_encoder_)
+        // The client has missed the packets sent while the video was paused. It leaves its group
+        // and starts again with its own encoder.
+        restartScreenEncoder();
+        if (!screen_encoder_)
         {
             LOG(LS_ERROR) << "Video encoder not initialized";
             return;
         }
-
-        video_encoder_->setKeyFrameRequired(true);
     }
 }
 
@@ -909,8 +893,10 @@ void ClientSessionDesktop::onOverflowDetectionTimer()
     {
         if (critical_overflow_)
         {
-            if (video_encoder_)
-                video_encoder_->setKeyFrameRequired(true);
+            // The client has missed packets during the overflow. It leaves its group, so the
+            // other clients do not receive the whole frame again.
+            if (screen_encoder_)
+                restartScreenEncoder();
         }
 
         critical_overflow_ = false;
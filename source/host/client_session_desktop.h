@@ -26,6 +26,8 @@
 #include "base/waitable_timer.h"
 #include "host/client_session.h"
 #include "host/desktop_session.h"
+#include "host/screen_encode_pipeline.h"
+#include "host/screen_encoder.h"
 #include "host/stat_counter.h"
 
 #if defined(OS_WIN)
@@ -37,8 +39,6 @@ class AudioEncoder;
 class CursorEncoder;
 class Frame;
 class MouseCursor;
-class ScaleReducer;
-class VideoEncoder;
 } // namespace base
 
 namespace host {
@@ -59,7 +59,20 @@ public:
 
     void setDesktopSessionProxy(base::local_shared_ptr<DesktopSessionProxy> desktop_session_proxy);
 
-    void encodeScreen(const base::Frame* frame, const base::MouseCursor* cursor);
+    // Returns false if the client does not need |frame|. Otherwise |size| receives the size to
+    // which the frame is scaled for the client.
+    bool prepareScreenEncode(const base::Frame* frame, base::Size* size);
+
+    // The encoder may be shared with other clients with the same parameters and frame size.
+    const std::shared_ptr<ScreenEncoder>& screenEncoder() const { return screen_encoder_; }
+    void setScreenEncoder(std::shared_ptr<ScreenEncoder> screen_encoder);
+
+    // Returns true if the client keeps up with sending and can join a group of clients.
+    bool isScreenEncoderShareable() const;
+
+    // Sends the serialized packet of |target| if the client still uses its encoder.
+    void sendScreenPacket(const ScreenEncodePipeline::Target& target, base::ByteArray&& buffer);
+    void encodeCursor(const base::MouseCursor& cursor);
     void encodeAudio(const proto::AudioPacket& audio_packet);
     void setVideoErrorCode(proto::VideoErrorCode error_code);
     void setCursorPosition(const proto::CursorPosition& cursor_position);
@@ -95,10 +108,13 @@ private:
     void onOverflowDetectionTimer();
     void downStepOverflow();
     void upStepOverflow();
+    void restartScreenEncoder();
 
     base::local_shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
-    std::unique_ptr<base::ScaleReducer> scale_reducer_;
-    std::unique_ptr<base::VideoEncoder> video_encoder_;
+    ScreenEncoder::Params screen_encoder_params_;
+    std::shared_ptr<ScreenEncoder> screen_encoder_;
+    double scale_factor_x_ = 0;
+    double scale_factor_y_ = 0;
     std::unique_ptr<base::CursorEncoder> cursor_encoder_;
     std::unique_ptr<base::AudioEncoder> audio_encoder_;
     DesktopSession::Config desktop_session_config_;
@@ -81,6 +81,10 @@ public:
 
     virtual void setScreenCaptureFps(int fps) = 0;
 
+    // Sets the number of captured frames that are waiting for the encoder. The desktop agent
+    // captures less often while the encoder is behind.
+    virtual void setEncodeBacklog(int frames) = 0;
+
     virtual void injectKeyEvent(const proto::KeyEvent& event) = 0;
     virtual void injectTextEvent(const proto::TextEvent& event) = 0;
     virtual void injectMouseEvent(const proto::MouseEvent& event) = 0;
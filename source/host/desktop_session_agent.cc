@@ -25,6 +25,7 @@
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/screen_capturer_wrapper.h"
 #include "base/desktop/shared_frame.h"
+#include "base/desktop/shared_frame_ring.h"
 #include "base/ipc/shared_memory.h"
 #include "base/threading/thread.h"
 #include "host/system_settings.h"
@@ -149,11 +150,30 @@ void DesktopSessionAgent::onIpcMessageReceived(const base::ByteArray& buffer)
 
     if (incoming_message_->has_next_screen_capture())
     {
-        captureEnd(std::chrono::milliseconds(
-            incoming_message_->next_screen_capture().update_interval()));
+        const proto::internal::NextScreenCapture& next_screen_capture =
+            incoming_message_->next_screen_capture();
+
+        if (capture_scheduler_)
+        {
+            std::chrono::milliseconds update_interval(next_screen_capture.update_interval());
+
+            capture_scheduler_->setEncodeBacklog(next_screen_capture.encode_backlog());
+
+            if (update_interval == std::chrono::milliseconds::zero())
+            {
+                // The service needs a frame right now.
+                scheduleCapture(std::chrono::milliseconds::zero());
+            }
+            else
+            {
+                capture_scheduler_->setUpdateInterval(update_interval);
+            }
+        }
     }
     else if (incoming_message_->has_mouse_event())
     {
+        onUserActivity();
+
         if (input_injector_)
         {
             input_injector_->injectMouseEvent(incoming_message_->mouse_event());
@@ -165,6 +185,8 @@ void DesktopSessionAgent::onIpcMessageReceived(const base::ByteArray& buffer)
     }
     else if (incoming_message_->has_key_event())
     {
+        onUserActivity();
+
         if (input_injector_)
         {
             input_injector_->injectKeyEvent(incoming_message_->key_event());
@@ -176,6 +198,8 @@ void DesktopSessionAgent::onIpcMessageReceived(const base::ByteArray& buffer)
     }
     else if (incoming_message_->has_text_event())
     {
+        onUserActivity();
+
         if (input_injector_)
         {
             input_injector_->injectTextEvent(incoming_message_->text_event());
@@ -379,34 +403,40 @@ void DesktopSessionAgent::onScreenCaptured(
 
     proto::internal::ScreenCaptured* screen_captured = outgoing_message_->mutable_screen_captured();
 
-    if (frame && !frame->constUpdatedRegion().isEmpty())
+    if (frame && capture_scheduler_)
     {
-        base::SharedMemoryBase* shared_memory = frame->sharedMemory();
-        if (!shared_memory)
-        {
-            LOG(LS_ERROR) << "Unable to get shared memory";
-            return;
-        }
+        int64_t changed_area = 0;
 
-        if (input_injector_)
-            input_injector_->setScreenOffset(frame->topLeft());
+        for (base::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+            changed_area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
 
-        proto::internal::DesktopFrame* serialized_frame = screen_captured->mutable_frame();
+        capture_scheduler_->setChangedArea(changed_area,
+            static_cast<int64_t>(frame->size().width()) * frame->size().height());
+    }
 
-        serialized_frame->set_capturer_type(frame->capturerType());
-        serialized_frame->set_shared_buffer_id(shared_memory->id());
-        serialized_frame->set_width(frame->size().width());
-        serialized_frame->set_height(frame->size().height());
+    if (frame && !frame->constUpdatedRegion().isEmpty())
+    {
+        if (input_injector_)
+            input_injector_->setScreenOffset(frame->topLeft());
 
-        for (base::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        if (!frame_ring_ || frame_ring_->size() != frame->size())
         {
-            proto::Rect* dirty_rect = serialized_frame->add_dirty_rect();
-            base::Rect rect = it.rect();
+            // The old ring is released before the new one is created.
+            frame_ring_.reset();
+            frame_ring_ = base::SharedFrameRing::create(
+                frame->size(), shared_memory_factory_.get());
+        }
 
-            dirty_rect->set_x(rect.x());
-            dirty_rect->set_y(rect.y());
-            dirty_rect->set_width(rect.width());
-            dirty_rect->set_height(rect.height());
+        if (frame_ring_)
+        {
+            // The frame is copied to a free slot of the ring and the service reads the latest
+            // frame from it. We do not need to wait until the service releases the buffer.
+            frame_ring_->writeFrame(*frame);
+            screen_captured->mutable_frame()->set_shared_buffer_id(frame_ring_->id());
+        }
+        else
+        {
+            LOG(LS_ERROR) << "Unable to create frame ring";
         }
     }
 
@@ -425,13 +455,9 @@ void DesktopSessionAgent::onScreenCaptured(
     }
 
     if (screen_captured->has_frame() || screen_captured->has_mouse_cursor())
-    {
         channel_->send(serializer_.serialize(*outgoing_message_));
-    }
-    else
-    {
-        captureEnd(capture_scheduler_->updateInterval());
-    }
+
+    captureEnd();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -456,6 +482,7 @@ void DesktopSessionAgent::onScreenCaptureError(base::ScreenCapturer::Error error
     }
 
     channel_->send(serializer_.serialize(*outgoing_message_));
+    captureEnd();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -607,7 +634,9 @@ void DesktopSessionAgent::setEnabled(bool enable)
 
         input_injector_.reset();
         capture_scheduler_.reset();
+        capture_scheduled_ = false;
         screen_capturer_.reset();
+        frame_ring_.reset();
         shared_memory_factory_.reset();
         clipboard_monitor_.reset();
         audio_capturer_.reset();
@@ -646,7 +675,7 @@ void DesktopSessionAgent::captureBegin()
 }
 
 //--------------------------------------------------------------------------------------------------
-void DesktopSessionAgent::captureEnd(const std::chrono::milliseconds& update_interval)
+void DesktopSessionAgent::captureEnd()
 {
     if (!capture_scheduler_)
     {
@@ -655,21 +684,45 @@ void DesktopSessionAgent::captureEnd(const std::chrono::milliseconds& update_int
     }
 
     capture_scheduler_->endCapture();
+    scheduleCapture(capture_scheduler_->nextCaptureDelay());
+}
 
-    if (update_interval == std::chrono::milliseconds::zero())
-    {
-        // Capture immediately.
-        io_task_runner_->postTask(
-            std::bind(&DesktopSessionAgent::captureBegin, shared_from_this()));
-    }
-    else
-    {
-        capture_scheduler_->setUpdateInterval(update_interval);
+//--------------------------------------------------------------------------------------------------
+void DesktopSessionAgent::scheduleCapture(const std::chrono::milliseconds& delay)
+{
+    // Each scheduled capture gets a new sequence number, so the capture can be rescheduled: the
+    // task with the old number does nothing.
+    capture_scheduled_ = true;
+
+    io_task_runner_->postDelayedTask(std::bind(&DesktopSessionAgent::onScheduledCapture,
+                                               shared_from_this(),
+                                               ++capture_sequence_),
+                                     delay);
+}
 
-        io_task_runner_->postDelayedTask(
-            std::bind(&DesktopSessionAgent::captureBegin, shared_from_this()),
-            capture_scheduler_->nextCaptureDelay());
-    }
+//--------------------------------------------------------------------------------------------------
+void DesktopSessionAgent::onScheduledCapture(int64_t sequence)
+{
+    if (!capture_scheduled_ || sequence != capture_sequence_)
+        return;
+
+    capture_scheduled_ = false;
+    captureBegin();
+}
+
+//--------------------------------------------------------------------------------------------------
+void DesktopSessionAgent::onUserActivity()
+{
+    if (!capture_scheduler_)
+        return;
+
+    bool was_idle = capture_scheduler_->isIdle();
+    capture_scheduler_->onUserActivity();
+
+    // While the screen is idle, the next capture may be far away. It is rescheduled with the
+    // update interval so that the result of the input is shown without delay.
+    if (was_idle && capture_scheduled_)
+        scheduleCapture(capture_scheduler_->nextCaptureDelay());
 }
 
 #if defined(OS_WIN)
@@ -35,6 +35,7 @@ class CaptureScheduler;
 class TaskRunner;
 class Thread;
 class SharedFrame;
+class SharedFrameRing;
 
 #if defined(OS_WIN)
 namespace win {
@@ -91,7 +92,10 @@ protected:
 private:
     void setEnabled(bool enable);
     void captureBegin();
-    void captureEnd(const std::chrono::milliseconds& update_interval);
+    void captureEnd();
+    void scheduleCapture(const std::chrono::milliseconds& delay);
+    void onScheduledCapture(int64_t sequence);
+    void onUserActivity();
 
 #if defined(OS_WIN)
     bool onWindowsMessage(UINT message, WPARAM wparam, LPARAM lparam, LRESULT& result);
@@ -112,7 +116,10 @@ private:
 
     std::unique_ptr<base::SharedMemoryFactory> shared_memory_factory_;
     std::unique_ptr<base::CaptureScheduler> capture_scheduler_;
+    int64_t capture_sequence_ = 0;
+    bool capture_scheduled_ = false;
     std::unique_ptr<base::ScreenCapturerWrapper> screen_capturer_;
+    std::unique_ptr<base::SharedFrameRing> frame_ring_;
     std::unique_ptr<base::AudioCapturerWrapper> audio_capturer_;
 
     base::ScreenCapturer::Type preferred_video_capturer_ = base::ScreenCapturer::Type::DEFAULT;
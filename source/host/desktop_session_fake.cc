@@ -116,6 +116,12 @@ void DesktopSessionFake::setScreenCaptureFps(int /* fps */)
     // Nothing
 }
 
+//--------------------------------------------------------------------------------------------------
+void DesktopSessionFake::setEncodeBacklog(int /* frames */)
+{
+    // Nothing
+}
+
 //--------------------------------------------------------------------------------------------------
 void DesktopSessionFake::injectKeyEvent(const proto::KeyEvent& /* event */)
 {
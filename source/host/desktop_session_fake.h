@@ -42,6 +42,7 @@ public:
     void selectScreen(const proto::Screen& screen) final;
     void captureScreen() final;
     void setScreenCaptureFps(int fps) final;
+    void setEncodeBacklog(int frames) final;
     void injectKeyEvent(const proto::KeyEvent& event) final;
     void injectTextEvent(const proto::TextEvent& event) final;
     void injectMouseEvent(const proto::MouseEvent& event) final;
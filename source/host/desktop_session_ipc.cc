@@ -20,7 +20,7 @@
 
 #include "base/logging.h"
 #include "base/desktop/mouse_cursor.h"
-#include "base/desktop/shared_memory_frame.h"
+#include "base/desktop/shared_frame_ring.h"
 #include "base/memory/local_memory.h"
 #include "base/ipc/shared_memory.h"
 
@@ -174,7 +174,7 @@ void DesktopSessionIpc::captureScreen()
                 LOG(LS_INFO) << "No last screen list (sid=" << session_id_ << ")";
             }
 
-            delegate_->onScreenCaptured(last_frame_.get(), last_mouse_cursor_.get());
+            delegate_->onScreenCaptured(last_frame_, last_mouse_cursor_.get());
         }
         else
         {
@@ -201,6 +201,12 @@ void DesktopSessionIpc::setScreenCaptureFps(int fps)
     update_interval_ = std::chrono::milliseconds(1000 / fps);
 }
 
+//--------------------------------------------------------------------------------------------------
+void DesktopSessionIpc::setEncodeBacklog(int frames)
+{
+    encode_backlog_ = frames;
+}
+
 //--------------------------------------------------------------------------------------------------
 void DesktopSessionIpc::injectKeyEvent(const proto::KeyEvent& event)
 {
@@ -330,29 +336,24 @@ void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured&
 
     if (screen_captured.has_frame())
     {
-        const proto::internal::DesktopFrame& serialized_frame = screen_captured.frame();
+        int shared_buffer_id = screen_captured.frame().shared_buffer_id();
 
-        std::unique_ptr<SharedBuffer> shared_buffer = sharedBuffer(
-            serialized_frame.shared_buffer_id());
-        if (shared_buffer)
+        if (!frame_ring_ || frame_ring_->id() != shared_buffer_id)
         {
-            last_frame_ = base::SharedMemoryFrame::attach(
-                base::Size(serialized_frame.width(), serialized_frame.height()),
-                base::PixelFormat::ARGB(),
-                std::move(shared_buffer));
-
-            last_frame_->setCapturerType(serialized_frame.capturer_type());
-
-            base::Region* updated_region = last_frame_->updatedRegion();
+            last_frame_ = nullptr;
+            frame_ring_ = base::SharedFrameRing::attach(sharedBuffer(shared_buffer_id));
+        }
 
-            for (int i = 0; i < serialized_frame.dirty_rect_size(); ++i)
+        if (frame_ring_)
+        {
+            // Several notifications may arrive for one frame: the agent does not wait for us.
+            // If the latest frame has already been taken, there is nothing new.
+            base::Frame* ring_frame = frame_ring_->readFrame();
+            if (ring_frame)
             {
-                const proto::Rect& dirty_rect = serialized_frame.dirty_rect(i);
-                updated_region->addRect(base::Rect::makeXYWH(
-                    dirty_rect.x(), dirty_rect.y(), dirty_rect.width(), dirty_rect.height()));
+                last_frame_ = ring_frame;
+                frame = last_frame_;
             }
-
-            frame = last_frame_.get();
         }
     }
 
@@ -391,7 +392,12 @@ void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured&
     }
 
     outgoing_message_->Clear();
-    outgoing_message_->mutable_next_screen_capture()->set_update_interval(update_interval_.count());
+
+    proto::internal::NextScreenCapture* next_screen_capture =
+        outgoing_message_->mutable_next_screen_capture();
+    next_screen_capture->set_update_interval(update_interval_.count());
+    next_screen_capture->set_encode_backlog(encode_backlog_);
+
     channel_->send(serializer_.serialize(*outgoing_message_));
 }
 
@@ -426,8 +432,9 @@ void DesktopSessionIpc::onCreateSharedBuffer(int shared_buffer_id)
 {
     LOG(LS_INFO) << "Shared memory created: " << shared_buffer_id << " (sid=" << session_id_ << ")";
 
+    // The frame ring is opened for writing: the reader exchanges the slots in its header.
     std::unique_ptr<base::SharedMemory> shared_memory =
-        base::SharedMemory::open(base::SharedMemory::Mode::READ_ONLY, shared_buffer_id);
+        base::SharedMemory::open(base::SharedMemory::Mode::READ_WRITE, shared_buffer_id);
 
     if (!shared_memory)
     {
@@ -446,10 +453,11 @@ void DesktopSessionIpc::onReleaseSharedBuffer(int shared_buffer_id)
 
     shared_buffers_.erase(shared_buffer_id);
 
-    if (shared_buffers_.empty())
+    if (frame_ring_ && frame_ring_->id() == shared_buffer_id)
     {
         LOG(LS_INFO) << "Reset last frame (sid=" << session_id_ << ")";
-        last_frame_.reset();
+        last_frame_ = nullptr;
+        frame_ring_.reset();
     }
 }
 
@@ -25,6 +25,10 @@
 
 #include <map>
 
+namespace base {
+class SharedFrameRing;
+} // namespace base
+
 namespace host {
 
 class DesktopSessionIpc final
@@ -43,6 +47,7 @@ public:
     void selectScreen(const proto::Screen& screen) final;
     void captureScreen() final;
     void setScreenCaptureFps(int fps) final;
+    void setEncodeBacklog(int frames) final;
     void injectKeyEvent(const proto::KeyEvent& event) final;
     void injectTextEvent(const proto::TextEvent& event) final;
     void injectMouseEvent(const proto::MouseEvent& event) final;
@@ -68,12 +73,14 @@ private:
     base::SessionId session_id_ = base::kInvalidSessionId;
     std::unique_ptr<base::IpcChannel> channel_;
     SharedBuffers shared_buffers_;
-    std::unique_ptr<base::Frame> last_frame_;
+    std::unique_ptr<base::SharedFrameRing> frame_ring_;
+    base::Frame* last_frame_ = nullptr;
     std::unique_ptr<base::MouseCursor> last_mouse_cursor_;
     std::unique_ptr<proto::ScreenList> last_screen_list_;
     Delegate* delegate_;
 
     std::chrono::milliseconds update_interval_ { 40 }; // 25 fps by default.
+    int encode_backlog_ = 0;
 
     base::Serializer serializer_;
     std::unique_ptr<proto::internal::ServiceToDesktop> outgoing_message_;
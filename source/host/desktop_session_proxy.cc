@@ -157,6 +157,13 @@ void DesktopSessionProxy::setScreenCaptureFps(int fps)
         desktop_session_->setScreenCaptureFps(fps);
 }
 
+//--------------------------------------------------------------------------------------------------
+void DesktopSessionProxy::setEncodeBacklog(int frames)
+{
+    if (desktop_session_)
+        desktop_session_->setEncodeBacklog(frames);
+}
+
 //--------------------------------------------------------------------------------------------------
 int DesktopSessionProxy::defaultScreenCaptureFps() const
 {
@@ -38,6 +38,7 @@ public:
     void selectScreen(const proto::Screen& screen);
     void captureScreen();
     void setScreenCaptureFps(int fps);
+    void setEncodeBacklog(int frames);
     int screenCaptureFps() const;
     int defaultScreenCaptureFps() const;
     int minScreenCaptureFps() const;
@@ -0,0 +1,190 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/screen_encode_pipeline.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/desktop/frame_aligned.h"
+#include "base/threading/parallel_runner.h"
+#include "host/screen_encoder.h"
+
+namespace host {
+
+//--------------------------------------------------------------------------------------------------
+ScreenEncodePipeline::ScreenEncodePipeline(
+    std::shared_ptr<base::TaskRunner> io_task_runner, Delegate* delegate)
+    : io_task_runner_(std::move(io_task_runner)),
+      delegate_(delegate)
+{
+    LOG(LS_INFO) << "Ctor";
+
+    DCHECK(io_task_runner_);
+    DCHECK(delegate_);
+
+    encode_thread_.start(base::MessageLoop::Type::DEFAULT);
+}
+
+//--------------------------------------------------------------------------------------------------
+ScreenEncodePipeline::~ScreenEncodePipeline()
+{
+    LOG(LS_INFO) << "Dtor";
+    DCHECK(!delegate_);
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScreenEncodePipeline::stop()
+{
+    LOG(LS_INFO) << "Stop screen encode pipeline";
+
+    delegate_ = nullptr;
+    encode_thread_.stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScreenEncodePipeline::addFrame(const base::Frame* frame)
+{
+    DCHECK(frame);
+
+    if (!delegate_)
+        return;
+
+    if (!pending_frame_ || pending_frame_->size() != frame->size() ||
+        pending_frame_->format() != frame->format())
+    {
+        pending_frame_ = base::FrameAligned::create(frame->size(), frame->format(), 32);
+        if (!pending_frame_)
+        {
+            LOG(LS_ERROR) << "Unable to create pending frame";
+            return;
+        }
+
+        // The new frame does not contain any data yet.
+        pending_frame_->copyPixelsFrom(
+            *frame, base::Point(0, 0), base::Rect::makeSize(frame->size()));
+        pending_region_ = base::Region(base::Rect::makeSize(frame->size()));
+    }
+    else
+    {
+        for (base::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        {
+            const base::Rect& rect = it.rect();
+            pending_frame_->copyPixelsFrom(*frame, rect.topLeft(), rect);
+        }
+
+        pending_region_.addRegion(frame->constUpdatedRegion());
+    }
+
+    pending_frame_->setCapturerType(frame->capturerType());
+
+    if (busy_)
+        ++backlog_;
+    else
+        startEncode();
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScreenEncodePipeline::startEncode()
+{
+    DCHECK(!busy_);
+
+    if (!delegate_ || !pending_frame_ || pending_region_.isEmpty())
+        return;
+
+    if (!encode_frame_ || encode_frame_->size() != pending_frame_->size() ||
+        encode_frame_->format() != pending_frame_->format())
+    {
+        encode_frame_ = base::FrameAligned::create(
+            pending_frame_->size(), pending_frame_->format(), 32);
+        if (!encode_frame_)
+        {
+            LOG(LS_ERROR) << "Unable to create encode frame";
+            return;
+        }
+
+        pending_region_ = base::Region(base::Rect::makeSize(pending_frame_->size()));
+    }
+
+    // Only the changed areas are copied. The rest of |encode_frame_| is already up to date.
+    for (base::Region::Iterator it(pending_region_); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect& rect = it.rect();
+        encode_frame_->copyPixelsFrom(*pending_frame_, rect.topLeft(), rect);
+    }
+
+    encode_frame_->setCapturerType(pending_frame_->capturerType());
+    encode_frame_->updatedRegion()->swap(&pending_region_);
+    pending_region_.clear();
+
+    std::shared_ptr<Targets> targets = std::make_shared<Targets>();
+    delegate_->onEncodeTargets(encode_frame_.get(), targets.get());
+    if (targets->empty())
+        return;
+
+    busy_ = true;
+    backlog_ = 0;
+
+    auto self = shared_from_this();
+    encode_thread_.taskRunner()->postTask([self, targets]()
+    {
+        self->encodeTargets(targets.get());
+
+        self->io_task_runner_->postTask([self, targets]()
+        {
+            self->onEncodeFinished(targets.get());
+        });
+    });
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScreenEncodePipeline::encodeTargets(Targets* targets)
+{
+    for (auto& target : *targets)
+    {
+        if (target.encoder->params().tiles)
+        {
+            if (!tile_runner_)
+                tile_runner_ = std::make_shared<base::ParallelRunner>();
+
+            target.encoder->setTileRunner(tile_runner_);
+        }
+
+        if (target.buffer.capacity())
+            target.encoder->setEncodeBuffer(std::move(target.buffer));
+
+        target.encoded = target.encoder->encode(encode_frame_.get(), target.size, &target.packet);
+        target.scale_factor_x = target.encoder->scaleFactorX();
+        target.scale_factor_y = target.encoder->scaleFactorY();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScreenEncodePipeline::onEncodeFinished(Targets* targets)
+{
+    busy_ = false;
+
+    if (!delegate_)
+        return;
+
+    delegate_->onEncodeFinished(targets);
+
+    // Frames that arrived during encoding are encoded now.
+    startEncode();
+}
+
+} // namespace host
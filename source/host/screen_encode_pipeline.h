@@ -0,0 +1,130 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST_SCREEN_ENCODE_PIPELINE_H
+#define HOST_SCREEN_ENCODE_PIPELINE_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+#include "base/desktop/region.h"
+#include "base/threading/thread.h"
+#include "proto/desktop.pb.h"
+
+#include <memory>
+#include <vector>
+
+namespace base {
+class Frame;
+class ParallelRunner;
+class TaskRunner;
+} // namespace base
+
+namespace host {
+
+class ScreenEncoder;
+
+// Encodes captured frames on a separate thread. While a frame is being encoded, the desktop agent
+// captures the next one and the I/O thread sends the previous one, so the capturing, encoding and
+// sending stages run in parallel.
+// The queue between capturing and encoding holds one frame. A frame that arrives while the encoder
+// is busy replaces the queued one (the oldest frame is dropped), but the updated regions of both
+// are merged, so no changes are lost.
+class ScreenEncodePipeline : public std::enable_shared_from_this<ScreenEncodePipeline>
+{
+public:
+    // A frame is encoded once for each group of clients that share an encoder.
+    struct Target
+    {
+        std::vector<uint32_t> client_ids;
+        std::shared_ptr<ScreenEncoder> encoder;
+
+        // Size of the encoded frame.
+        base::Size size;
+
+        // Buffer of the previous sent packet. It is returned to the encoder before encoding.
+        std::string buffer;
+
+        // Results of encoding.
+        bool encoded = false;
+        proto::VideoPacket packet;
+        double scale_factor_x = 0;
+        double scale_factor_y = 0;
+    };
+
+    using Targets = std::vector<Target>;
+
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        // Called on the I/O thread before encoding |frame|. Fills |targets| with the encoders and
+        // the clients for which the frame should be encoded.
+        virtual void onEncodeTargets(const base::Frame* frame, Targets* targets) = 0;
+
+        // Called on the I/O thread when encoding is finished.
+        virtual void onEncodeFinished(Targets* targets) = 0;
+    };
+
+    ScreenEncodePipeline(std::shared_ptr<base::TaskRunner> io_task_runner, Delegate* delegate);
+    ~ScreenEncodePipeline();
+
+    // Stops the encoder thread. The delegate is not called after that.
+    void stop();
+
+    // Queues the updated region of |frame| for encoding. The pixels are copied, so the caller may
+    // reuse the frame as soon as the method returns.
+    void addFrame(const base::Frame* frame);
+
+    // Returns true if a frame is being encoded.
+    bool isBusy() const { return busy_; }
+
+    // Returns the number of frames that arrived since the current encoding was started.
+    int backlog() const { return backlog_; }
+
+private:
+    void startEncode();
+    void encodeTargets(Targets* targets);
+    void onEncodeFinished(Targets* targets);
+
+    std::shared_ptr<base::TaskRunner> io_task_runner_;
+    Delegate* delegate_;
+
+    base::Thread encode_thread_;
+
+    // The targets are encoded one after another, so their encoders share one runner for tiles.
+    // Used only on the encoder thread.
+    std::shared_ptr<base::ParallelRunner> tile_runner_;
+
+    // The frame that receives captured frames and the region that has changed in it since the
+    // last encoding. Used only on the I/O thread.
+    std::unique_ptr<base::Frame> pending_frame_;
+    base::Region pending_region_;
+
+    // The frame that is being encoded. While |busy_| is true, it is used only on the encoder
+    // thread.
+    std::unique_ptr<base::Frame> encode_frame_;
+    bool busy_ = false;
+    int backlog_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenEncodePipeline);
+};
+
+} // namespace host
+
+#endif // HOST_SCREEN_ENCODE_PIPELINE_H
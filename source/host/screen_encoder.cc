@@ -0,0 +1,183 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/screen_encoder.h"
+
+#include "base/logging.h"
+#include "base/codec/scale_reducer.h"
+#include "base/codec/video_encoder_av1.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/desktop/frame.h"
+#include "base/desktop/screen_capturer.h"
+
+namespace host {
+
+//--------------------------------------------------------------------------------------------------
+bool ScreenEncoder::Params::operator==(const Params& other) const
+{
+    return encoding == other.encoding && pixel_format == other.pixel_format &&
+           compress_ratio == other.compress_ratio && move_detection == other.move_detection &&
+           tiles == other.tiles && persistent_stream == other.persistent_stream &&
+           tile_cache == other.tile_cache && motion_layer == other.motion_layer;
+}
+
+//--------------------------------------------------------------------------------------------------
+ScreenEncoder::ScreenEncoder(
+    const Params& params, std::unique_ptr<base::VideoEncoder> video_encoder)
+    : params_(params),
+      video_encoder_(std::move(video_encoder)),
+      scale_reducer_(std::make_unique<base::ScaleReducer>())
+{
+    DCHECK(video_encoder_);
+}
+
+//--------------------------------------------------------------------------------------------------
+ScreenEncoder::~ScreenEncoder() = default;
+
+//--------------------------------------------------------------------------------------------------
+// static
+std::shared_ptr<ScreenEncoder> ScreenEncoder::create(const Params& params)
+{
+    std::unique_ptr<base::VideoEncoder> video_encoder = createVideoEncoder(params);
+    if (!video_encoder)
+        return nullptr;
+
+    return std::shared_ptr<ScreenEncoder>(new ScreenEncoder(params, std::move(video_encoder)));
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScreenEncoder::restart()
+{
+    restart_required_ = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScreenEncoder::setTileRunner(std::shared_ptr<base::ParallelRunner> runner)
+{
+    if (params_.encoding != proto::VIDEO_ENCODING_ZSTD)
+        return;
+
+    static_cast<base::VideoEncoderZstd*>(video_encoder_.get())->setTileRunner(std::move(runner));
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ScreenEncoder::encode(
+    const base::Frame* frame, const base::Size& size, proto::VideoPacket* packet)
+{
+    // The encoder drops its stream, tile cache and motion layer and sends the format and the
+    // whole frame.
+    if (restart_required_.exchange(false))
+        video_encoder_->setFormatRequired();
+
+    const base::Frame* scaled_frame = scale_reducer_->scaleFrame(frame, size);
+    if (!scaled_frame)
+    {
+        LOG(LS_ERROR) << "No scaled frame";
+        return false;
+    }
+
+    // Encode the frame into a video packet.
+    if (!video_encoder_->encode(scaled_frame, packet))
+    {
+        LOG(LS_ERROR) << "Unable to encode video packet";
+        return false;
+    }
+
+    if (packet->has_format())
+    {
+        proto::VideoPacketFormat* format = packet->mutable_format();
+
+        // In video packets that contain the format, we pass the screen capture type.
+        format->set_capturer_type(frame->capturerType());
+
+        // Real screen size.
+        proto::Size* screen_size = format->mutable_screen_size();
+        screen_size->set_width(frame->size().width());
+        screen_size->set_height(frame->size().height());
+
+        LOG(LS_INFO) << "Video packet has format";
+        LOG(LS_INFO) << "Capturer type: " << base::ScreenCapturer::typeToString(
+            static_cast<base::ScreenCapturer::Type>(frame->capturerType()));
+        LOG(LS_INFO) << "Screen size: " << screen_size->width() << "x"
+                     << screen_size->height();
+        LOG(LS_INFO) << "Video size: " << format->video_rect().width() << "x"
+                     << format->video_rect().height();
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScreenEncoder::setEncodeBuffer(std::string&& buffer)
+{
+    video_encoder_->setEncodeBuffer(std::move(buffer));
+}
+
+//--------------------------------------------------------------------------------------------------
+double ScreenEncoder::scaleFactorX() const
+{
+    return scale_reducer_->scaleFactorX();
+}
+
+//--------------------------------------------------------------------------------------------------
+double ScreenEncoder::scaleFactorY() const
+{
+    return scale_reducer_->scaleFactorY();
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+std::unique_ptr<base::VideoEncoder> ScreenEncoder::createVideoEncoder(const Params& params)
+{
+    switch (params.encoding)
+    {
+        case proto::VIDEO_ENCODING_VP8:
+            return base::VideoEncoderVPX::createVP8();
+
+        case proto::VIDEO_ENCODING_VP9:
+            return base::VideoEncoderVPX::createVP9();
+
+        case proto::VIDEO_ENCODING_AV1:
+            return base::VideoEncoderAV1::create();
+
+        case proto::VIDEO_ENCODING_ZSTD:
+        {
+            std::unique_ptr<base::VideoEncoderZstd> encoder =
+                base::VideoEncoderZstd::create(params.pixel_format, params.compress_ratio);
+            if (!encoder)
+                return nullptr;
+
+            encoder->setMoveDetectionEnabled(params.move_detection);
+            encoder->setTilesEnabled(params.tiles);
+            encoder->setPersistentStreamEnabled(params.persistent_stream);
+            encoder->setTileCacheEnabled(params.tile_cache);
+            encoder->setMotionLayerEnabled(params.motion_layer);
+            return encoder;
+        }
+
+        default:
+        {
+            // No supported video encoding.
+            LOG(LS_ERROR) << "Unsupported video encoding: " << params.encoding;
+            return nullptr;
+        }
+    }
+}
+
+} // namespace host
@@ -0,0 +1,104 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST_SCREEN_ENCODER_H
+#define HOST_SCREEN_ENCODER_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+#include "base/desktop/pixel_format.h"
+#include "proto/desktop.pb.h"
+
+#include <atomic>
+#include <memory>
+
+namespace base {
+class Frame;
+class ParallelRunner;
+class ScaleReducer;
+class VideoEncoder;
+} // namespace base
+
+namespace host {
+
+// Video encoder of a group of desktop clients. Clients with the same parameters and frame size
+// share one instance, so each frame is encoded once for all of them. Frames are encoded on the
+// thread of ScreenEncodePipeline while the clients live on the I/O thread. When the configuration
+// of a client changes, it gets a new instance instead of changing the existing one.
+class ScreenEncoder
+{
+public:
+    struct Params
+    {
+        bool operator==(const Params& other) const;
+        bool operator!=(const Params& other) const { return !(*this == other); }
+
+        proto::VideoEncoding encoding = proto::VIDEO_ENCODING_UNKNOWN;
+        base::PixelFormat pixel_format;
+        int compress_ratio = 0;
+        bool move_detection = false;
+        bool tiles = false;
+        bool persistent_stream = false;
+        bool tile_cache = false;
+        bool motion_layer = false;
+    };
+
+    ~ScreenEncoder();
+
+    static std::shared_ptr<ScreenEncoder> create(const Params& params);
+
+    const Params& params() const { return params_; }
+
+    // May be called from any thread. The encoder starts a new stream with the next frame: the
+    // packet contains the format and the whole frame, so a client that has not received the
+    // previous packets can decode it.
+    void restart();
+
+    // Sets the runner that compresses the tiles of ZSTD packets. Called on the encoder thread.
+    void setTileRunner(std::shared_ptr<base::ParallelRunner> runner);
+
+    // Scales |frame| to |size| and encodes it into |packet|. Called on the encoder thread.
+    bool encode(const base::Frame* frame, const base::Size& size, proto::VideoPacket* packet);
+
+    // Returns the buffer of a sent packet to the encoder. Called on the encoder thread.
+    void setEncodeBuffer(std::string&& buffer);
+
+    // Buffer of the last sent packet. It is kept on the I/O thread until the next frame.
+    std::string takeSpareBuffer() { return std::move(spare_buffer_); }
+    void setSpareBuffer(std::string&& buffer) { spare_buffer_ = std::move(buffer); }
+
+    // Scale factors of the last encoded frame. Called on the encoder thread.
+    double scaleFactorX() const;
+    double scaleFactorY() const;
+
+private:
+    ScreenEncoder(const Params& params, std::unique_ptr<base::VideoEncoder> video_encoder);
+    static std::unique_ptr<base::VideoEncoder> createVideoEncoder(const Params& params);
+
+    const Params params_;
+    std::unique_ptr<base::VideoEncoder> video_encoder_;
+    std::unique_ptr<base::ScaleReducer> scale_reducer_;
+    std::atomic_bool restart_required_ { false };
+    std::string spare_buffer_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenEncoder);
+};
+
+} // namespace host
+
+#endif // HOST_SCREEN_ENCODER_H
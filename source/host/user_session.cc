@@ -31,6 +31,9 @@
 #include "host/client_session_desktop.h"
 #include "host/client_session_text_chat.h"
 #include "host/desktop_session_proxy.h"
+#include "host/screen_encoder.h"
+
+#include <algorithm>
 
 #if defined(OS_WIN)
 #include "base/win/session_enumerator.h"
@@ -119,6 +122,9 @@ UserSession::~UserSession()
     LOG(LS_INFO) << "Dtor (sid=" << session_id_
                  << " type=" << typeToString(type_)
                  << " state=" << stateToString(state_) << ")";
+
+    if (encode_pipeline_)
+        encode_pipeline_->stop();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -838,8 +844,131 @@ void UserSession::onDesktopSessionStopped()
 //--------------------------------------------------------------------------------------------------
 void UserSession::onScreenCaptured(const base::Frame* frame, const base::MouseCursor* cursor)
 {
+    if (frame)
+    {
+        if (!encode_pipeline_)
+            encode_pipeline_ = std::make_shared<ScreenEncodePipeline>(task_runner_, this);
+
+        // The frame is copied and encoded on the encoder thread. The desktop agent can start
+        // capturing the next frame as soon as we return.
+        encode_pipeline_->addFrame(frame);
+
+        // The backlog is passed to the desktop agent along with the request for the next frame.
+        if (desktop_session_proxy_)
+            desktop_session_proxy_->setEncodeBacklog(encode_pipeline_->backlog());
+    }
+
+    if (cursor)
+    {
+        for (const auto& client : desktop_clients_)
+            static_cast<ClientSessionDesktop*>(client.get())->encodeCursor(*cursor);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void UserSession::onEncodeTargets(const base::Frame* frame, ScreenEncodePipeline::Targets* targets)
+{
+    // Clients with the same encoder parameters and frame size are grouped so that the frame is
+    // encoded once for each group. An encoder is never used by more than one target.
     for (const auto& client : desktop_clients_)
-        static_cast<ClientSessionDesktop*>(client.get())->encodeScreen(frame, cursor);
+    {
+        ClientSessionDesktop* desktop_client = static_cast<ClientSessionDesktop*>(client.get());
+
+        base::Size size;
+        if (!desktop_client->prepareScreenEncode(frame, &size))
+            continue;
+
+        std::shared_ptr<ScreenEncoder> encoder = desktop_client->screenEncoder();
+        DCHECK(encoder);
+
+        auto target = std::find_if(targets->begin(), targets->end(),
+            [&encoder](const ScreenEncodePipeline::Target& target)
+        {
+            return target.encoder == encoder;
+        });
+
+        if (target != targets->end())
+        {
+            if (target->size == size)
+            {
+                // The client stays in its group.
+                target->client_ids.emplace_back(client->id());
+                continue;
+            }
+
+            // The frame size of the client differs from the rest of the group. The client leaves
+            // the group with a new encoder.
+            encoder = ScreenEncoder::create(encoder->params());
+            if (!encoder)
+                continue;
+
+            desktop_client->setScreenEncoder(encoder);
+        }
+
+        if (desktop_client->isScreenEncoderShareable())
+        {
+            target = std::find_if(targets->begin(), targets->end(),
+                [&encoder, &size](const ScreenEncodePipeline::Target& target)
+            {
+                return target.encoder->params() == encoder->params() && target.size == size;
+            });
+
+            if (target != targets->end())
+            {
+                LOG(LS_INFO) << "Client " << client->id() << " joins encoder group with "
+                             << target->client_ids.size() << " clients (sid=" << session_id_
+                             << ")";
+
+                // The client has not received the previous packets of the group. The group starts
+                // a new stream that it can decode.
+                desktop_client->setScreenEncoder(target->encoder);
+                target->encoder->restart();
+                target->client_ids.emplace_back(client->id());
+                continue;
+            }
+        }
+
+        ScreenEncodePipeline::Target new_target;
+        new_target.client_ids.emplace_back(client->id());
+        new_target.encoder = std::move(encoder);
+        new_target.size = size;
+        new_target.buffer = new_target.encoder->takeSpareBuffer();
+
+        targets->emplace_back(std::move(new_target));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void UserSession::onEncodeFinished(ScreenEncodePipeline::Targets* targets)
+{
+    proto::HostToClient message;
+
+    for (auto& target : *targets)
+    {
+        if (!target.encoded)
+            continue;
+
+        // The packet is serialized once for all clients of the group.
+        message.mutable_video_packet()->Swap(&target.packet);
+        base::ByteArray buffer = base::serialize(message);
+
+        for (const auto& client : desktop_clients_)
+        {
+            // The client could disconnect while the frame was being encoded.
+            if (std::find(target.client_ids.begin(), target.client_ids.end(), client->id()) ==
+                target.client_ids.end())
+            {
+                continue;
+            }
+
+            static_cast<ClientSessionDesktop*>(client.get())->sendScreenPacket(
+                target, base::ByteArray(buffer));
+        }
+
+        // The buffer will be returned to the encoder with the next frame.
+        target.encoder->setSpareBuffer(std::move(*message.mutable_video_packet()->mutable_data()));
+        message.Clear();
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
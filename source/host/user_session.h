@@ -29,6 +29,7 @@
 #include "base/win/session_status.h"
 #include "host/client_session.h"
 #include "host/desktop_session_manager.h"
+#include "host/screen_encode_pipeline.h"
 #include "host/system_settings.h"
 #include "host/unconfirmed_client_session.h"
 #include "proto/host_internal.pb.h"
@@ -43,7 +44,8 @@ class UserSession final
     : public base::IpcChannel::Listener,
       public DesktopSession::Delegate,
       public UnconfirmedClientSession::Delegate,
-      public ClientSession::Delegate
+      public ClientSession::Delegate,
+      public ScreenEncodePipeline::Delegate
 {
 public:
     enum class Type
@@ -125,6 +127,10 @@ protected:
         const std::string& computer_name, const std::string& user_name, bool started) final;
     void onClientSessionTextChat(uint32_t id, const proto::TextChat& text_chat) final;
 
+    // ScreenEncodePipeline::Delegate implementation.
+    void onEncodeTargets(const base::Frame* frame, ScreenEncodePipeline::Targets* targets) final;
+    void onEncodeFinished(ScreenEncodePipeline::Targets* targets) final;
+
 private:
     void onSessionDettached(const base::Location& location);
     void sendConnectEvent(const ClientSession& client_session);
@@ -179,6 +185,7 @@ private:
 
     std::unique_ptr<DesktopSessionManager> desktop_session_;
     base::local_shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
+    std::shared_ptr<ScreenEncodePipeline> encode_pipeline_;
 
     Delegate* delegate_ = nullptr;
 
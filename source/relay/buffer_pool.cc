@@ -0,0 +1,172 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/buffer_pool.h"
+
+#include "base/logging.h"
+
+namespace relay {
+
+namespace {
+
+// Maximum number of free buffers of each size kept in the pool.
+const size_t kMaxCachedBuffers = 256;
+
+//--------------------------------------------------------------------------------------------------
+// Returns the largest power of two multiple of |min_size| that does not exceed |max_size|.
+size_t roundMaxSize(size_t min_size, size_t max_size)
+{
+    size_t size = min_size;
+    while (size * 2 <= max_size)
+        size *= 2;
+    return size;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+BufferPool::BufferPool(size_t min_size, size_t max_size, size_t memory_limit)
+    : min_size_(min_size),
+      max_size_(roundMaxSize(min_size, max_size)),
+      memory_limit_(memory_limit)
+{
+    LOG(LS_INFO) << "Ctor (min: " << min_size_ << ", max: " << max_size_
+                 << ", limit: " << memory_limit_ << ")";
+    DCHECK_GT(min_size_, 0u);
+
+    size_t count = 1;
+    while ((min_size_ << (count - 1)) < max_size_)
+        ++count;
+
+    free_lists_.resize(count);
+}
+
+//--------------------------------------------------------------------------------------------------
+BufferPool::~BufferPool()
+{
+    LOG(LS_INFO) << "Dtor";
+}
+
+//--------------------------------------------------------------------------------------------------
+base::ByteArray BufferPool::acquire(size_t size)
+{
+    size_t index = 0;
+    while (index + 1 < free_lists_.size() && (min_size_ << index) < size)
+        ++index;
+
+    std::scoped_lock lock(lock_);
+
+    for (; index > 0; --index)
+    {
+        std::vector<base::ByteArray>& free_list = free_lists_[index];
+        if (!free_list.empty())
+        {
+            base::ByteArray buffer = std::move(free_list.back());
+            free_list.pop_back();
+            return buffer;
+        }
+
+        const size_t buffer_size = min_size_ << index;
+
+        if (memory_usage_ + buffer_size > memory_limit_)
+            evictCached(buffer_size);
+
+        if (memory_usage_ + buffer_size <= memory_limit_)
+        {
+            memory_usage_ += buffer_size;
+            return base::ByteArray(buffer_size);
+        }
+
+        // The memory limit is reached. Try a smaller buffer.
+    }
+
+    std::vector<base::ByteArray>& free_list = free_lists_.front();
+    if (!free_list.empty())
+    {
+        base::ByteArray buffer = std::move(free_list.back());
+        free_list.pop_back();
+        return buffer;
+    }
+
+    return base::ByteArray(min_size_);
+}
+
+//--------------------------------------------------------------------------------------------------
+void BufferPool::release(base::ByteArray&& buffer)
+{
+    if (buffer.empty())
+        return;
+
+    const size_t index = classIndex(buffer.size());
+    if (index >= free_lists_.size())
+        return;
+
+    std::scoped_lock lock(lock_);
+
+    std::vector<base::ByteArray>& free_list = free_lists_[index];
+    if (free_list.size() < kMaxCachedBuffers)
+    {
+        free_list.emplace_back(std::move(buffer));
+        return;
+    }
+
+    if (index != 0)
+        memory_usage_ -= buffer.size();
+    buffer = base::ByteArray();
+}
+
+//--------------------------------------------------------------------------------------------------
+size_t BufferPool::memoryUsage() const
+{
+    std::scoped_lock lock(lock_);
+    return memory_usage_;
+}
+
+//--------------------------------------------------------------------------------------------------
+size_t BufferPool::classIndex(size_t size) const
+{
+    for (size_t index = 0; index < free_lists_.size(); ++index)
+    {
+        if ((min_size_ << index) == size)
+            return index;
+    }
+
+    NOTREACHED();
+    return free_lists_.size();
+}
+
+//--------------------------------------------------------------------------------------------------
+void BufferPool::evictCached(size_t required)
+{
+    // Cached buffers are freed starting with the largest ones.
+    for (size_t index = free_lists_.size() - 1; index > 0; --index)
+    {
+        std::vector<base::ByteArray>& free_list = free_lists_[index];
+
+        while (!free_list.empty())
+        {
+            if (memory_usage_ + required <= memory_limit_)
+                return;
+
+            memory_usage_ -= free_list.back().size();
+            free_list.pop_back();
+        }
+    }
+}
+
+} // namespace relay
@@ -0,0 +1,70 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY_BUFFER_POOL_H
+#define RELAY_BUFFER_POOL_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+#include <mutex>
+
+namespace relay {
+
+// Thread-safe pool of the buffers used by sessions to forward data between peers. Buffer sizes
+// are powers of two multiples of the minimum size. The memory limit applies to buffers larger
+// than the minimum size. Buffers of the minimum size are always provided so that every session
+// can make progress.
+class BufferPool
+{
+public:
+    BufferPool(size_t min_size, size_t max_size, size_t memory_limit);
+    ~BufferPool();
+
+    size_t minSize() const { return min_size_; }
+    size_t maxSize() const { return max_size_; }
+
+    // Returns a buffer of at least |size| bytes (but not more than the maximum size). If the memory
+    // limit is reached, a smaller buffer is returned.
+    base::ByteArray acquire(size_t size);
+
+    // Returns a buffer received from acquire() to the pool.
+    void release(base::ByteArray&& buffer);
+
+    // Returns the amount of memory used by buffers larger than the minimum size (including
+    // cached buffers).
+    size_t memoryUsage() const;
+
+private:
+    size_t classIndex(size_t size) const;
+    void evictCached(size_t required);
+
+    const size_t min_size_;
+    const size_t max_size_;
+    const size_t memory_limit_;
+
+    mutable std::mutex lock_;
+    std::vector<std::vector<base::ByteArray>> free_lists_;
+    size_t memory_usage_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(BufferPool);
+};
+
+} // namespace relay
+
+#endif // RELAY_BUFFER_POOL_H
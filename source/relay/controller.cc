@@ -19,10 +19,12 @@
 #include "relay/controller.h"
 
 #include "base/logging.h"
+#include "base/sys_info.h"
 #include "base/task_runner.h"
 #include "base/net/tcp_server.h"
 #include "base/peer/client_authenticator.h"
 #include "proto/router_common.pb.h"
+#include "relay/buffer_pool.h"
 #include "relay/settings.h"
 
 namespace relay {
@@ -30,6 +32,9 @@ namespace relay {
 namespace {
 
 const std::chrono::seconds kReconnectTimeout{ 15 };
+const uint32_t kMaxWorkerThreads = 256;
+const uint32_t kMinBufferSize = 1024;
+const uint32_t kMaxBufferSize = 16 * 1024 * 1024;
 
 class KeyDeleter
 {
@@ -86,6 +91,13 @@ Controller::Controller(std::shared_ptr<base::TaskRunner> task_runner)
     max_peer_count_ = settings.maxPeerCount();
     statistics_enabled_ = settings.isStatisticsEnabled();
     statistics_interval_ = settings.statisticsInterval();
+    worker_threads_ = settings.workerThreads();
+    min_buffer_size_ = settings.minBufferSize();
+    max_buffer_size_ = settings.maxBufferSize();
+    buffer_memory_limit_ = settings.bufferMemoryLimit();
+
+    if (!worker_threads_)
+        worker_threads_ = static_cast<uint32_t>(std::max(base::SysInfo::processorThreads(), 1));
 
     LOG(LS_INFO) << "Listen interface: " << listen_interface_;
     LOG(LS_INFO) << "Peer address: " << peer_address_;
@@ -94,6 +106,10 @@ Controller::Controller(std::shared_ptr<base::TaskRunner> task_runner)
     LOG(LS_INFO) << "Max peer count: " << max_peer_count_;
     LOG(LS_INFO) << "Statistics enabled: " << statistics_enabled_;
     LOG(LS_INFO) << "Statistics interval: " << statistics_interval_.count();
+    LOG(LS_INFO) << "Worker threads: " << worker_threads_;
+    LOG(LS_INFO) << "Min buffer size: " << min_buffer_size_;
+    LOG(LS_INFO) << "Max buffer size: " << max_buffer_size_;
+    LOG(LS_INFO) << "Buffer memory limit: " << buffer_memory_limit_;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -155,9 +171,25 @@ bool Controller::start()
         return false;
     }
 
+    if (worker_threads_ > kMaxWorkerThreads)
+    {
+        LOG(LS_ERROR) << "Invalid number of worker threads";
+        return false;
+    }
+
+    if (min_buffer_size_ < kMinBufferSize || min_buffer_size_ > max_buffer_size_ ||
+        max_buffer_size_ > kMaxBufferSize)
+    {
+        LOG(LS_ERROR) << "Invalid buffer size";
+        return false;
+    }
+
+    std::shared_ptr<BufferPool> buffer_pool = std::make_shared<BufferPool>(
+        min_buffer_size_, max_buffer_size_, static_cast<size_t>(buffer_memory_limit_) * 1024 * 1024);
+
     sessions_worker_ = std::make_unique<SessionsWorker>(
         listen_interface_, peer_port_, peer_idle_timeout_, statistics_enabled_, statistics_interval_,
-        shared_pool_->share());
+        std::move(buffer_pool), worker_threads_, shared_pool_->share());
     sessions_worker_->start(task_runner_, this);
 
     connectToRouter();
@@ -35,13 +35,15 @@ constexpr uint32_t kMaxMessageSize = 1 * 1024 * 1024; // 1 MB
 } // namespace
 
 //--------------------------------------------------------------------------------------------------
-PendingSession::PendingSession(std::shared_ptr<base::TaskRunner> task_runner,
+PendingSession::PendingSession(TimerWheel* timer_wheel,
                                asio::ip::tcp::socket&& socket,
                                Delegate* delegate)
     : delegate_(delegate),
-      timer_(base::WaitableTimer::Type::SINGLE_SHOT, std::move(task_runner)),
+      timer_wheel_(timer_wheel),
       socket_(std::move(socket))
 {
+    DCHECK(timer_wheel_);
+
     address_ = socket_.remote_endpoint().address().to_string();
 }
 
@@ -68,11 +70,23 @@ void PendingSession::start()
                       << base::utf16FromLocal8Bit(error_code.message());
     }
 
-    timer_.start(kTimeout, std::bind(
+    timer_.start(timer_wheel_, kTimeout, std::bind(
         &PendingSession::onErrorOccurred, this, FROM_HERE, std::error_code()));
     PendingSession::doReadMessage(this);
 }
 
+//--------------------------------------------------------------------------------------------------
+void PendingSession::startAuthenticated(uint32_t key_id, const base::ByteArray& secret)
+{
+    LOG(LS_INFO) << "Starting authenticated pending session";
+
+    start_time_ = Clock::now();
+    setIdentify(key_id, secret);
+
+    timer_.start(timer_wheel_, kTimeout, std::bind(
+        &PendingSession::onErrorOccurred, this, FROM_HERE, std::error_code()));
+}
+
 //--------------------------------------------------------------------------------------------------
 void PendingSession::stop()
 {
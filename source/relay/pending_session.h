@@ -19,16 +19,15 @@
 #ifndef RELAY_PENDING_SESSION_H
 #define RELAY_PENDING_SESSION_H
 
-#include "base/waitable_timer.h"
 #include "base/memory/byte_array.h"
 #include "base/peer/host_id.h"
 #include "proto/relay_peer.pb.h"
+#include "relay/timer_wheel.h"
 
 #include <asio/ip/tcp.hpp>
 
 namespace base {
 class Location;
-class TaskRunner;
 } // namespace base
 
 namespace relay {
@@ -52,7 +51,7 @@ public:
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = std::chrono::time_point<Clock>;
 
-    PendingSession(std::shared_ptr<base::TaskRunner> task_runner,
+    PendingSession(TimerWheel* timer_wheel,
                    asio::ip::tcp::socket&& socket,
                    Delegate* delegate);
     ~PendingSession();
@@ -62,6 +61,10 @@ public:
     // will be called.
     void start();
 
+    // Starts a session whose authentication data has already been received by another session
+    // manager. Only the timer is started, the session waits for the opposite side peer.
+    void startAuthenticated(uint32_t key_id, const base::ByteArray& secret);
+
     // Stops a session. No notifications will not come after calling this method.
     void stop();
 
@@ -87,7 +90,8 @@ private:
 
     std::string address_;
     TimePoint start_time_;
-    base::WaitableTimer timer_;
+    TimerWheel* timer_wheel_;
+    TimerWheel::Timer timer_;
     asio::ip::tcp::socket socket_;
 
     uint32_t buffer_size_ = 0;
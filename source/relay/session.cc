@@ -22,19 +22,50 @@
 #include "base/logging.h"
 #include "base/strings/unicode.h"
 #include "proto/relay_peer.pb.h"
+#include "relay/buffer_pool.h"
 
 #include <asio/write.hpp>
 
+#include <atomic>
+
+#if defined(OS_LINUX)
+#include "base/posix/eintr_wrapper.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#endif // defined(OS_LINUX)
+
 namespace relay {
 
+namespace {
+
+// Number of consecutive reads that use less than a quarter of the buffer after which the buffer
+// size is halved.
+const int kMaxSmallReads = 4;
+
+#if defined(OS_LINUX)
+// Maximum number of bytes moved by a single splice() call (default pipe capacity).
+const size_t kSpliceSize = 64 * 1024;
+
+// Maximum number of reads from the source socket in one handler call. After that, the session
+// waits for the socket again so that other sessions on the same thread are not blocked.
+const int kMaxSpliceReads = 16;
+#endif // defined(OS_LINUX)
+
+} // namespace
+
 //--------------------------------------------------------------------------------------------------
 Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets,
-                 const base::ByteArray& secret)
-    : socket_{ std::move(sockets.first), std::move(sockets.second) }
+                 const base::ByteArray& secret,
+                 std::shared_ptr<BufferPool> buffer_pool)
+    : socket_{ std::move(sockets.first), std::move(sockets.second) },
+      buffer_pool_(std::move(buffer_pool))
 {
-    static uint64_t session_id = 0;
-    ++session_id;
-    session_id_ = session_id;
+    DCHECK(buffer_pool_);
+
+    // Sessions are created by several session managers running on different threads.
+    static std::atomic<uint64_t> session_id = 0;
+    session_id_ = ++session_id;
 
     proto::PeerToRelay::Secret secret_message;
     if (secret_message.ParseFromArray(secret.data(), static_cast<int>(secret.size())))
@@ -46,13 +77,20 @@ Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& socke
     }
 
     for (size_t i = 0; i < kNumberOfSides; ++i)
-        std::fill(buffer_[i].begin(), buffer_[i].end(), 0);
+        buffer_size_[i] = buffer_pool_->minSize();
 }
 
 //--------------------------------------------------------------------------------------------------
 Session::~Session()
 {
     stop();
+
+#if defined(OS_LINUX)
+    closePipes();
+#endif // defined(OS_LINUX)
+
+    for (int i = 0; i < kNumberOfSides; ++i)
+        buffer_pool_->release(std::move(buffer_[i]));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -61,15 +99,29 @@ void Session::start(Delegate* delegate)
     LOG(LS_INFO) << "Starting peers session";
 
     start_time_ = Clock::now();
+    last_activity_time_ = start_time_;
     delegate_ = delegate;
 
+#if defined(OS_LINUX)
+    if (initSplice())
+    {
+        for (int i = 0; i < kNumberOfSides; ++i)
+            Session::doSplice(this, i);
+        return;
+    }
+
+    LOG(LS_INFO) << "splice() is not available. Regular forwarding is used";
+#endif // defined(OS_LINUX)
+
     for (int i = 0; i < kNumberOfSides; ++i)
-        Session::doReadSome(this, i);
+        Session::doWaitRead(this, i);
 }
 
 //--------------------------------------------------------------------------------------------------
 void Session::stop()
 {
+    idle_timer_.stop();
+
     if (!delegate_)
         return;
 
@@ -97,13 +149,7 @@ void Session::disconnect()
 //--------------------------------------------------------------------------------------------------
 std::chrono::seconds Session::idleTime(const TimePoint& current_time) const
 {
-    if (start_idle_time_ == TimePoint())
-    {
-        start_idle_time_ = current_time;
-        return std::chrono::seconds(0);
-    }
-
-    return std::chrono::duration_cast<std::chrono::seconds>(current_time - start_idle_time_);
+    return std::chrono::duration_cast<std::chrono::seconds>(current_time - last_activity_time_);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -116,8 +162,10 @@ std::chrono::seconds Session::duration(const TimePoint& current_time) const
 // static
 void Session::doReadSome(Session* session, int source)
 {
+    base::ByteArray& buffer = session->buffer_[source];
+
     session->socket_[source].async_read_some(
-        asio::buffer(session->buffer_[source].data(), session->buffer_[source].size()),
+        asio::buffer(buffer.data(), buffer.size()),
         [session, source](const std::error_code& error_code, size_t bytes_transferred)
     {
         if (error_code)
@@ -128,12 +176,18 @@ void Session::doReadSome(Session* session, int source)
         else
         {
             session->bytes_transferred_ += bytes_transferred;
-            session->start_idle_time_ = TimePoint();
+            session->last_activity_time_ = Clock::now();
+
+            // If the buffer was filled completely, more data is probably waiting in the socket
+            // and the buffer is kept for the next read.
+            const bool keep_buffer = bytes_transferred == session->buffer_[source].size();
+            session->updateBufferSize(source, bytes_transferred);
 
             asio::async_write(
                 session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
                 asio::const_buffer(session->buffer_[source].data(), bytes_transferred),
-                [session, source](const std::error_code& error_code, size_t /* bytes_transferred */)
+                [session, source, keep_buffer](const std::error_code& error_code,
+                                               size_t /* bytes_transferred */)
             {
                 if (error_code)
                 {
@@ -142,6 +196,26 @@ void Session::doReadSome(Session* session, int source)
                 }
                 else
                 {
+                    base::ByteArray& buffer = session->buffer_[source];
+                    BufferPool* buffer_pool = session->buffer_pool_.get();
+
+                    // The buffer is returned to the pool while the session waits for new data or
+                    // when a buffer of another size is required.
+                    if (!keep_buffer || buffer.size() != session->buffer_size_[source])
+                    {
+                        buffer_pool->release(std::move(buffer));
+                        buffer = base::ByteArray();
+                    }
+
+                    if (!keep_buffer)
+                    {
+                        doWaitRead(session, source);
+                        return;
+                    }
+
+                    if (buffer.empty())
+                        buffer = buffer_pool->acquire(session->buffer_size_[source]);
+
                     doReadSome(session, source);
                 }
             });
@@ -149,6 +223,195 @@ void Session::doReadSome(Session* session, int source)
     });
 }
 
+//--------------------------------------------------------------------------------------------------
+// static
+void Session::doWaitRead(Session* session, int source)
+{
+    session->socket_[source].async_wait(asio::socket_base::wait_read,
+                                        [session, source](const std::error_code& error_code)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+                session->onErrorOccurred(FROM_HERE, error_code);
+        }
+        else
+        {
+            session->buffer_[source] = session->buffer_pool_->acquire(session->buffer_size_[source]);
+            doReadSome(session, source);
+        }
+    });
+}
+
+//--------------------------------------------------------------------------------------------------
+void Session::updateBufferSize(int source, size_t bytes_transferred)
+{
+    const size_t capacity = buffer_[source].size();
+    size_t& size = buffer_size_[source];
+
+    if (bytes_transferred == capacity)
+    {
+        // The session saturates the buffer.
+        small_reads_[source] = 0;
+        size = std::min(capacity * 2, buffer_pool_->maxSize());
+    }
+    else if (bytes_transferred <= capacity / 4)
+    {
+        if (++small_reads_[source] >= kMaxSmallReads)
+        {
+            small_reads_[source] = 0;
+            size = std::max(size / 2, buffer_pool_->minSize());
+        }
+    }
+    else
+    {
+        small_reads_[source] = 0;
+    }
+}
+
+#if defined(OS_LINUX)
+
+//--------------------------------------------------------------------------------------------------
+bool Session::initSplice()
+{
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        if (pipe2(pipe_[i], O_NONBLOCK | O_CLOEXEC) != 0)
+        {
+            PLOG(LS_ERROR) << "pipe2 failed";
+            closePipes();
+            return false;
+        }
+
+        std::error_code error_code;
+        socket_[i].native_non_blocking(true, error_code);
+        if (error_code)
+        {
+            LOG(LS_ERROR) << "Unable to set non-blocking mode: "
+                          << base::utf16FromLocal8Bit(error_code.message());
+            closePipes();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Session::closePipes()
+{
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        for (int j = 0; j < 2; ++j)
+        {
+            if (pipe_[i][j] != -1)
+            {
+                IGNORE_EINTR(close(pipe_[i][j]));
+                pipe_[i][j] = -1;
+            }
+        }
+
+        pipe_pending_[i] = 0;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+void Session::doSplice(Session* session, int source)
+{
+    const int target = (source + kNumberOfSides - 1) % kNumberOfSides;
+    const int source_fd = session->socket_[source].native_handle();
+    const int target_fd = session->socket_[target].native_handle();
+    const int* pipe = session->pipe_[source];
+
+    int reads_count = 0;
+
+    while (true)
+    {
+        if (session->pipe_pending_[source])
+        {
+            // Move the data from the pipe to the target socket.
+            ssize_t result = HANDLE_EINTR(splice(pipe[0], nullptr, target_fd, nullptr,
+                                                 session->pipe_pending_[source],
+                                                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+            if (result < 0)
+            {
+                if (errno == EAGAIN)
+                {
+                    // The target socket buffer is full.
+                    doWaitSplice(session, target, asio::socket_base::wait_write, source);
+                }
+                else
+                {
+                    session->onErrorOccurred(
+                        FROM_HERE, std::error_code(errno, std::system_category()));
+                }
+                return;
+            }
+
+            session->pipe_pending_[source] -= static_cast<size_t>(result);
+        }
+        else
+        {
+            if (reads_count >= kMaxSpliceReads)
+            {
+                doWaitSplice(session, source, asio::socket_base::wait_read, source);
+                return;
+            }
+
+            // Move the data from the source socket to the pipe.
+            ssize_t result = HANDLE_EINTR(splice(source_fd, nullptr, pipe[1], nullptr,
+                                                 kSpliceSize,
+                                                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+            if (result <= 0)
+            {
+                if (result < 0 && errno == EAGAIN)
+                {
+                    // No data in the source socket.
+                    doWaitSplice(session, source, asio::socket_base::wait_read, source);
+                }
+                else if (!result)
+                {
+                    session->onErrorOccurred(FROM_HERE, asio::error::eof);
+                }
+                else
+                {
+                    session->onErrorOccurred(
+                        FROM_HERE, std::error_code(errno, std::system_category()));
+                }
+                return;
+            }
+
+            session->bytes_transferred_ += result;
+            session->last_activity_time_ = Clock::now();
+            session->pipe_pending_[source] = static_cast<size_t>(result);
+
+            ++reads_count;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+void Session::doWaitSplice(Session* session, int side, asio::socket_base::wait_type type,
+                           int source)
+{
+    session->socket_[side].async_wait(type, [session, source](const std::error_code& error_code)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+                session->onErrorOccurred(FROM_HERE, error_code);
+        }
+        else
+        {
+            doSplice(session, source);
+        }
+    });
+}
+
+#endif // defined(OS_LINUX)
+
 //--------------------------------------------------------------------------------------------------
 void Session::onErrorOccurred(const base::Location& location, const std::error_code& error_code)
 {
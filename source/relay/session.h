@@ -19,9 +19,11 @@
 #ifndef RELAY_SESSION_H
 #define RELAY_SESSION_H
 
+#include "build/build_config.h"
 #include "base/macros_magic.h"
 #include "base/memory/byte_array.h"
 #include "base/peer/host_id.h"
+#include "relay/timer_wheel.h"
 
 #include <asio/ip/tcp.hpp>
 
@@ -31,11 +33,14 @@ class Location;
 
 namespace relay {
 
+class BufferPool;
+
 class Session
 {
 public:
     Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets,
-            const base::ByteArray& secret);
+            const base::ByteArray& secret,
+            std::shared_ptr<BufferPool> buffer_pool);
     ~Session();
 
     using Clock = std::chrono::high_resolution_clock;
@@ -59,11 +64,25 @@ public:
     const std::string& hostAddress() const { return host_address_; }
     base::HostId hostId() const { return host_id_; }
     std::chrono::seconds idleTime(const TimePoint& current_time) const;
+    TimePoint lastActivityTime() const { return last_activity_time_; }
     std::chrono::seconds duration(const TimePoint& current_time) const;
     int64_t bytesTransferred() const { return bytes_transferred_; }
 
+    // Timer used by the session manager to check the idle time of the session. It is stopped
+    // when the session is stopped.
+    TimerWheel::Timer* idleTimer() { return &idle_timer_; }
+
 private:
     static void doReadSome(Session* session, int source);
+    static void doWaitRead(Session* session, int source);
+    void updateBufferSize(int source, size_t bytes_transferred);
+#if defined(OS_LINUX)
+    bool initSplice();
+    void closePipes();
+    static void doSplice(Session* session, int source);
+    static void doWaitSplice(Session* session, int side, asio::socket_base::wait_type type,
+                             int source);
+#endif // defined(OS_LINUX)
     void onErrorOccurred(const base::Location& location, const std::error_code& error_code);
 
     uint64_t session_id_ = 0;
@@ -73,15 +92,30 @@ private:
     base::HostId host_id_ = base::kInvalidHostId;
 
     TimePoint start_time_;
-    mutable TimePoint start_idle_time_;
+    TimePoint last_activity_time_;
     int64_t bytes_transferred_ = 0;
 
     static const int kNumberOfSides = 2;
-    static const int kBufferSize = 8192;
 
     asio::ip::tcp::socket socket_[kNumberOfSides];
-    std::array<uint8_t, kBufferSize> buffer_[kNumberOfSides];
 
+    // The buffer for each direction is taken from the pool only while there is data to forward.
+    // |buffer_size_| is the size requested for the next buffer: it grows while the session fills
+    // the buffer completely and shrinks after several small reads.
+    std::shared_ptr<BufferPool> buffer_pool_;
+    base::ByteArray buffer_[kNumberOfSides];
+    size_t buffer_size_[kNumberOfSides] = { 0, 0 };
+    int small_reads_[kNumberOfSides] = { 0, 0 };
+
+#if defined(OS_LINUX)
+    // Pipes for forwarding data with splice() without copying it to user space (one for each
+    // direction). |pipe_pending_| contains the number of bytes that were moved from the source
+    // socket to the pipe but not yet moved to the target socket.
+    int pipe_[kNumberOfSides][2] = { { -1, -1 }, { -1, -1 } };
+    size_t pipe_pending_[kNumberOfSides] = { 0, 0 };
+#endif // defined(OS_LINUX)
+
+    TimerWheel::Timer idle_timer_;
     Delegate* delegate_ = nullptr;
 
     DISALLOW_COPY_AND_ASSIGN(Session);
@@ -24,12 +24,20 @@
 #include "base/message_loop/message_pump_asio.h"
 #include "base/crypto/message_decryptor_openssl.h"
 #include "base/strings/unicode.h"
+#include "build/build_config.h"
+
+#if defined(OS_POSIX)
+#include <unistd.h>
+#endif // defined(OS_POSIX)
 
 namespace relay {
 
 namespace {
 
-const std::chrono::minutes kIdleTimerInterval { 1 };
+// The timer wheel covers about 8.5 minutes in one revolution with a one second resolution.
+// Longer timeouts take several revolutions.
+const std::chrono::seconds kTimerWheelResolution { 1 };
+const size_t kTimerWheelSlots = 512;
 
 //--------------------------------------------------------------------------------------------------
 // Decrypts an encrypted pair of peer identifiers using key |session_key|.
@@ -94,6 +102,17 @@ std::unique_ptr<T> removeSessionT(std::vector<std::unique_ptr<T>>* session_list,
     return nullptr;
 }
 
+//--------------------------------------------------------------------------------------------------
+// Closes a socket handle that is not owned by any asio socket object.
+void closeNativeSocket(asio::ip::tcp::socket::native_handle_type socket)
+{
+#if defined(OS_WIN)
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
 } // namespace
 
 //--------------------------------------------------------------------------------------------------
@@ -102,19 +121,27 @@ SessionManager::SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
                                uint16_t port,
                                const std::chrono::minutes& idle_timeout,
                                bool statistics_enabled,
-                               const std::chrono::seconds& statistics_interval)
+                               const std::chrono::seconds& statistics_interval,
+                               std::shared_ptr<BufferPool> buffer_pool,
+                               size_t worker_index,
+                               size_t worker_count)
     : task_runner_(std::move(task_runner)),
+      timer_wheel_(base::MessageLoop::current()->pumpAsio()->ioContext(), kTimerWheelResolution,
+                   kTimerWheelSlots),
       acceptor_(base::MessageLoop::current()->pumpAsio()->ioContext()),
+      buffer_pool_(std::move(buffer_pool)),
       address_(address),
       port_(port),
+      worker_index_(worker_index),
+      worker_count_(worker_count),
       idle_timeout_(idle_timeout),
-      idle_timer_(base::MessageLoop::current()->pumpAsio()->ioContext()),
       stat_timer_(base::MessageLoop::current()->pumpAsio()->ioContext()),
       statistics_enabled_(statistics_enabled),
       statistics_interval_(statistics_interval)
 {
-    LOG(LS_INFO) << "Ctor";
-    DCHECK(task_runner_);
+    LOG(LS_INFO) << "Ctor (worker " << worker_index_ << " of " << worker_count_ << ")";
+    DCHECK(task_runner_ && buffer_pool_);
+    DCHECK_LT(worker_index_, worker_count_);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -125,7 +152,6 @@ SessionManager::~SessionManager()
     std::error_code ignored_code;
     acceptor_.cancel(ignored_code);
     acceptor_.close(ignored_code);
-    idle_timer_.cancel();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -133,41 +159,6 @@ void SessionManager::start(std::unique_ptr<SharedPool> shared_pool, Delegate* de
 {
     LOG(LS_INFO) << "Starting session manager";
 
-    asio::ip::tcp::endpoint endpoint(address_, port_);
-
-    std::error_code error_code;
-    acceptor_.open(endpoint.protocol(), error_code);
-    if (error_code)
-    {
-        LOG(LS_ERROR) << "acceptor_.open failed: "
-                      << base::utf16FromLocal8Bit(error_code.message());
-        return;
-    }
-
-    acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true), error_code);
-    if (error_code)
-    {
-        LOG(LS_ERROR) << "acceptor_.set_option failed: "
-                      << base::utf16FromLocal8Bit(error_code.message());
-        return;
-    }
-
-    acceptor_.bind(endpoint, error_code);
-    if (error_code)
-    {
-        LOG(LS_ERROR) << "acceptor_.bind failed: "
-                      << base::utf16FromLocal8Bit(error_code.message());
-        return;
-    }
-
-    acceptor_.listen(asio::ip::tcp::socket::max_listen_connections, error_code);
-    if (error_code)
-    {
-        LOG(LS_ERROR) << "acceptor_.listen failed: "
-                      << base::utf16FromLocal8Bit(error_code.message());
-        return;
-    }
-
     start_time_ = Clock::now();
 
     shared_pool_ = std::move(shared_pool);
@@ -175,33 +166,58 @@ void SessionManager::start(std::unique_ptr<SharedPool> shared_pool, Delegate* de
 
     DCHECK(delegate_ && shared_pool_);
 
-    idle_timer_.expires_after(kIdleTimerInterval);
-    idle_timer_.async_wait(std::bind(&SessionManager::doIdleTimeout, this, std::placeholders::_1));
-
     if (statistics_enabled_)
     {
         stat_timer_.expires_after(statistics_interval_);
         stat_timer_.async_wait(std::bind(&SessionManager::doStatTimeout, this, std::placeholders::_1));
     }
 
+    // Without its own acceptor the session manager still serves the peers handed off to it.
+    if (!listen())
+        return;
+
     SessionManager::doAccept(this);
 }
 
 //--------------------------------------------------------------------------------------------------
-void SessionManager::disconnectSession(uint64_t session_id)
+bool SessionManager::disconnectSession(uint64_t session_id)
 {
-    LOG(LS_INFO) << "Disconnect session by session id: " << session_id;
-
     for (const auto& session : active_sessions_)
     {
         if (session->sessionId() == session_id)
         {
             session->disconnect();
-            return;
+            return true;
         }
     }
 
-    LOG(LS_ERROR) << "Session with id " << session_id << " not found";
+    return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+void SessionManager::acceptHandOff(const HandOff& hand_off)
+{
+    LOG(LS_INFO) << "Peer with key " << hand_off.key_id << " handed off to worker " << worker_index_;
+
+    asio::ip::tcp::socket socket(base::MessageLoop::current()->pumpAsio()->ioContext());
+
+    std::error_code error_code;
+    socket.assign(hand_off.protocol, hand_off.socket, error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to assign socket: " << base::utf16FromLocal8Bit(error_code.message());
+        closeNativeSocket(hand_off.socket);
+        return;
+    }
+
+    pending_sessions_.emplace_back(
+        std::make_unique<PendingSession>(&timer_wheel_, std::move(socket), this));
+
+    PendingSession* session = pending_sessions_.back().get();
+    session->startAuthenticated(hand_off.key_id, hand_off.secret);
+
+    if (!pairSession(session, hand_off.key_id, hand_off.secret))
+        LOG(LS_INFO) << "Second peer has not connected yet";
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -218,35 +234,19 @@ void SessionManager::onPendingSessionReady(
         base::ByteArray secret = decryptSecret(message, *key);
         if (!secret.empty())
         {
+            // Both peers with the same key are paired by the same session manager.
+            if (message.key_id() % worker_count_ != worker_index_)
+            {
+                handOffSession(session, message.key_id(), secret);
+                return;
+            }
+
             // Save the identifiers of peers and the identifier of their shared key.
             session->setIdentify(message.key_id(), secret);
 
             // Trying to find a peer that wants to be connected.
-            for (auto& other_session : pending_sessions_)
-            {
-                if (session->isPeerFor(*other_session))
-                {
-                    LOG(LS_INFO) << "Both peers are connected with key " << message.key_id();
-
-                    // Delete the key from the pool. It can no longer be used.
-                    shared_pool_->removeKey(message.key_id());
-
-                    // Now the opposite peer is found, start the data transfer between them.
-                    active_sessions_.emplace_back(std::make_unique<Session>(
-                        std::make_pair(session->takeSocket(), other_session->takeSocket()), secret));
-                    active_sessions_.back()->start(this);
-
-                    if (delegate_)
-                        delegate_->onSessionStarted();
-
-                    // Pending sessions are no longer needed, remove them.
-                    removePendingSession(other_session.get());
-                    removePendingSession(session);
-                    return;
-                }
-            }
-
-            LOG(LS_INFO) << "Second peer has not connected yet";
+            if (!pairSession(session, message.key_id(), secret))
+                LOG(LS_INFO) << "Second peer has not connected yet";
             return;
         }
         else
@@ -275,6 +275,71 @@ void SessionManager::onSessionFinished(Session* session)
     removeSession(session);
 }
 
+//--------------------------------------------------------------------------------------------------
+bool SessionManager::listen()
+{
+#if !defined(OS_LINUX)
+    // SO_REUSEPORT does not balance incoming connections between sockets on this platform. The
+    // first session manager accepts all connections and the others only serve handed off peers.
+    if (worker_index_ != 0)
+        return false;
+#endif // !defined(OS_LINUX)
+
+    asio::ip::tcp::endpoint endpoint(address_, port_);
+
+    std::error_code error_code;
+    acceptor_.open(endpoint.protocol(), error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "acceptor_.open failed: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true), error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "acceptor_.set_option failed: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+#if defined(OS_LINUX)
+    if (worker_count_ > 1)
+    {
+        // Each session manager has its own acceptor on the same port. The kernel distributes
+        // incoming connections between them.
+        using ReusePort = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+        acceptor_.set_option(ReusePort(true), error_code);
+        if (error_code)
+        {
+            LOG(LS_ERROR) << "acceptor_.set_option(SO_REUSEPORT) failed: "
+                          << base::utf16FromLocal8Bit(error_code.message());
+            return false;
+        }
+    }
+#endif // defined(OS_LINUX)
+
+    acceptor_.bind(endpoint, error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "acceptor_.bind failed: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    acceptor_.listen(asio::ip::tcp::socket::max_listen_connections, error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "acceptor_.listen failed: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    return true;
+}
+
 //--------------------------------------------------------------------------------------------------
 // static
 void SessionManager::doAccept(SessionManager* self)
@@ -289,7 +354,7 @@ void SessionManager::doAccept(SessionManager* self)
 
             // A new peer is connected. Create and start the pending session.
             self->pending_sessions_.emplace_back(std::make_unique<PendingSession>(
-                self->task_runner_, std::move(socket), self));
+                &self->timer_wheel_, std::move(socket), self));
             self->pending_sessions_.back()->start();
         }
         else
@@ -307,49 +372,33 @@ void SessionManager::doAccept(SessionManager* self)
 }
 
 //--------------------------------------------------------------------------------------------------
-// static
-void SessionManager::doIdleTimeout(SessionManager* self, const std::error_code& error_code)
+void SessionManager::startIdleTimer(Session* session)
 {
-    if (error_code == asio::error::operation_aborted)
-    {
-        LOG(LS_ERROR) << "Operation aborted";
-        return;
-    }
-
-    self->doIdleTimeoutImpl(error_code);
+    const Session::Clock::duration idle_time =
+        Session::Clock::now() - session->lastActivityTime();
+
+    // The timer expires when the session could become idle if no data is transferred. Reads do
+    // not restart the timer, the idle time is checked when it expires.
+    session->idleTimer()->start(
+        &timer_wheel_,
+        std::chrono::duration_cast<TimerWheel::Clock::duration>(idle_timeout_ - idle_time),
+        std::bind(&SessionManager::onIdleTimeout, this, session));
 }
 
 //--------------------------------------------------------------------------------------------------
-void SessionManager::doIdleTimeoutImpl(const std::error_code& error_code)
+void SessionManager::onIdleTimeout(Session* session)
 {
-    if (!error_code)
-    {
-        auto current_time = Session::Clock::now();
-        auto it = active_sessions_.begin();
-        int count = 0;
-
-        while (it != active_sessions_.end())
-        {
-            if ((*it)->idleTime(current_time) >= idle_timeout_)
-            {
-                it = active_sessions_.erase(it);
-                ++count;
-            }
-            else
-            {
-                ++it;
-            }
-        }
-
-        LOG(LS_INFO) << "Sessions ended by timeout: " << count;
-    }
-    else
+    if (session->idleTime(Session::Clock::now()) < idle_timeout_)
     {
-        LOG(LS_ERROR) << "Error in idle timer: " << base::utf16FromLocal8Bit(error_code.message());
+        // There was activity since the timer was started.
+        startIdleTimer(session);
+        return;
     }
 
-    idle_timer_.expires_after(kIdleTimerInterval);
-    idle_timer_.async_wait(std::bind(&SessionManager::doIdleTimeout, this, std::placeholders::_1));
+    LOG(LS_INFO) << "Session " << session->sessionId() << " ended by idle timeout";
+
+    // The session notifies us and is removed from the list.
+    session->disconnect();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -409,6 +458,81 @@ void SessionManager::collectAndSendStatistics()
         delegate_->onSessionStatistics(relay_stat);
 }
 
+//--------------------------------------------------------------------------------------------------
+bool SessionManager::pairSession(
+    PendingSession* session, uint32_t key_id, const base::ByteArray& secret)
+{
+    for (auto& other_session : pending_sessions_)
+    {
+        if (session->isPeerFor(*other_session))
+        {
+            LOG(LS_INFO) << "Both peers are connected with key " << key_id;
+
+            // Delete the key from the pool. It can no longer be used.
+            shared_pool_->removeKey(key_id);
+
+            // Now the opposite peer is found, start the data transfer between them.
+            active_sessions_.emplace_back(std::make_unique<Session>(
+                std::make_pair(session->takeSocket(), other_session->takeSocket()), secret,
+                buffer_pool_));
+            active_sessions_.back()->start(this);
+            startIdleTimer(active_sessions_.back().get());
+
+            if (delegate_)
+                delegate_->onSessionStarted();
+
+            // Pending sessions are no longer needed, remove them.
+            removePendingSession(other_session.get());
+            removePendingSession(session);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+void SessionManager::handOffSession(
+    PendingSession* session, uint32_t key_id, const base::ByteArray& secret)
+{
+    const size_t worker_index = key_id % worker_count_;
+
+    asio::ip::tcp::socket socket = session->takeSocket();
+    removePendingSession(session);
+
+    std::error_code error_code;
+    asio::ip::tcp::endpoint endpoint = socket.local_endpoint(error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to get local endpoint: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return;
+    }
+
+    // The socket is detached from the I/O context of the current thread. Not supported on
+    // Windows versions prior to Windows 8.1.
+    HandOff hand_off;
+    hand_off.protocol = endpoint.protocol();
+    hand_off.socket = socket.release(error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to release socket: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return;
+    }
+
+    hand_off.key_id = key_id;
+    hand_off.secret = secret;
+
+    if (!delegate_)
+    {
+        closeNativeSocket(hand_off.socket);
+        return;
+    }
+
+    delegate_->onSessionHandOff(worker_index, hand_off);
+}
+
 //--------------------------------------------------------------------------------------------------
 void SessionManager::removePendingSession(PendingSession* session)
 {
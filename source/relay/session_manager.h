@@ -21,9 +21,11 @@
 
 #include "proto/relay_peer.pb.h"
 #include "proto/router_relay.pb.h"
+#include "relay/buffer_pool.h"
 #include "relay/pending_session.h"
 #include "relay/session.h"
 #include "relay/shared_pool.h"
+#include "relay/timer_wheel.h"
 
 #include <asio/high_resolution_timer.hpp>
 
@@ -38,6 +40,16 @@ class SessionManager final
       public Session::Delegate
 {
 public:
+    // An authenticated peer connection moved between session managers running on different
+    // threads.
+    struct HandOff
+    {
+        asio::ip::tcp protocol = asio::ip::tcp::v6();
+        asio::ip::tcp::socket::native_handle_type socket {};
+        uint32_t key_id = 0;
+        base::ByteArray secret;
+    };
+
     class Delegate
     {
     public:
@@ -46,18 +58,30 @@ public:
         virtual void onSessionStarted() = 0;
         virtual void onSessionStatistics(const proto::RelayStat& relay_stat) = 0;
         virtual void onSessionFinished() = 0;
+
+        // Called when an authenticated peer must be paired by the session manager with index
+        // |worker_index|. The delegate must pass |hand_off| to SessionManager::acceptHandOff() on
+        // the thread of that session manager.
+        virtual void onSessionHandOff(size_t worker_index, const HandOff& hand_off) = 0;
     };
 
+    // Several session managers can share the same port. Both peers with the same key are always
+    // paired by the manager with index |key_id % worker_count|; a peer accepted by any other
+    // manager is handed off to it.
     SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
                    const asio::ip::address& address,
                    uint16_t port,
                    const std::chrono::minutes& idle_timeout,
                    bool statistics_enabled,
-                   const std::chrono::seconds& statistics_interval);
+                   const std::chrono::seconds& statistics_interval,
+                   std::shared_ptr<BufferPool> buffer_pool,
+                   size_t worker_index,
+                   size_t worker_count);
     ~SessionManager() final;
 
     void start(std::unique_ptr<SharedPool> shared_pool, Delegate* delegate);
-    void disconnectSession(uint64_t session_id);
+    bool disconnectSession(uint64_t session_id);
+    void acceptHandOff(const HandOff& hand_off);
 
 protected:
     // PendingSession::Delegate implementation.
@@ -69,27 +93,35 @@ protected:
     void onSessionFinished(Session* session) final;
 
 private:
+    bool listen();
     static void doAccept(SessionManager* self);
-    static void doIdleTimeout(SessionManager* self, const std::error_code& error_code);
-    void doIdleTimeoutImpl(const std::error_code& error_code);
+    void startIdleTimer(Session* session);
+    void onIdleTimeout(Session* session);
     static void doStatTimeout(SessionManager* self, const std::error_code& error_code);
     void doStatTimeoutImpl(const std::error_code& error_code);
     void collectAndSendStatistics();
+    bool pairSession(PendingSession* session, uint32_t key_id, const base::ByteArray& secret);
+    void handOffSession(PendingSession* session, uint32_t key_id, const base::ByteArray& secret);
 
     void removePendingSession(PendingSession* sessions);
     void removeSession(Session* session);
 
     std::shared_ptr<base::TaskRunner> task_runner_;
 
+    // Idle timeouts of active sessions and handshake timeouts of pending sessions.
+    TimerWheel timer_wheel_;
+
     asio::ip::tcp::acceptor acceptor_;
     std::vector<std::unique_ptr<PendingSession>> pending_sessions_;
     std::vector<std::unique_ptr<Session>> active_sessions_;
+    std::shared_ptr<BufferPool> buffer_pool_;
 
     const asio::ip::address address_;
     const uint16_t port_;
+    const size_t worker_index_;
+    const size_t worker_count_;
 
     const std::chrono::minutes idle_timeout_;
-    asio::high_resolution_timer idle_timer_;
 
     asio::high_resolution_timer stat_timer_;
 
@@ -19,70 +19,206 @@
 #include "relay/sessions_worker.h"
 
 #include "base/logging.h"
+#include "base/task_runner.h"
 #include "base/strings/unicode.h"
 
 namespace relay {
 
+class SessionsWorker::Worker final
+    : public base::Thread::Delegate,
+      public SessionManager::Delegate
+{
+public:
+    Worker(SessionsWorker* owner, size_t index, std::unique_ptr<SharedPool> shared_pool);
+    ~Worker() final;
+
+    void start();
+    void stop();
+
+    void startSessionManager(const asio::ip::address& listen_address);
+    void disconnectSession(uint64_t session_id);
+    void acceptHandOff(const SessionManager::HandOff& hand_off);
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onAfterThreadRunning() final;
+
+    // SessionManager::Delegate implementation.
+    void onSessionStarted() final;
+    void onSessionStatistics(const proto::RelayStat& relay_stat) final;
+    void onSessionFinished() final;
+    void onSessionHandOff(size_t worker_index, const SessionManager::HandOff& hand_off) final;
+
+private:
+    SessionsWorker* owner_;
+    const size_t index_;
+
+    std::unique_ptr<SharedPool> shared_pool_;
+
+    std::unique_ptr<base::Thread> thread_;
+    std::shared_ptr<base::TaskRunner> self_task_runner_;
+    std::unique_ptr<SessionManager> session_manager_;
+
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
 //--------------------------------------------------------------------------------------------------
-SessionsWorker::SessionsWorker(std::u16string_view listen_interface,
-                               uint16_t peer_port,
-                               const std::chrono::minutes& peer_idle_timeout,
-                               bool statistics_enabled,
-                               const std::chrono::seconds& statistics_interval,
-                               std::unique_ptr<SharedPool> shared_pool)
-    : listen_interface_(listen_interface),
-      peer_port_(peer_port),
-      peer_idle_timeout_(peer_idle_timeout),
-      statistics_enabled_(statistics_enabled),
-      statistics_interval_(statistics_interval),
+SessionsWorker::Worker::Worker(
+    SessionsWorker* owner, size_t index, std::unique_ptr<SharedPool> shared_pool)
+    : owner_(owner),
+      index_(index),
       shared_pool_(std::move(shared_pool)),
       thread_(std::make_unique<base::Thread>())
 {
-    LOG(LS_INFO) << "Ctor";
-    DCHECK(peer_port_ && shared_pool_);
+    DCHECK(owner_ && shared_pool_);
 }
 
 //--------------------------------------------------------------------------------------------------
-SessionsWorker::~SessionsWorker()
+SessionsWorker::Worker::~Worker()
+{
+    stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+void SessionsWorker::Worker::start()
+{
+    thread_->start(base::MessageLoop::Type::ASIO, this);
+
+    self_task_runner_ = thread_->taskRunner();
+    DCHECK(self_task_runner_);
+}
+
+//--------------------------------------------------------------------------------------------------
+void SessionsWorker::Worker::stop()
 {
-    LOG(LS_INFO) << "Dtor";
     thread_->stop();
 }
 
 //--------------------------------------------------------------------------------------------------
-void SessionsWorker::start(std::shared_ptr<base::TaskRunner> caller_task_runner,
-                           SessionManager::Delegate* delegate)
+void SessionsWorker::Worker::startSessionManager(const asio::ip::address& listen_address)
 {
-    LOG(LS_INFO) << "Starting session worker";
+    if (!self_task_runner_->belongsToCurrentThread())
+    {
+        self_task_runner_->postTask(
+            std::bind(&Worker::startSessionManager, this, listen_address));
+        return;
+    }
 
-    caller_task_runner_ = std::move(caller_task_runner);
-    delegate_ = delegate;
+    session_manager_ = std::make_unique<SessionManager>(
+        self_task_runner_, listen_address, owner_->peer_port_, owner_->peer_idle_timeout_,
+        owner_->statistics_enabled_, owner_->statistics_interval_, owner_->buffer_pool_, index_,
+        owner_->workers_.size());
+    session_manager_->start(std::move(shared_pool_), this);
+}
 
-    DCHECK(caller_task_runner_);
-    DCHECK(delegate_);
+//--------------------------------------------------------------------------------------------------
+void SessionsWorker::Worker::disconnectSession(uint64_t session_id)
+{
+    if (!self_task_runner_->belongsToCurrentThread())
+    {
+        self_task_runner_->postTask(std::bind(&Worker::disconnectSession, this, session_id));
+        return;
+    }
 
-    thread_->start(base::MessageLoop::Type::ASIO, this);
+    if (session_manager_ && session_manager_->disconnectSession(session_id))
+        LOG(LS_INFO) << "Session with id " << session_id << " disconnected (worker " << index_ << ")";
 }
 
 //--------------------------------------------------------------------------------------------------
-void SessionsWorker::disconnectSession(uint64_t session_id)
+void SessionsWorker::Worker::acceptHandOff(const SessionManager::HandOff& hand_off)
 {
     if (!self_task_runner_->belongsToCurrentThread())
     {
-        self_task_runner_->postTask(std::bind(&SessionsWorker::disconnectSession, this, session_id));
+        self_task_runner_->postTask(std::bind(&Worker::acceptHandOff, this, hand_off));
         return;
     }
 
-    session_manager_->disconnectSession(session_id);
+    if (session_manager_)
+        session_manager_->acceptHandOff(hand_off);
+}
+
+//--------------------------------------------------------------------------------------------------
+void SessionsWorker::Worker::onAfterThreadRunning()
+{
+    LOG(LS_INFO) << "After thread running (worker " << index_ << ")";
+    session_manager_.reset();
 }
 
 //--------------------------------------------------------------------------------------------------
-void SessionsWorker::onBeforeThreadRunning()
+void SessionsWorker::Worker::onSessionStarted()
 {
-    LOG(LS_INFO) << "Before thread running";
+    owner_->onSessionStarted();
+}
 
-    self_task_runner_ = thread_->taskRunner();
-    DCHECK(self_task_runner_);
+//--------------------------------------------------------------------------------------------------
+void SessionsWorker::Worker::onSessionStatistics(const proto::RelayStat& relay_stat)
+{
+    owner_->onSessionStatistics(index_, relay_stat);
+}
+
+//--------------------------------------------------------------------------------------------------
+void SessionsWorker::Worker::onSessionFinished()
+{
+    owner_->onSessionFinished();
+}
+
+//--------------------------------------------------------------------------------------------------
+void SessionsWorker::Worker::onSessionHandOff(
+    size_t worker_index, const SessionManager::HandOff& hand_off)
+{
+    owner_->onSessionHandOff(worker_index, hand_off);
+}
+
+//--------------------------------------------------------------------------------------------------
+SessionsWorker::SessionsWorker(std::u16string_view listen_interface,
+                               uint16_t peer_port,
+                               const std::chrono::minutes& peer_idle_timeout,
+                               bool statistics_enabled,
+                               const std::chrono::seconds& statistics_interval,
+                               std::shared_ptr<BufferPool> buffer_pool,
+                               size_t worker_count,
+                               std::unique_ptr<SharedPool> shared_pool)
+    : listen_interface_(listen_interface),
+      peer_port_(peer_port),
+      peer_idle_timeout_(peer_idle_timeout),
+      statistics_enabled_(statistics_enabled),
+      statistics_interval_(statistics_interval),
+      buffer_pool_(std::move(buffer_pool)),
+      shared_pool_(std::move(shared_pool))
+{
+    LOG(LS_INFO) << "Ctor";
+    DCHECK(peer_port_ && buffer_pool_ && shared_pool_);
+    DCHECK_GT(worker_count, 0u);
+
+    for (size_t i = 0; i < worker_count; ++i)
+        workers_.emplace_back(std::make_unique<Worker>(this, i, shared_pool_->share()));
+
+    worker_stats_.resize(worker_count);
+}
+
+//--------------------------------------------------------------------------------------------------
+SessionsWorker::~SessionsWorker()
+{
+    LOG(LS_INFO) << "Dtor";
+
+    // Workers can hand off peers to each other. All threads must be stopped before any worker is
+    // destroyed.
+    for (const auto& worker : workers_)
+        worker->stop();
+
+    workers_.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+void SessionsWorker::start(std::shared_ptr<base::TaskRunner> caller_task_runner, Delegate* delegate)
+{
+    LOG(LS_INFO) << "Starting session worker (threads: " << workers_.size() << ")";
+
+    caller_task_runner_ = std::move(caller_task_runner);
+    delegate_ = delegate;
+
+    DCHECK(caller_task_runner_);
+    DCHECK(delegate_);
 
     asio::ip::address listen_address;
 
@@ -106,17 +242,23 @@ void SessionsWorker::onBeforeThreadRunning()
     LOG(LS_INFO) << "Listen interface: "
                  << (listen_interface_.empty() ? u"ANY" : listen_interface_) << ":" << peer_port_;
 
-    session_manager_ = std::make_unique<SessionManager>(
-        self_task_runner_, listen_address, peer_port_, peer_idle_timeout_, statistics_enabled_,
-        statistics_interval_);
-    session_manager_->start(std::move(shared_pool_), this);
+    // All threads are started before any session manager so that the peers can be handed off to
+    // any worker as soon as the first connection is accepted.
+    for (const auto& worker : workers_)
+        worker->start();
+
+    for (const auto& worker : workers_)
+        worker->startSessionManager(listen_address);
 }
 
 //--------------------------------------------------------------------------------------------------
-void SessionsWorker::onAfterThreadRunning()
+void SessionsWorker::disconnectSession(uint64_t session_id)
 {
-    LOG(LS_INFO) << "After thread running";
-    session_manager_.reset();
+    LOG(LS_INFO) << "Disconnect session by session id: " << session_id;
+
+    // The session can belong to any worker.
+    for (const auto& worker : workers_)
+        worker->disconnectSession(session_id);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -133,17 +275,35 @@ void SessionsWorker::onSessionStarted()
 }
 
 //--------------------------------------------------------------------------------------------------
-void SessionsWorker::onSessionStatistics(const proto::RelayStat& relay_stat)
+void SessionsWorker::onSessionStatistics(size_t worker_index, const proto::RelayStat& relay_stat)
 {
     if (!caller_task_runner_->belongsToCurrentThread())
     {
         caller_task_runner_->postTask(
-            std::bind(&SessionsWorker::onSessionStatistics, this, relay_stat));
+            std::bind(&SessionsWorker::onSessionStatistics, this, worker_index, relay_stat));
         return;
     }
 
+    worker_stats_[worker_index] = relay_stat;
+
+    // The statistics are sent when every worker has reported since the previous message.
+    for (const auto& worker_stat : worker_stats_)
+    {
+        if (!worker_stat.has_value())
+            return;
+    }
+
+    proto::RelayStat total_stat;
+
+    for (auto& worker_stat : worker_stats_)
+    {
+        total_stat.set_uptime(std::max(total_stat.uptime(), worker_stat->uptime()));
+        total_stat.mutable_peer_connection()->MergeFrom(worker_stat->peer_connection());
+        worker_stat.reset();
+    }
+
     if (delegate_)
-        delegate_->onSessionStatistics(relay_stat);
+        delegate_->onSessionStatistics(total_stat);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -159,4 +319,12 @@ void SessionsWorker::onSessionFinished()
         delegate_->onSessionFinished();
 }
 
+//--------------------------------------------------------------------------------------------------
+void SessionsWorker::onSessionHandOff(
+    size_t worker_index, const SessionManager::HandOff& hand_off)
+{
+    DCHECK_LT(worker_index, workers_.size());
+    workers_[worker_index]->acceptHandOff(hand_off);
+}
+
 } // namespace relay
@@ -22,51 +22,64 @@
 #include "base/threading/thread.h"
 #include "relay/session_manager.h"
 
+#include <optional>
+
 namespace relay {
 
 class SharedPool;
 
+// Runs one or more threads, each of them with its own SessionManager. All notifications are
+// delivered to the delegate on the thread that called start().
 class SessionsWorker final
-    : public base::Thread::Delegate,
-      public SessionManager::Delegate
 {
 public:
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        virtual void onSessionStarted() = 0;
+
+        // Statistics of all workers are merged into a single message.
+        virtual void onSessionStatistics(const proto::RelayStat& relay_stat) = 0;
+
+        virtual void onSessionFinished() = 0;
+    };
+
     SessionsWorker(std::u16string_view listen_interface,
                    uint16_t peer_port,
                    const std::chrono::minutes& peer_idle_timeout,
                    bool statistics_enabled,
                    const std::chrono::seconds& statistics_interval,
+                   std::shared_ptr<BufferPool> buffer_pool,
+                   size_t worker_count,
                    std::unique_ptr<SharedPool> shared_pool);
-    ~SessionsWorker() final;
+    ~SessionsWorker();
 
-    void start(std::shared_ptr<base::TaskRunner> caller_task_runner,
-               SessionManager::Delegate* delegate);
+    void start(std::shared_ptr<base::TaskRunner> caller_task_runner, Delegate* delegate);
     void disconnectSession(uint64_t session_id);
 
-protected:
-    // base::Thread::Delegate implementation.
-    void onBeforeThreadRunning() final;
-    void onAfterThreadRunning() final;
+private:
+    class Worker;
 
-    // SessionManager::Delegate implementation.
-    void onSessionStarted() final;
-    void onSessionStatistics(const proto::RelayStat& relay_stat) final;
-    void onSessionFinished() final;
+    void onSessionStarted();
+    void onSessionStatistics(size_t worker_index, const proto::RelayStat& relay_stat);
+    void onSessionFinished();
+    void onSessionHandOff(size_t worker_index, const SessionManager::HandOff& hand_off);
 
-private:
     const std::u16string listen_interface_;
     const uint16_t peer_port_;
     const std::chrono::minutes peer_idle_timeout_;
     const bool statistics_enabled_;
     const std::chrono::seconds statistics_interval_;
 
+    std::shared_ptr<BufferPool> buffer_pool_;
     std::unique_ptr<SharedPool> shared_pool_;
 
-    std::unique_ptr<base::Thread> thread_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::optional<proto::RelayStat>> worker_stats_;
     std::shared_ptr<base::TaskRunner> caller_task_runner_;
-    std::shared_ptr<base::TaskRunner> self_task_runner_;
-    std::unique_ptr<SessionManager> session_manager_;
-    SessionManager::Delegate* delegate_ = nullptr;
+    Delegate* delegate_ = nullptr;
 
     DISALLOW_COPY_AND_ASSIGN(SessionsWorker);
 };
@@ -60,6 +60,10 @@ void Settings::reset()
     setMaxPeerCount(100);
     setStatisticsEnabled(false);
     setStatisticsInterval(std::chrono::seconds(5));
+    setWorkerThreads(1);
+    setMinBufferSize(4 * 1024);
+    setMaxBufferSize(256 * 1024);
+    setBufferMemoryLimit(256);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -188,4 +192,52 @@ std::chrono::seconds Settings::statisticsInterval() const
     return std::chrono::seconds(impl_.get<int>("StatisticsInterval", 5));
 }
 
+//--------------------------------------------------------------------------------------------------
+void Settings::setMinBufferSize(uint32_t size)
+{
+    impl_.set<uint32_t>("MinBufferSize", size);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint32_t Settings::minBufferSize() const
+{
+    return impl_.get<uint32_t>("MinBufferSize", 4 * 1024);
+}
+
+//--------------------------------------------------------------------------------------------------
+void Settings::setMaxBufferSize(uint32_t size)
+{
+    impl_.set<uint32_t>("MaxBufferSize", size);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint32_t Settings::maxBufferSize() const
+{
+    return impl_.get<uint32_t>("MaxBufferSize", 256 * 1024);
+}
+
+//--------------------------------------------------------------------------------------------------
+void Settings::setBufferMemoryLimit(uint32_t megabytes)
+{
+    impl_.set<uint32_t>("BufferMemoryLimit", megabytes);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint32_t Settings::bufferMemoryLimit() const
+{
+    return impl_.get<uint32_t>("BufferMemoryLimit", 256);
+}
+
+//--------------------------------------------------------------------------------------------------
+void Settings::setWorkerThreads(uint32_t count)
+{
+    impl_.set<uint32_t>("WorkerThreads", count);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint32_t Settings::workerThreads() const
+{
+    return impl_.get<uint32_t>("WorkerThreads", 1);
+}
+
 } // namespace relay
@@ -66,6 +66,23 @@ public:
     void setStatisticsInterval(const std::chrono::seconds& interval);
     std::chrono::seconds statisticsInterval() const;
 
+    // Size limits of the buffers used to forward data between peers (in bytes). The buffer of a
+    // session grows from the minimum to the maximum size while the session is saturating it.
+    void setMinBufferSize(uint32_t size);
+    uint32_t minBufferSize() const;
+
+    void setMaxBufferSize(uint32_t size);
+    uint32_t maxBufferSize() const;
+
+    // Maximum amount of memory for buffers larger than the minimum size (in megabytes).
+    void setBufferMemoryLimit(uint32_t megabytes);
+    uint32_t bufferMemoryLimit() const;
+
+    // Number of threads that accept and relay peer connections. Zero means one thread per
+    // processor thread.
+    void setWorkerThreads(uint32_t count);
+    uint32_t workerThreads() const;
+
 private:
     base::JsonSettings impl_;
 };
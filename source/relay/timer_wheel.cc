@@ -0,0 +1,204 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/timer_wheel.h"
+
+#include "base/logging.h"
+
+namespace relay {
+
+//--------------------------------------------------------------------------------------------------
+TimerWheel::Timer::~Timer()
+{
+    stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimerWheel::Timer::start(TimerWheel* wheel, const Clock::duration& delay, Callback callback)
+{
+    DCHECK(wheel);
+    DCHECK(callback);
+
+    stop();
+
+    wheel_ = wheel;
+    callback_ = std::move(callback);
+    wheel_->add(this, delay);
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimerWheel::Timer::stop()
+{
+    if (!wheel_)
+        return;
+
+    wheel_->remove(this);
+    wheel_ = nullptr;
+    callback_ = nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+TimerWheel::TimerWheel(
+    asio::io_context& io_context, const Clock::duration& resolution, size_t slot_count)
+    : tick_timer_(io_context),
+      resolution_(resolution),
+      slots_(slot_count)
+{
+    DCHECK_GT(resolution_.count(), 0);
+    DCHECK_GT(slot_count, 0u);
+}
+
+//--------------------------------------------------------------------------------------------------
+TimerWheel::~TimerWheel()
+{
+    tick_timer_.cancel();
+
+    // Detach the remaining timers so that they do not refer to the wheel.
+    auto detach = [](std::list<Timer*>& list)
+    {
+        for (Timer* timer : list)
+        {
+            timer->wheel_ = nullptr;
+            timer->list_ = nullptr;
+            timer->callback_ = nullptr;
+        }
+        list.clear();
+    };
+
+    for (auto& slot : slots_)
+        detach(slot);
+
+    detach(expired_);
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimerWheel::add(Timer* timer, const Clock::duration& delay)
+{
+    if (!tick_scheduled_)
+    {
+        next_tick_time_ = Clock::now() + resolution_;
+        scheduleTick();
+    }
+
+    // The number of ticks is counted from the previous tick. Rounding up guarantees that the timer
+    // does not expire before the deadline.
+    const TimePoint last_tick_time = next_tick_time_ - resolution_;
+    const Clock::duration interval = std::max(
+        Clock::now() + delay - last_tick_time, Clock::duration(1));
+    const size_t ticks =
+        static_cast<size_t>((interval + resolution_ - Clock::duration(1)) / resolution_);
+
+    const size_t slot = (current_slot_ + ticks) % slots_.size();
+
+    timer->rounds_ = (ticks - 1) / slots_.size();
+    timer->list_ = &slots_[slot];
+    timer->it_ = timer->list_->insert(timer->list_->end(), timer);
+
+    ++timer_count_;
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimerWheel::remove(Timer* timer)
+{
+    DCHECK(timer->list_);
+
+    timer->list_->erase(timer->it_);
+    timer->list_ = nullptr;
+
+    --timer_count_;
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimerWheel::scheduleTick()
+{
+    tick_scheduled_ = true;
+
+    tick_timer_.expires_at(next_tick_time_);
+    tick_timer_.async_wait(std::bind(&TimerWheel::doTick, this, std::placeholders::_1));
+}
+
+//--------------------------------------------------------------------------------------------------
+// static
+void TimerWheel::doTick(TimerWheel* self, const std::error_code& error_code)
+{
+    if (error_code == asio::error::operation_aborted)
+        return;
+
+    self->onTick();
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimerWheel::onTick()
+{
+    tick_scheduled_ = false;
+
+    // If the thread was busy, several ticks may have been missed.
+    const TimePoint now = Clock::now();
+    while (next_tick_time_ <= now)
+    {
+        current_slot_ = (current_slot_ + 1) % slots_.size();
+        next_tick_time_ += resolution_;
+
+        processSlot(current_slot_);
+    }
+
+    while (!expired_.empty())
+    {
+        Timer* timer = expired_.front();
+        expired_.pop_front();
+
+        timer->wheel_ = nullptr;
+        timer->list_ = nullptr;
+        --timer_count_;
+
+        // The callback can start the timer again or destroy it.
+        Callback callback = std::move(timer->callback_);
+        timer->callback_ = nullptr;
+        callback();
+    }
+
+    if (timer_count_ && !tick_scheduled_)
+        scheduleTick();
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimerWheel::processSlot(size_t slot)
+{
+    std::list<Timer*>& list = slots_[slot];
+
+    auto it = list.begin();
+    while (it != list.end())
+    {
+        Timer* timer = *it;
+        auto next = std::next(it);
+
+        if (!timer->rounds_)
+        {
+            expired_.splice(expired_.end(), list, it);
+            timer->list_ = &expired_;
+        }
+        else
+        {
+            --timer->rounds_;
+        }
+
+        it = next;
+    }
+}
+
+} // namespace relay
@@ -0,0 +1,98 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2024 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY_TIMER_WHEEL_H
+#define RELAY_TIMER_WHEEL_H
+
+#include "base/macros_magic.h"
+
+#include <asio/steady_timer.hpp>
+
+#include <functional>
+#include <list>
+#include <vector>
+
+namespace relay {
+
+// Hashed timing wheel. Starting and stopping a timer takes constant time and each tick of the
+// wheel only handles the timers of one slot, regardless of the total number of timers. Timers
+// never expire before their deadline but may expire up to one resolution interval later. The wheel
+// is not thread-safe and must be used on the thread of |io_context|.
+class TimerWheel
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+    using Callback = std::function<void()>;
+
+    class Timer
+    {
+    public:
+        Timer() = default;
+        ~Timer();
+
+        // Starts the timer. If the timer is already active, it is restarted.
+        void start(TimerWheel* wheel, const Clock::duration& delay, Callback callback);
+
+        // Stops the timer. The callback will not be called.
+        void stop();
+
+        bool isActive() const { return wheel_ != nullptr; }
+
+    private:
+        friend class TimerWheel;
+
+        TimerWheel* wheel_ = nullptr;
+        std::list<Timer*>* list_ = nullptr;
+        std::list<Timer*>::iterator it_;
+        size_t rounds_ = 0;
+        Callback callback_;
+
+        DISALLOW_COPY_AND_ASSIGN(Timer);
+    };
+
+    TimerWheel(asio::io_context& io_context, const Clock::duration& resolution, size_t slot_count);
+    ~TimerWheel();
+
+    size_t timerCount() const { return timer_count_; }
+
+private:
+    void add(Timer* timer, const Clock::duration& delay);
+    void remove(Timer* timer);
+    void scheduleTick();
+    static void doTick(TimerWheel* self, const std::error_code& error_code);
+    void onTick();
+    void processSlot(size_t slot);
+
+    asio::steady_timer tick_timer_;
+    const Clock::duration resolution_;
+
+    std::vector<std::list<Timer*>> slots_;
+    std::list<Timer*> expired_;
+    size_t current_slot_ = 0;
+    size_t timer_count_ = 0;
+
+    bool tick_scheduled_ = false;
+    TimePoint next_tick_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+} // namespace relay
+
+#endif // RELAY_TIMER_WHEEL_H
@@ -198,62 +198,51 @@ bool Server::start()
 }
 
 //--------------------------------------------------------------------------------------------------
-std::unique_ptr<proto::SessionList> Server::sessionList() const
+std::unique_ptr<proto::SessionList> Server::sessionList(
+    const proto::SessionListRequest& request) const
 {
     std::unique_ptr<proto::SessionList> result = std::make_unique<proto::SessionList>();
 
-    for (const auto& session : sessions_)
+    const uint32_t session_types = request.session_types();
+    uint32_t total_count = 0;
+
+    auto add_entry = [&](const proto::Session& entry)
     {
+        if (session_types && !(session_types & static_cast<uint32_t>(entry.session_type())))
+            return;
+
+        ++total_count;
+
+        if (total_count <= request.offset())
+            return;
+
+        if (request.limit() && static_cast<uint32_t>(result->session_size()) >= request.limit())
+            return;
+
         proto::Session* item = result->add_session();
+        item->CopyFrom(entry);
 
-        item->set_session_id(session->sessionId());
-        item->set_session_type(session->sessionType());
-        item->set_timepoint(static_cast<uint64_t>(session->startTime()));
-        item->set_ip_address(session->address());
-        item->mutable_version()->CopyFrom(session->version().toProto());
-        item->set_os_name(session->osName());
-        item->set_computer_name(session->computerName());
-        item->set_architecture(session->architecture());
+        if (entry.session_type() == proto::ROUTER_SESSION_RELAY)
+            item->set_session_data(relaySessionData(entry.session_id()));
+    };
 
-        switch (session->sessionType())
+    if (request.host_id() != base::kInvalidHostId)
+    {
+        auto host = hosts_.find(request.host_id());
+        if (host != hosts_.end())
         {
-            case proto::ROUTER_SESSION_HOST:
-            {
-                proto::HostSessionData session_data;
-
-                for (const auto& host_id : static_cast<SessionHost*>(session.get())->hostIdList())
-                    session_data.add_host_id(host_id);
-
-                item->set_session_data(session_data.SerializeAsString());
-            }
-            break;
-
-            case proto::ROUTER_SESSION_RELAY:
-            {
-                proto::RelaySessionData session_data;
-                session_data.set_pool_size(relay_key_pool_->countForRelay(session->sessionId()));
-
-                const std::optional<proto::RelayStat>& in_relay_stat =
-                    static_cast<SessionRelay*>(session.get())->relayStat();
-                if (in_relay_stat.has_value())
-                {
-                    proto::RelaySessionData::RelayStat* out_relay_stat =
-                        session_data.mutable_relay_stat();
-
-                    out_relay_stat->set_uptime(in_relay_stat->uptime());
-                    out_relay_stat->mutable_peer_connection()->CopyFrom(
-                        in_relay_stat->peer_connection());
-                }
-
-                item->set_session_data(session_data.SerializeAsString());
-            }
-            break;
-
-            default:
-                break;
+            auto entry = session_entries_.find(host->second->sessionId());
+            if (entry != session_entries_.end())
+                add_entry(entry->second);
         }
     }
+    else
+    {
+        for (const auto& entry : session_entries_)
+            add_entry(entry.second);
+    }
 
+    result->set_total_count(total_count);
     result->set_error_code(proto::SessionList::SUCCESS);
     return result;
 }
@@ -261,72 +250,51 @@ std::unique_ptr<proto::SessionList> Server::sessionList() const
 //--------------------------------------------------------------------------------------------------
 bool Server::stopSession(Session::SessionId session_id)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+    return takeSession(session_id) != nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Server::onHostSessionWithId(SessionHost* session, base::HostId host_id)
+{
+    auto result = hosts_.find(host_id);
+    if (result != hosts_.end() && result->second != session)
     {
-        if (it->get()->sessionId() == session_id)
-        {
-            sessions_.erase(it);
-            return true;
-        }
+        LOG(LS_INFO) << "Detected previous connection with ID " << host_id;
+        takeSession(result->second->sessionId());
     }
 
-    return false;
+    hosts_[host_id] = session;
+    updateHostSessionEntry(*session);
 }
 
 //--------------------------------------------------------------------------------------------------
-void Server::onHostSessionWithId(SessionHost* session)
+void Server::onHostSessionIdRemoved(SessionHost* session, base::HostId host_id)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end();)
-    {
-        if (it->get()->sessionType() == proto::ROUTER_SESSION_HOST)
-        {
-            SessionHost* other_session = reinterpret_cast<SessionHost*>(it->get());
-            if (other_session != session)
-            {
-                for (const auto& host_id : session->hostIdList())
-                {
-                    if (other_session->hasHostId(host_id))
-                    {
-                        LOG(LS_INFO) << "Detected previous connection with ID " << host_id;
-
-                        it = sessions_.erase(it);
-                        continue;
-                    }
-                }
-            }
-        }
+    auto result = hosts_.find(host_id);
+    if (result != hosts_.end() && result->second == session)
+        hosts_.erase(result);
 
-        ++it;
-    }
+    updateHostSessionEntry(*session);
 }
 
 //--------------------------------------------------------------------------------------------------
 SessionHost* Server::hostSessionById(base::HostId host_id)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
-    {
-        Session* entry = it->get();
-
-        if (entry->sessionType() == proto::ROUTER_SESSION_HOST &&
-            static_cast<SessionHost*>(entry)->hasHostId(host_id))
-        {
-            return static_cast<SessionHost*>(entry);
-        }
-    }
+    auto result = hosts_.find(host_id);
+    if (result == hosts_.end())
+        return nullptr;
 
-    return nullptr;
+    return result->second;
 }
 
 //--------------------------------------------------------------------------------------------------
 Session* Server::sessionById(Session::SessionId session_id)
 {
-    for (auto& session : sessions_)
-    {
-        if (session->sessionId() == session_id)
-            return session.get();
-    }
+    auto result = sessions_.find(session_id);
+    if (result == sessions_.end())
+        return nullptr;
 
-    return nullptr;
+    return result->second.get();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -346,12 +314,11 @@ void Server::onNewConnection(std::unique_ptr<base::TcpChannel> channel)
 //--------------------------------------------------------------------------------------------------
 void Server::onPoolKeyUsed(Session::SessionId session_id, uint32_t key_id)
 {
-    for (const auto& session : sessions_)
-    {
-        SessionRelay* relay_session = static_cast<SessionRelay*>(session.get());
-        if (relay_session->sessionId() == session_id)
-            relay_session->sendKeyUsed(key_id);
-    }
+    Session* session = sessionById(session_id);
+    if (!session || session->sessionType() != proto::ROUTER_SESSION_RELAY)
+        return;
+
+    static_cast<SessionRelay*>(session)->sendKeyUsed(key_id);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -433,25 +400,101 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
     session->setArchitecture(session_info.architecture);
     session->setUserName(session_info.user_name);
 
-    sessions_.emplace_back(std::move(session));
-    sessions_.back()->start(this);
+    Session* session_ptr = session.get();
+    Session::SessionId session_id = session->sessionId();
+
+    sessions_.emplace(session_id, std::move(session));
+    session_ptr->start(this);
+
+    // The start time and address of the session are known after it is started.
+    if (sessions_.find(session_id) != sessions_.end())
+        addSessionEntry(*session_ptr);
 }
 
 //--------------------------------------------------------------------------------------------------
 void Server::onSessionFinished(Session::SessionId session_id, proto::RouterSession /* session_type */)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+    std::unique_ptr<Session> session = takeSession(session_id);
+    if (!session)
+        return;
+
+    // Session will be destroyed after completion of the current call.
+    task_runner_->deleteSoon(std::move(session));
+}
+
+//--------------------------------------------------------------------------------------------------
+std::unique_ptr<Session> Server::takeSession(Session::SessionId session_id)
+{
+    auto result = sessions_.find(session_id);
+    if (result == sessions_.end())
+        return nullptr;
+
+    std::unique_ptr<Session> session = std::move(result->second);
+    sessions_.erase(result);
+    session_entries_.erase(session_id);
+
+    if (session->sessionType() == proto::ROUTER_SESSION_HOST)
+    {
+        SessionHost* host_session = static_cast<SessionHost*>(session.get());
+
+        for (const auto& host_id : host_session->hostIdList())
+            onHostSessionIdRemoved(host_session, host_id);
+    }
+
+    return session;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Server::addSessionEntry(const Session& session)
+{
+    proto::Session& entry = session_entries_[session.sessionId()];
+
+    entry.set_session_id(session.sessionId());
+    entry.set_session_type(session.sessionType());
+    entry.set_timepoint(static_cast<uint64_t>(session.startTime()));
+    entry.set_ip_address(session.address());
+    entry.mutable_version()->CopyFrom(session.version().toProto());
+    entry.set_os_name(session.osName());
+    entry.set_computer_name(session.computerName());
+    entry.set_architecture(session.architecture());
+}
+
+//--------------------------------------------------------------------------------------------------
+void Server::updateHostSessionEntry(const SessionHost& session)
+{
+    auto entry = session_entries_.find(session.sessionId());
+    if (entry == session_entries_.end())
+        return;
+
+    proto::HostSessionData session_data;
+
+    for (const auto& host_id : session.hostIdList())
+        session_data.add_host_id(host_id);
+
+    entry->second.set_session_data(session_data.SerializeAsString());
+}
+
+//--------------------------------------------------------------------------------------------------
+std::string Server::relaySessionData(Session::SessionId session_id) const
+{
+    proto::RelaySessionData session_data;
+    session_data.set_pool_size(relay_key_pool_->countForRelay(session_id));
+
+    auto session = sessions_.find(session_id);
+    if (session != sessions_.end())
     {
-        if (it->get()->sessionId() == session_id)
+        const std::optional<proto::RelayStat>& in_relay_stat =
+            static_cast<const SessionRelay*>(session->second.get())->relayStat();
+        if (in_relay_stat.has_value())
         {
-            // Session will be destroyed after completion of the current call.
-            task_runner_->deleteSoon(std::move(*it));
+            proto::RelaySessionData::RelayStat* out_relay_stat = session_data.mutable_relay_stat();
 
-            // Delete a session from the list.
-            sessions_.erase(it);
-            break;
+            out_relay_stat->set_uptime(in_relay_stat->uptime());
+            out_relay_stat->mutable_peer_connection()->CopyFrom(in_relay_stat->peer_connection());
         }
     }
+
+    return session_data.SerializeAsString();
 }
 
 } // namespace router
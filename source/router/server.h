@@ -27,6 +27,9 @@
 #include "router/session.h"
 #include "router/shared_key_pool.h"
 
+#include <map>
+#include <unordered_map>
+
 namespace router {
 
 class DatabaseFactory;
@@ -45,9 +48,12 @@ public:
 
     bool start();
 
-    std::unique_ptr<proto::SessionList> sessionList() const;
+    std::unique_ptr<proto::SessionList> sessionList(const proto::SessionListRequest& request) const;
     bool stopSession(Session::SessionId session_id);
-    void onHostSessionWithId(SessionHost* session);
+
+    // Called when the host session has been assigned |host_id| or the ID has been removed from it.
+    void onHostSessionWithId(SessionHost* session, base::HostId host_id);
+    void onHostSessionIdRemoved(SessionHost* session, base::HostId host_id);
 
     SessionHost* hostSessionById(base::HostId host_id);
     Session* sessionById(Session::SessionId session_id);
@@ -67,12 +73,27 @@ protected:
                            proto::RouterSession session_type) final;
 
 private:
+    // Removes the session from the list and from the host index.
+    std::unique_ptr<Session> takeSession(Session::SessionId session_id);
+
+    void addSessionEntry(const Session& session);
+    void updateHostSessionEntry(const SessionHost& session);
+    std::string relaySessionData(Session::SessionId session_id) const;
+
     std::shared_ptr<base::TaskRunner> task_runner_;
     base::local_shared_ptr<DatabaseFactory> database_factory_;
     std::unique_ptr<base::TcpServer> server_;
     std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
     std::unique_ptr<SharedKeyPool> relay_key_pool_;
-    std::vector<std::unique_ptr<Session>> sessions_;
+    std::unordered_map<Session::SessionId, std::unique_ptr<Session>> sessions_;
+
+    // Host ID -> host session that has this ID.
+    std::unordered_map<base::HostId, SessionHost*> hosts_;
+
+    // Session list entries in the order of connection. An entry is updated only when the session
+    // changes, so the list is not rebuilt for each admin request. The data of relay sessions
+    // changes with every key and is filled in on request.
+    std::map<Session::SessionId, proto::Session> session_entries_;
 
     std::vector<std::u16string> client_white_list_;
     std::vector<std::u16string> host_white_list_;
@@ -138,11 +138,11 @@ void SessionAdmin::doUserRequest(const proto::UserRequest& request)
 }
 
 //--------------------------------------------------------------------------------------------------
-void SessionAdmin::doSessionListRequest(const proto::SessionListRequest& /* request */)
+void SessionAdmin::doSessionListRequest(const proto::SessionListRequest& request)
 {
     std::unique_ptr<proto::RouterToAdmin> message = std::make_unique<proto::RouterToAdmin>();
 
-    message->set_allocated_session_list(server().sessionList().release());
+    message->set_allocated_session_list(server().sessionList(request).release());
     if (!message->has_session_list())
         message->mutable_session_list()->set_error_code(proto::SessionList::UNKNOWN_ERROR);
 
@@ -154,7 +154,7 @@ void SessionHost::readHostIdRequest(const proto::HostIdRequest& host_id_request)
                     host_id_list_.emplace_back(host_id);
 
                     // Notify the server that the ID has been assigned.
-                    server().onHostSessionWithId(this);
+                    server().onHostSessionWithId(this, host_id);
                 }
             }
             else
@@ -199,6 +199,7 @@ void SessionHost::readResetHostId(const proto::ResetHostId& reset_host_id)
         {
             LOG(LS_INFO) << "Host ID " << host_id << " remove from list";
             host_id_list_.erase(it);
+            server().onHostSessionIdRemoved(this, host_id);
             return;
         }
     }
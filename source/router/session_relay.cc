@@ -79,6 +79,8 @@ void SessionRelay::onSessionMessageReceived(uint8_t /* channel_id */, const base
     else if (incoming_message_->has_relay_stat())
     {
         relay_stat_ = std::move(*incoming_message_->mutable_relay_stat());
+        relayKeyPool().setRelayLoad(
+            sessionId(), static_cast<uint32_t>(relay_stat_->peer_connection_size()));
     }
     else
     {
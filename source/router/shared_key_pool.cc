@@ -20,10 +20,19 @@
 
 #include "base/logging.h"
 
-#include <map>
+#include <unordered_map>
 
 namespace router {
 
+namespace {
+
+// Number of active peer connections at which the priority of a relay is halved.
+const uint64_t kLoadScale = 16;
+
+const size_t kInvalidHeapIndex = static_cast<size_t>(-1);
+
+} // namespace
+
 class SharedKeyPool::Impl
 {
 public:
@@ -35,6 +44,7 @@ public:
     void addKey(Session::SessionId session_id, const proto::RelayKey& key);
     std::optional<Credentials> takeCredentials();
     void removeKeysForRelay(Session::SessionId session_id);
+    void setRelayLoad(Session::SessionId session_id, uint32_t active_peers);
     void clear();
     size_t countForRelay(Session::SessionId session_id) const;
     size_t count() const;
@@ -43,7 +53,27 @@ public:
 private:
     using Keys = std::vector<proto::RelayKey>;
 
-    std::map<Session::SessionId, Keys> pool_;
+    struct Relay
+    {
+        Session::SessionId session_id = 0;
+        Keys keys;
+        uint32_t active_peers = 0;
+        size_t heap_index = kInvalidHeapIndex;
+    };
+
+    // Relays with keys are kept in a max-heap ordered by priority. Each relay stores its position
+    // in the heap so that it can be updated or removed in O(log R).
+    static uint64_t priority(const Relay& relay);
+    bool isHigher(size_t first, size_t second) const;
+    void swapHeapItems(size_t first, size_t second);
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+    void updateHeap(Relay* relay);
+    void removeFromHeap(Relay* relay);
+
+    std::unordered_map<Session::SessionId, Relay> relays_;
+    std::vector<Relay*> heap_;
+    size_t key_count_ = 0;
     Delegate* delegate_;
 
     DISALLOW_COPY_AND_ASSIGN(Impl);
@@ -65,65 +95,61 @@ void SharedKeyPool::Impl::dettach()
 //--------------------------------------------------------------------------------------------------
 void SharedKeyPool::Impl::addKey(Session::SessionId session_id, const proto::RelayKey& key)
 {
-    auto relay = pool_.find(session_id);
-    if (relay == pool_.end())
+    auto relay = relays_.find(session_id);
+    if (relay == relays_.end())
     {
         LOG(LS_INFO) << "Host not found in pool. It will be added";
-        relay = pool_.emplace(session_id, Keys()).first;
+        relay = relays_.emplace(session_id, Relay()).first;
+        relay->second.session_id = session_id;
     }
 
     LOG(LS_INFO) << "Added key with id " << key.key_id() << " for host '" << session_id << "'";
-    relay->second.emplace_back(key);
+    relay->second.keys.emplace_back(key);
+    ++key_count_;
+
+    if (relay->second.heap_index == kInvalidHeapIndex)
+    {
+        relay->second.heap_index = heap_.size();
+        heap_.emplace_back(&relay->second);
+    }
+
+    updateHeap(&relay->second);
 }
 
 //--------------------------------------------------------------------------------------------------
 std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials()
 {
-    if (pool_.empty())
+    if (heap_.empty())
     {
         LOG(LS_ERROR) << "Empty key pool";
         return std::nullopt;
     }
 
-    auto preffered_relay = pool_.end();
-    size_t max_count = 0;
-
-    for (auto it = pool_.begin(); it != pool_.end(); ++it)
-    {
-        size_t count = it->second.size();
-        if (count > max_count)
-        {
-            preffered_relay = it;
-            max_count = count;
-        }
-    }
-
-    if (preffered_relay == pool_.end())
-    {
-        LOG(LS_ERROR) << "Empty key pool";
-        return std::nullopt;
-    }
+    // The relay with the highest priority is always at the top of the heap.
+    Relay* preffered_relay = heap_.front();
 
-    LOG(LS_INFO) << "Preffered relay: " << preffered_relay->first;
+    LOG(LS_INFO) << "Preffered relay: " << preffered_relay->session_id;
 
-    std::vector<proto::RelayKey>& keys = preffered_relay->second;
-    if (keys.empty())
-    {
-        LOG(LS_ERROR) << "Empty key pool for relay";
-        return std::nullopt;
-    }
+    Keys& keys = preffered_relay->keys;
+    DCHECK(!keys.empty());
 
     Credentials credentials;
-    credentials.session_id = preffered_relay->first;
+    credentials.session_id = preffered_relay->session_id;
     credentials.key = std::move(keys.back());
 
     // Removing the key from the pool.
     keys.pop_back();
+    --key_count_;
 
     if (keys.empty())
     {
         LOG(LS_INFO) << "Last key in the pool for relay. The relay will be removed from the pool";
-        pool_.erase(preffered_relay->first);
+        removeFromHeap(preffered_relay);
+    }
+    else
+    {
+        // With fewer keys the relay moves down and the next client gets another relay.
+        siftDown(preffered_relay->heap_index);
     }
 
     if (delegate_)
@@ -136,41 +162,156 @@ std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials()
 void SharedKeyPool::Impl::removeKeysForRelay(Session::SessionId session_id)
 {
     LOG(LS_INFO) << "All keys for relay '" << session_id << "' removed";
-    pool_.erase(session_id);
+
+    auto relay = relays_.find(session_id);
+    if (relay == relays_.end())
+        return;
+
+    key_count_ -= relay->second.keys.size();
+    removeFromHeap(&relay->second);
+    relays_.erase(relay);
+}
+
+//--------------------------------------------------------------------------------------------------
+void SharedKeyPool::Impl::setRelayLoad(Session::SessionId session_id, uint32_t active_peers)
+{
+    auto relay = relays_.find(session_id);
+    if (relay == relays_.end())
+    {
+        relay = relays_.emplace(session_id, Relay()).first;
+        relay->second.session_id = session_id;
+    }
+
+    relay->second.active_peers = active_peers;
+    updateHeap(&relay->second);
 }
 
 //--------------------------------------------------------------------------------------------------
 void SharedKeyPool::Impl::clear()
 {
     LOG(LS_INFO) << "Key pool cleared";
-    pool_.clear();
+    relays_.clear();
+    heap_.clear();
+    key_count_ = 0;
 }
 
 //--------------------------------------------------------------------------------------------------
 size_t SharedKeyPool::Impl::countForRelay(Session::SessionId session_id) const
 {
-    auto result = pool_.find(session_id);
-    if (result == pool_.end())
+    auto result = relays_.find(session_id);
+    if (result == relays_.end())
         return 0;
 
-    return result->second.size();
+    return result->second.keys.size();
 }
 
 //--------------------------------------------------------------------------------------------------
 size_t SharedKeyPool::Impl::count() const
 {
-    size_t result = 0;
+    return key_count_;
+}
 
-    for (const auto& relay : pool_)
-        result += relay.second.size();
+//--------------------------------------------------------------------------------------------------
+bool SharedKeyPool::Impl::isEmpty() const
+{
+    return heap_.empty();
+}
 
-    return result;
+//--------------------------------------------------------------------------------------------------
+// static
+uint64_t SharedKeyPool::Impl::priority(const Relay& relay)
+{
+    // The number of keys reflects the free capacity of the relay. It is reduced for relays that
+    // already serve many peers.
+    return (static_cast<uint64_t>(relay.keys.size()) << 16) * kLoadScale /
+        (kLoadScale + relay.active_peers);
 }
 
 //--------------------------------------------------------------------------------------------------
-bool SharedKeyPool::Impl::isEmpty() const
+bool SharedKeyPool::Impl::isHigher(size_t first, size_t second) const
 {
-    return pool_.empty();
+    uint64_t first_priority = priority(*heap_[first]);
+    uint64_t second_priority = priority(*heap_[second]);
+
+    if (first_priority != second_priority)
+        return first_priority > second_priority;
+
+    // On equal priority, the relay that connected earlier wins.
+    return heap_[first]->session_id < heap_[second]->session_id;
+}
+
+//--------------------------------------------------------------------------------------------------
+void SharedKeyPool::Impl::swapHeapItems(size_t first, size_t second)
+{
+    std::swap(heap_[first], heap_[second]);
+
+    heap_[first]->heap_index = first;
+    heap_[second]->heap_index = second;
+}
+
+//--------------------------------------------------------------------------------------------------
+void SharedKeyPool::Impl::siftUp(size_t index)
+{
+    while (index > 0)
+    {
+        size_t parent = (index - 1) / 2;
+        if (!isHigher(index, parent))
+            break;
+
+        swapHeapItems(index, parent);
+        index = parent;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void SharedKeyPool::Impl::siftDown(size_t index)
+{
+    while (true)
+    {
+        size_t left = index * 2 + 1;
+        size_t right = left + 1;
+        size_t highest = index;
+
+        if (left < heap_.size() && isHigher(left, highest))
+            highest = left;
+
+        if (right < heap_.size() && isHigher(right, highest))
+            highest = right;
+
+        if (highest == index)
+            break;
+
+        swapHeapItems(index, highest);
+        index = highest;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void SharedKeyPool::Impl::updateHeap(Relay* relay)
+{
+    if (relay->heap_index == kInvalidHeapIndex)
+        return;
+
+    siftUp(relay->heap_index);
+    siftDown(relay->heap_index);
+}
+
+//--------------------------------------------------------------------------------------------------
+void SharedKeyPool::Impl::removeFromHeap(Relay* relay)
+{
+    size_t index = relay->heap_index;
+    if (index == kInvalidHeapIndex)
+        return;
+
+    size_t last = heap_.size() - 1;
+    if (index != last)
+        swapHeapItems(index, last);
+
+    heap_.pop_back();
+    relay->heap_index = kInvalidHeapIndex;
+
+    if (index < heap_.size())
+        updateHeap(heap_[index]);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -220,6 +361,12 @@ void SharedKeyPool::removeKeysForRelay(Session::SessionId session_id)
     impl_->removeKeysForRelay(session_id);
 }
 
+//--------------------------------------------------------------------------------------------------
+void SharedKeyPool::setRelayLoad(Session::SessionId session_id, uint32_t active_peers)
+{
+    impl_->setRelayLoad(session_id, active_peers);
+}
+
 //--------------------------------------------------------------------------------------------------
 void SharedKeyPool::clear()
 {
@@ -55,6 +55,11 @@ public:
     void addKey(Session::SessionId session_id, const proto::RelayKey& key);
     std::optional<Credentials> takeCredentials();
     void removeKeysForRelay(Session::SessionId session_id);
+
+    // Sets the number of active peer connections of the relay. Relays with more active
+    // connections are chosen less often.
+    void setRelayLoad(Session::SessionId session_id, uint32_t active_peers);
+
     void clear();
     size_t countForRelay(Session::SessionId session_id) const;
     size_t count() const;
@@ -131,6 +131,7 @@ void build(Solution &s) {
         base.Public += "org.sw.demo.google.protobuf.protobuf"_dep; // should be protobuf_lite actually?
         base.Public += "org.sw.demo.chromium.libyuv-master"_dep;
         base.Public += "org.sw.demo.webmproject.vpx"_dep;
+        base.Public += "org.sw.demo.aomedia.aom"_dep;
         base.Public += "org.sw.demo.webmproject.webm"_dep;
         base.Public += "org.sw.demo.xiph.opus"_dep;
         base.Public += "org.sw.demo.sqlite3"_dep;